@@ -0,0 +1,112 @@
+/// Compares the latency of compiling kernels with the C99 backend, which
+/// generates C and runs the system compiler, and with the in-process LLVM
+/// backend (the x86 target).  The on-disk kernel cache is disabled so that
+/// every C99 compilation runs the compiler.
+///
+/// Usage: compile_latency [-repeat=<n>]
+
+#include <cstdlib>
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+
+#include "taco/tensor.h"
+#include "taco/expr.h"
+#include "taco/target.h"
+#include "taco/util/strings.h"
+#include "taco/util/timers.h"
+#include "lower/lower.h"
+#include "backends/module.h"
+
+using namespace std;
+using namespace taco;
+
+struct Kernel {
+  string     name;
+  TensorBase tensor;
+};
+
+static double getCompileTime(const Kernel& kernel, Target target, int repeat) {
+  ir::Stmt assemble = lower::lower(kernel.tensor, "assemble", {lower::Assemble});
+  ir::Stmt compute  = lower::lower(kernel.tensor, "compute", {lower::Compute});
+
+  util::TimeResults result;
+  TACO_TIME_REPEAT({
+    ir::Module module(target);
+    module.addFunction(assemble);
+    module.addFunction(compute);
+    module.compile();
+  }, repeat, result);
+  return result.median;
+}
+
+static vector<Kernel> getKernels() {
+  Format csr({Dense,Sparse});
+  Format csf({Sparse,Sparse,Sparse});
+
+  Var i("i"), j("j"), k("k", Var::Sum), l("l", Var::Sum);
+  vector<Kernel> kernels;
+
+  Tensor<double> a("a", {1000}, Sparse);
+  Tensor<double> b("b", {1000}, Sparse);
+  Tensor<double> c("c", {1000}, Sparse);
+  a(i) = b(i) + c(i);
+  kernels.push_back({"a(i)=b(i)+c(i)", a});
+
+  Tensor<double> y("y", {1000}, Dense);
+  Tensor<double> A("A", {1000,1000}, csr);
+  Tensor<double> x("x", {1000}, Dense);
+  y(i) = A(i,l) * x(l);
+  kernels.push_back({"y(i)=A(i,j)*x(j)", y});
+
+  Tensor<double> C("C", {100,100}, csr);
+  Tensor<double> B("B", {100,100,100}, csf);
+  Tensor<double> v("v", {100}, Sparse);
+  C(i,j) = B(i,j,k) * v(k);
+  kernels.push_back({"A(i,j)=B(i,j,k)*c(k)", C});
+
+  Tensor<double> D("D", {1000,1000}, csr);
+  Tensor<double> E("E", {1000,1000}, csr);
+  Tensor<double> F("F", {1000,1000}, csr);
+  D(i,j) = E(i,j) + F(i,j);
+  kernels.push_back({"A(i,j)=B(i,j)+C(i,j)", D});
+
+  return kernels;
+}
+
+int main(int argc, char* argv[]) {
+  int repeat = 10;
+  for (int i = 1; i < argc; i++) {
+    vector<string> arg = util::split(argv[i], "=");
+    if (arg.size() == 2 && arg[0] == "-repeat") {
+      repeat = std::stoi(arg[1]);
+    }
+    else {
+      cerr << "Usage: compile_latency [-repeat=<n>]" << endl;
+      return 1;
+    }
+  }
+
+  setenv("TACO_CACHE_SIZE", "0", 1);
+  Target::OS os = getTargetFromEnvironment().os;
+
+  cout << "Median compile time (ms) of " << repeat << " compilations" << endl;
+  cout << left << setw(32) << "kernel" << right << setw(12) << "c99";
+#ifdef TACO_LLVM
+  cout << setw(12) << "x86 (llvm)" << setw(12) << "speedup";
+#endif
+  cout << endl;
+
+  cout << fixed << setprecision(2);
+  for (auto& kernel : getKernels()) {
+    double c99 = getCompileTime(kernel, Target(Target::C99, os), repeat);
+    cout << left << setw(32) << kernel.name << right << setw(12) << c99;
+#ifdef TACO_LLVM
+    double x86 = getCompileTime(kernel, Target(Target::X86, os), repeat);
+    cout << setw(12) << x86 << setw(11) << c99 / x86 << "x";
+#endif
+    cout << endl;
+  }
+  return 0;
+}
@@ -0,0 +1,161 @@
+/// Measures the throughput of loading .tns and .mtx files on 1, 2, 4, ...
+/// threads.  The benchmark writes a random sparse 3-tensor to a .tns file, a
+/// random sparse matrix to a .mtx file, and a matrix with sorted coordinates
+/// to another .mtx file in the temporary directory.  It reads the random files
+/// without packing (`tns` and `mtx`), and all files with packing
+/// (`+pack`), which for the sorted file packs without sorting.  The `stream`
+/// row reads them from a stream, which parses one line at a time.
+///
+/// Usage: load_throughput [-nnz=<n>] [-threads=<max>] [-repeat=<n>]
+
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <iomanip>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "taco/tensor.h"
+#include "taco/format.h"
+#include "taco/util/env.h"
+#include "taco/util/parallel.h"
+#include "taco/util/strings.h"
+#include "taco/util/timers.h"
+
+using namespace std;
+using namespace taco;
+
+struct Benchmark {
+  string      name;
+  string      filename;
+  FileType    fileType;
+  Format      format;
+  bool        pack;
+  size_t      bytes;
+};
+
+/// Write a file with random coordinates, or with 100 sorted coordinates per
+/// row of a matrix if `sorted` is true.
+static size_t writeFile(const string& filename, FileType fileType,
+                        const vector<int>& dimensions, size_t nnz,
+                        bool sorted=false) {
+  std::ofstream file(filename);
+  if (fileType == FileType::mtx) {
+    file << "%%MatrixMarket matrix coordinate real general" << "\n";
+    file << util::join(dimensions, " ") << " " << nnz << "\n";
+  }
+  std::mt19937 random(0);
+  std::uniform_real_distribution<double> values(-1.0, 1.0);
+  const int stride = std::max(dimensions.back() / 100, 1);
+  for (size_t k = 0; k < nnz; k++) {
+    if (sorted) {
+      file << k / 100 + 1 << " " << (k % 100) * stride + random() % stride + 1
+           << " ";
+    }
+    else {
+      for (int dimension : dimensions) {
+        file << random() % dimension + 1 << " ";
+      }
+    }
+    file << values(random) << "\n";
+  }
+  return file.tellp();
+}
+
+static double getLoadTime(const Benchmark& benchmark, int numThreads,
+                          int repeat) {
+  util::Timer timer;
+  for (int i = 0; i < repeat; i++) {
+    timer.start();
+    if (numThreads > 0) {
+      util::setNumThreads(numThreads);
+      read(benchmark.filename, benchmark.fileType, benchmark.format,
+           benchmark.pack);
+    }
+    else {
+      std::ifstream file(benchmark.filename);
+      read(file, benchmark.fileType, benchmark.format, benchmark.pack);
+    }
+    timer.stop();
+  }
+  return timer.getResult().median;
+}
+
+int main(int argc, char* argv[]) {
+  size_t nnz = 10000000;
+  int maxThreads = (int)std::max(thread::hardware_concurrency(), 1u);
+  int repeat = 3;
+  for (int i = 1; i < argc; i++) {
+    vector<string> arg = util::split(argv[i], "=");
+    if (arg.size() == 2 && arg[0] == "-nnz") {
+      nnz = std::stoul(arg[1]);
+    }
+    else if (arg.size() == 2 && arg[0] == "-threads") {
+      maxThreads = std::stoi(arg[1]);
+    }
+    else if (arg.size() == 2 && arg[0] == "-repeat") {
+      repeat = std::stoi(arg[1]);
+    }
+    else {
+      cerr << "Usage: load_throughput [-nnz=<n>] [-threads=<max>] "
+           << "[-repeat=<n>]" << endl;
+      return 1;
+    }
+  }
+
+  int rows = (int)std::max(nnz / 100, (size_t)1);
+  string tmpdir = util::getTmpdir();
+  string tnsFilename = tmpdir + "load_throughput.tns";
+  string mtxFilename = tmpdir + "load_throughput.mtx";
+  string sortedFilename = tmpdir + "load_throughput_sorted.mtx";
+  size_t tnsBytes = writeFile(tnsFilename, FileType::tns, {1000, 1000, rows},
+                              nnz);
+  size_t mtxBytes = writeFile(mtxFilename, FileType::mtx, {rows, rows}, nnz);
+  size_t sortedBytes = writeFile(sortedFilename, FileType::mtx, {rows, rows},
+                                 nnz, true);
+  Format csf({Sparse,Sparse,Sparse});
+  vector<Benchmark> benchmarks = {
+    {"tns", tnsFilename, FileType::tns, csf, false, tnsBytes},
+    {"mtx", mtxFilename, FileType::mtx, CSR, false, mtxBytes},
+    {"tns+pack", tnsFilename, FileType::tns, csf, true, tnsBytes},
+    {"mtx+pack", mtxFilename, FileType::mtx, CSR, true, mtxBytes},
+    {"sorted+pack", sortedFilename, FileType::mtx, CSR, true, sortedBytes}
+  };
+
+  cout << "Median load throughput (MB/s) of " << repeat << " loads of " << nnz
+       << " nonzeros" << endl;
+  cout << left << setw(12) << "threads";
+  for (auto& benchmark : benchmarks) {
+    cout << right << setw(12) << benchmark.name << setw(10) << "speedup";
+  }
+  cout << endl;
+
+  // Thread count 0 stands for the stream reader
+  cout << fixed << setprecision(2);
+  vector<double> streamTimes;
+  vector<int> threadCounts = {0};
+  for (int numThreads = 1; numThreads <= maxThreads; numThreads *= 2) {
+    threadCounts.push_back(numThreads);
+  }
+  for (int numThreads : threadCounts) {
+    cout << left << setw(12) << (numThreads > 0 ? to_string(numThreads)
+                                                : string("stream"));
+    for (size_t b = 0; b < benchmarks.size(); b++) {
+      double time = getLoadTime(benchmarks[b], numThreads, repeat);
+      if (numThreads == 0) {
+        streamTimes.push_back(time);
+      }
+      double throughput = benchmarks[b].bytes / (time * 1e3);
+      cout << right << setw(12) << throughput << setw(9)
+           << streamTimes[b] / time << "x";
+    }
+    cout << endl;
+  }
+
+  for (auto& filename : {tnsFilename, mtxFilename, sortedFilename}) {
+    remove(filename.c_str());
+  }
+  return 0;
+}
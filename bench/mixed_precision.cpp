@@ -0,0 +1,174 @@
+/// Measures kernels that store float components but accumulate them in double
+/// against all-double and all-float kernels.  The benchmark times SpMV,
+/// `y(i) = A(i,j) * x(j)` with a random CSR matrix, and MTTKRP,
+/// `A(i,j) = B(i,k,l) * C(k,j) * D(l,j)` with a random sparse 3-tensor, and
+/// reports the largest error of each result relative to the double result.
+///
+/// Usage: mixed_precision [-nnz=<n>] [-rank=<n>] [-repeat=<n>]
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <iomanip>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "taco/tensor.h"
+#include "taco/expr.h"
+#include "taco/format.h"
+#include "taco/storage/storage.h"
+#include "taco/util/strings.h"
+#include "taco/util/timers.h"
+
+using namespace std;
+using namespace taco;
+
+struct Precision {
+  string        name;
+  ComponentType ctype;
+  ComponentType accumulatorType;
+};
+
+static TensorBase createTensor(string name, ComponentType ctype,
+                               const vector<int>& dimensions,
+                               const Format& format, size_t nnz) {
+  TensorBase tensor(name, ctype, dimensions, format);
+  std::mt19937 random(0);
+  std::uniform_real_distribution<double> values(0.0, 1.0);
+  vector<vector<int>> coordinates(dimensions.size(), vector<int>(nnz));
+  vector<double> vals(nnz);
+  for (size_t k = 0; k < nnz; k++) {
+    for (size_t i = 0; i < dimensions.size(); i++) {
+      coordinates[i][k] = random() % dimensions[i];
+    }
+    vals[k] = values(random);
+  }
+  tensor.insertBulk(coordinates, vals);
+  tensor.pack();
+  return tensor;
+}
+
+static TensorBase createDense(string name, ComponentType ctype,
+                              const vector<int>& dimensions) {
+  size_t size = 1;
+  for (int dimension : dimensions) {
+    size *= dimension;
+  }
+  Format format(vector<DimensionType>(dimensions.size(), Dense));
+  return createTensor(name, ctype, dimensions, format, size);
+}
+
+/// Time the computation of the result's expression, which is assembled first.
+static double getTime(TensorBase result, int repeat) {
+  result.compile();
+  result.assemble();
+  util::Timer timer;
+  for (int r = 0; r < repeat; r++) {
+    timer.start();
+    result.compute();
+    timer.stop();
+  }
+  return timer.getResult().median;
+}
+
+/// Returns the largest error of the result values relative to the expected
+/// values.
+static double getError(const TensorBase& expected, const TensorBase& result) {
+  const storage::Storage& expectedStorage = expected.getStorage();
+  const storage::Storage& resultStorage = result.getStorage();
+  double error = 0.0;
+  for (size_t i = 0; i < expectedStorage.getSize().numValues(); i++) {
+    double e = loadValue(expectedStorage.getValues(),
+                         expected.getComponentType(), i);
+    double r = loadValue(resultStorage.getValues(),
+                         result.getComponentType(), i);
+    if (e != 0.0) {
+      error = std::max(error, std::abs((r - e) / e));
+    }
+  }
+  return error;
+}
+
+int main(int argc, char* argv[]) {
+  size_t nnz = 10000000;
+  int rank = 16;
+  int repeat = 10;
+  for (int i = 1; i < argc; i++) {
+    vector<string> arg = util::split(argv[i], "=");
+    if (arg.size() == 2 && arg[0] == "-nnz") {
+      nnz = std::stoul(arg[1]);
+    }
+    else if (arg.size() == 2 && arg[0] == "-rank") {
+      rank = std::stoi(arg[1]);
+    }
+    else if (arg.size() == 2 && arg[0] == "-repeat") {
+      repeat = std::stoi(arg[1]);
+    }
+    else {
+      cerr << "Usage: mixed_precision [-nnz=<n>] [-rank=<n>] [-repeat=<n>]"
+           << endl;
+      return 1;
+    }
+  }
+
+  const vector<Precision> precisions = {
+    {"double", ComponentType::Double, ComponentType::Double},
+    {"float", ComponentType::Float, ComponentType::Float},
+    {"float+double", ComponentType::Float, ComponentType::Double}
+  };
+
+  // SpMV on a matrix with 1000 nonzeros per row, and MTTKRP on a tensor with
+  // 1000 nonzeros per slice
+  const int rows = (int)std::max(nnz / 1000, (size_t)1);
+  const int cols = 100000;
+  const int slices = (int)std::max(nnz / 1000, (size_t)1);
+
+  cout << "Median time (ms) of " << repeat << " runs with " << nnz
+       << " nonzeros" << endl;
+  cout << left << setw(10) << "kernel" << setw(14) << "precision" << right
+       << setw(12) << "time (ms)" << setw(10) << "speedup" << setw(14)
+       << "max error" << endl;
+
+  Var i("i"), j("j"), k("k", Var::Sum), l("l", Var::Sum);
+  TensorBase expectedSpMV, expectedMTTKRP;
+  double baselineSpMV = 0.0, baselineMTTKRP = 0.0;
+  for (auto& precision : precisions) {
+    ComponentType ctype = precision.ctype;
+    TensorBase A = createTensor("A", ctype, {rows, cols}, CSR, nnz);
+    TensorBase x = createDense("x", ctype, {cols});
+    TensorBase y("y", ctype, {rows}, Dense);
+    y.setAccumulatorType(precision.accumulatorType);
+    y(i) = A(i,k) * x(k);
+    double time = getTime(y, repeat);
+    if (ctype == ComponentType::Double) {
+      expectedSpMV = y;
+      baselineSpMV = time;
+    }
+    cout << left << setw(10) << "SpMV" << setw(14) << precision.name
+         << right << fixed << setprecision(2) << setw(12) << time << setw(9)
+         << baselineSpMV / time << "x" << scientific << setprecision(1)
+         << setw(14) << getError(expectedSpMV, y) << endl;
+  }
+
+  for (auto& precision : precisions) {
+    ComponentType ctype = precision.ctype;
+    TensorBase B = createTensor("B", ctype, {slices, 100, 100},
+                                Format({Sparse,Sparse,Sparse}), nnz);
+    TensorBase C = createDense("C", ctype, {100, rank});
+    TensorBase D = createDense("D", ctype, {100, rank});
+    TensorBase A("A", ctype, {slices, rank}, Format({Dense,Dense}));
+    A.setAccumulatorType(precision.accumulatorType);
+    A(i,j) = B(i,k,l) * C(k,j) * D(l,j);
+    double time = getTime(A, repeat);
+    if (ctype == ComponentType::Double) {
+      expectedMTTKRP = A;
+      baselineMTTKRP = time;
+    }
+    cout << left << setw(10) << "MTTKRP" << setw(14) << precision.name
+         << right << fixed << setprecision(2) << setw(12) << time << setw(9)
+         << baselineMTTKRP / time << "x" << scientific << setprecision(1)
+         << setw(14) << getError(expectedMTTKRP, A) << endl;
+  }
+  return 0;
+}
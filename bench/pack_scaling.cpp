@@ -0,0 +1,113 @@
+/// Measures how TensorBase::pack scales with the number of threads, by packing
+/// a random sparse matrix in the CSR, DCSR and ELL formats and a random sparse
+/// 3-tensor in the CSF format on 1, 2, 4, ... threads.  With `-code=1` the
+/// tensors are packed with code generated for their format, and with `-code=0`
+/// with the pack interpreter.
+///
+/// Usage: pack_scaling [-nnz=<n>] [-threads=<max>] [-repeat=<n>] [-code=<0|1>]
+
+#include <cstdlib>
+#include <iostream>
+#include <iomanip>
+#include <limits>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "taco/tensor.h"
+#include "taco/format.h"
+#include "taco/util/parallel.h"
+#include "taco/util/strings.h"
+#include "taco/util/timers.h"
+
+using namespace std;
+using namespace taco;
+
+struct Benchmark {
+  string      name;
+  vector<int> dimensions;
+  Format      format;
+};
+
+static double getPackTime(const Benchmark& benchmark, size_t nnz,
+                          int numThreads, int repeat) {
+  util::setNumThreads(numThreads);
+  util::Timer timer;
+  for (int i = 0; i < repeat; i++) {
+    std::mt19937 random(i);
+    Tensor<double> tensor(benchmark.dimensions, benchmark.format);
+    vector<int> coordinate(benchmark.dimensions.size());
+    for (size_t k = 0; k < nnz; k++) {
+      for (size_t d = 0; d < coordinate.size(); d++) {
+        coordinate[d] = random() % benchmark.dimensions[d];
+      }
+      tensor.insert(coordinate, 1.0);
+    }
+
+    timer.start();
+    tensor.pack();
+    timer.stop();
+  }
+  return timer.getResult().median;
+}
+
+int main(int argc, char* argv[]) {
+  size_t nnz = 10000000;
+  int maxThreads = (int)std::max(thread::hardware_concurrency(), 1u);
+  int repeat = 3;
+  for (int i = 1; i < argc; i++) {
+    vector<string> arg = util::split(argv[i], "=");
+    if (arg.size() == 2 && arg[0] == "-nnz") {
+      nnz = std::stoul(arg[1]);
+    }
+    else if (arg.size() == 2 && arg[0] == "-threads") {
+      maxThreads = std::stoi(arg[1]);
+    }
+    else if (arg.size() == 2 && arg[0] == "-repeat") {
+      repeat = std::stoi(arg[1]);
+    }
+    else if (arg.size() == 2 && arg[0] == "-code") {
+      string threshold = (arg[1] == "0")
+          ? to_string(numeric_limits<size_t>::max()) : "0";
+      setenv("TACO_PACK_CODE_THRESHOLD", threshold.c_str(), 1);
+    }
+    else {
+      cerr << "Usage: pack_scaling [-nnz=<n>] [-threads=<max>] [-repeat=<n>] "
+           << "[-code=<0|1>]" << endl;
+      return 1;
+    }
+  }
+
+  int rows = (int)std::max(nnz / 100, (size_t)1);
+  vector<Benchmark> benchmarks = {
+    {"csr",  {rows, rows}, CSR},
+    {"dcsr", {rows, rows}, Format({Sparse,Sparse})},
+    {"ell",  {rows, rows}, Format({Dense,Fixed})},
+    {"csf",  {1000, 1000, rows}, Format({Sparse,Sparse,Sparse})}
+  };
+
+  cout << "Median pack time (ms) of " << repeat << " packs of " << nnz
+       << " coordinates" << endl;
+  cout << left << setw(12) << "threads";
+  for (auto& benchmark : benchmarks) {
+    cout << right << setw(12) << benchmark.name << setw(10) << "speedup";
+  }
+  cout << endl;
+
+  cout << fixed << setprecision(2);
+  vector<double> serialTimes;
+  for (int numThreads = 1; numThreads <= maxThreads; numThreads *= 2) {
+    cout << left << setw(12) << numThreads;
+    for (size_t b = 0; b < benchmarks.size(); b++) {
+      double time = getPackTime(benchmarks[b], nnz, numThreads, repeat);
+      if (numThreads == 1) {
+        serialTimes.push_back(time);
+      }
+      cout << right << setw(12) << time << setw(9) << serialTimes[b] / time
+           << "x";
+    }
+    cout << endl;
+  }
+  return 0;
+}
@@ -0,0 +1,144 @@
+/// Measures how the compute kernels of the OpenMP target scale with the number
+/// of threads.  The benchmark times SpMV, `y(i) = A(i,j) * x(j)` with a random
+/// CSR matrix, transposed SpMV, `z(j) = A(i,j) * w(i)`, whose threads reduce
+/// into private copies of z, and MTTKRP, `A(i,j) = B(i,k,l) * C(k,j) * D(l,j)`
+/// with a random sparse 3-tensor, on 1, 2, 4, ... threads.
+///
+/// Usage: parallel_scaling [-nnz=<n>] [-rank=<n>] [-threads=<max>]
+///                         [-repeat=<n>]
+
+#include <algorithm>
+#include <iostream>
+#include <iomanip>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "taco/tensor.h"
+#include "taco/expr.h"
+#include "taco/format.h"
+#include "taco/target.h"
+#include "taco/util/strings.h"
+#include "taco/util/timers.h"
+
+using namespace std;
+using namespace taco;
+
+static Tensor<double> createTensor(string name, const vector<int>& dimensions,
+                                   const Format& format, size_t nnz) {
+  Tensor<double> tensor(name, dimensions, format);
+  std::mt19937 random(0);
+  std::uniform_real_distribution<double> values(0.0, 1.0);
+  vector<vector<int>> coordinates(dimensions.size(), vector<int>(nnz));
+  vector<double> vals(nnz);
+  for (size_t k = 0; k < nnz; k++) {
+    for (size_t i = 0; i < dimensions.size(); i++) {
+      coordinates[i][k] = random() % dimensions[i];
+    }
+    vals[k] = values(random);
+  }
+  tensor.insertBulk(coordinates, vals);
+  tensor.pack();
+  return tensor;
+}
+
+static Tensor<double> createDense(string name, const vector<int>& dimensions) {
+  size_t size = 1;
+  for (int dimension : dimensions) {
+    size *= dimension;
+  }
+  Format format(vector<DimensionType>(dimensions.size(), Dense));
+  return createTensor(name, dimensions, format, size);
+}
+
+/// Time the computation of the result's expression on the given number of
+/// threads.  The result is compiled for the OpenMP target and assembled first.
+static double getTime(Tensor<double> result, int numThreads, int repeat) {
+  Target target = getTargetFromEnvironment();
+  result.setTarget(Target(Target::C99, target.os, Target::OpenMP));
+  result.setNumThreads(numThreads);
+  result.compile();
+  result.assemble();
+  util::Timer timer;
+  for (int r = 0; r < repeat; r++) {
+    timer.start();
+    result.compute();
+    timer.stop();
+  }
+  return timer.getResult().median;
+}
+
+int main(int argc, char* argv[]) {
+  size_t nnz = 10000000;
+  int rank = 16;
+  int maxThreads = (int)std::max(thread::hardware_concurrency(), 1u);
+  int repeat = 10;
+  for (int i = 1; i < argc; i++) {
+    vector<string> arg = util::split(argv[i], "=");
+    if (arg.size() == 2 && arg[0] == "-nnz") {
+      nnz = std::stoul(arg[1]);
+    }
+    else if (arg.size() == 2 && arg[0] == "-rank") {
+      rank = std::stoi(arg[1]);
+    }
+    else if (arg.size() == 2 && arg[0] == "-threads") {
+      maxThreads = std::stoi(arg[1]);
+    }
+    else if (arg.size() == 2 && arg[0] == "-repeat") {
+      repeat = std::stoi(arg[1]);
+    }
+    else {
+      cerr << "Usage: parallel_scaling [-nnz=<n>] [-rank=<n>] [-threads=<max>] "
+           << "[-repeat=<n>]" << endl;
+      return 1;
+    }
+  }
+
+  // SpMV on a matrix with 1000 nonzeros per row, and MTTKRP on a tensor with
+  // 1000 nonzeros per slice
+  const int rows = (int)std::max(nnz / 1000, (size_t)1);
+  const int cols = 100000;
+  const int slices = (int)std::max(nnz / 1000, (size_t)1);
+
+  Var i("i"), j("j"), k("k", Var::Sum), l("l", Var::Sum), r("r", Var::Sum);
+  Tensor<double> A = createTensor("A", {rows, cols}, CSR, nnz);
+  Tensor<double> x = createDense("x", {cols});
+  Tensor<double> w = createDense("w", {rows});
+  Tensor<double> B = createTensor("B", {slices, 100, 100},
+                                  Format({Sparse,Sparse,Sparse}), nnz);
+  Tensor<double> C = createDense("C", {100, rank});
+  Tensor<double> D = createDense("D", {100, rank});
+
+  cout << "Median compute time (ms) of " << repeat << " runs with " << nnz
+       << " nonzeros" << endl;
+  cout << left << setw(12) << "threads" << right << setw(12) << "SpMV"
+       << setw(10) << "speedup" << setw(12) << "SpMV^T" << setw(10)
+       << "speedup" << setw(12) << "MTTKRP" << setw(10) << "speedup" << endl;
+  cout << fixed << setprecision(2);
+  double serialSpMV = 0.0, serialSpMVT = 0.0, serialMTTKRP = 0.0;
+  for (int numThreads = 1; numThreads <= maxThreads; numThreads *= 2) {
+    Tensor<double> y("y", {rows}, Dense);
+    y(i) = A(i,k) * x(k);
+    double spmv = getTime(y, numThreads, repeat);
+
+    Tensor<double> z("z", {cols}, Dense);
+    z(j) = A(r,j) * w(r);
+    double spmvt = getTime(z, numThreads, repeat);
+
+    Tensor<double> M("M", {slices, rank}, Format({Dense,Dense}));
+    M(i,j) = B(i,k,l) * C(k,j) * D(l,j);
+    double mttkrp = getTime(M, numThreads, repeat);
+
+    if (numThreads == 1) {
+      serialSpMV = spmv;
+      serialSpMVT = spmvt;
+      serialMTTKRP = mttkrp;
+    }
+    cout << left << setw(12) << numThreads << right << setw(12) << spmv
+         << setw(9) << serialSpMV / spmv << "x" << setw(12) << spmvt
+         << setw(9) << serialSpMVT / spmvt << "x" << setw(12) << mttkrp
+         << setw(9) << serialMTTKRP / mttkrp << "x" << endl;
+  }
+  return 0;
+}
@@ -0,0 +1,121 @@
+/// Compares the row and nonzero parallel schedules of SpMV,
+/// `y(i) = A(i,j) * x(j)`, on a random CSR matrix with power-law row lengths,
+/// like the adjacency matrices of social and web graphs, on 1, 2, 4, ...
+/// threads.  The row schedule gives every thread the same number of rows, so
+/// the threads with the longest rows finish last, while the nonzero schedule
+/// gives every thread the same number of nonzeros.
+///
+/// Usage: skewed_spmv [-rows=<n>] [-exponent=<a>] [-threads=<max>]
+///                    [-repeat=<n>]
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <iomanip>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "taco/tensor.h"
+#include "taco/expr.h"
+#include "taco/format.h"
+#include "taco/target.h"
+#include "taco/util/strings.h"
+#include "taco/util/timers.h"
+
+using namespace std;
+using namespace taco;
+
+/// Create a matrix whose k-th row has about rows / (k+1)^exponent nonzeros, so
+/// that the first rows hold most of the nonzeros.
+static Tensor<double> createSkewedMatrix(int rows, double exponent) {
+  std::mt19937 random(0);
+  std::uniform_real_distribution<double> values(0.0, 1.0);
+  vector<vector<int>> coordinates(2);
+  vector<double> vals;
+  for (int i = 0; i < rows; i++) {
+    int length = std::max((int)(rows / std::pow(i + 1.0, exponent)), 1);
+    for (int k = 0; k < length; k++) {
+      coordinates[0].push_back(i);
+      coordinates[1].push_back(random() % rows);
+      vals.push_back(values(random));
+    }
+  }
+  Tensor<double> A("A", {rows, rows}, CSR);
+  A.insertBulk(coordinates, vals);
+  A.pack();
+  return A;
+}
+
+/// Time SpMV with the given schedule on the given number of threads.
+static double getTime(Tensor<double> A, Tensor<double> x,
+                      ParallelSchedule schedule, int numThreads, int repeat) {
+  Target target = getTargetFromEnvironment();
+  Var i("i"), j("j", Var::Sum);
+  Tensor<double> y("y", {A.getDimensions()[0]}, Dense);
+  y(i) = A(i,j) * x(j);
+  y.setTarget(Target(Target::C99, target.os, Target::OpenMP));
+  y.setParallelSchedule(schedule);
+  y.setNumThreads(numThreads);
+  y.compile();
+  y.assemble();
+  util::Timer timer;
+  for (int r = 0; r < repeat; r++) {
+    timer.start();
+    y.compute();
+    timer.stop();
+  }
+  return timer.getResult().median;
+}
+
+int main(int argc, char* argv[]) {
+  int rows = 1000000;
+  double exponent = 1.0;
+  int maxThreads = (int)std::max(thread::hardware_concurrency(), 1u);
+  int repeat = 10;
+  for (int i = 1; i < argc; i++) {
+    vector<string> arg = util::split(argv[i], "=");
+    if (arg.size() == 2 && arg[0] == "-rows") {
+      rows = std::stoi(arg[1]);
+    }
+    else if (arg.size() == 2 && arg[0] == "-exponent") {
+      exponent = std::stod(arg[1]);
+    }
+    else if (arg.size() == 2 && arg[0] == "-threads") {
+      maxThreads = std::stoi(arg[1]);
+    }
+    else if (arg.size() == 2 && arg[0] == "-repeat") {
+      repeat = std::stoi(arg[1]);
+    }
+    else {
+      cerr << "Usage: skewed_spmv [-rows=<n>] [-exponent=<a>] "
+           << "[-threads=<max>] [-repeat=<n>]" << endl;
+      return 1;
+    }
+  }
+
+  Tensor<double> A = createSkewedMatrix(rows, exponent);
+  Tensor<double> x("x", {rows}, Dense);
+  for (int i = 0; i < rows; i++) {
+    x.insert({i}, 1.0);
+  }
+  x.pack();
+
+  cout << "Median SpMV time (ms) of " << repeat << " runs with " << rows
+       << " rows and " << A.getStorage().getSize().numValues()
+       << " nonzeros" << endl;
+  cout << left << setw(12) << "threads" << right << setw(12) << "rows"
+       << setw(12) << "nonzeros" << setw(10) << "speedup" << endl;
+  cout << fixed << setprecision(2);
+  for (int numThreads = 1; numThreads <= maxThreads; numThreads *= 2) {
+    double rowTime = getTime(A, x, ParallelSchedule::Rows, numThreads,
+                             repeat);
+    double nonzeroTime = getTime(A, x, ParallelSchedule::Nonzeros, numThreads,
+                                 repeat);
+    cout << left << setw(12) << numThreads << right << setw(12) << rowTime
+         << setw(12) << nonzeroTime << setw(9) << rowTime / nonzeroTime << "x"
+         << endl;
+  }
+  return 0;
+}
@@ -0,0 +1,122 @@
+/// Measures how the assembly of sparse results scales with the number of
+/// threads.  The benchmark times the assembly and computation of the CSR sum
+/// `A(i,j) = B(i,j) + C(i,j)` of two random CSR matrices, which the OpenMP
+/// target assembles by counting, summing and filling the rows in parallel, on
+/// the serial target and on 1, 2, 4, ... threads of the OpenMP target.
+///
+/// Usage: sparse_assembly [-nnz=<n>] [-threads=<max>] [-repeat=<n>]
+
+#include <algorithm>
+#include <iostream>
+#include <iomanip>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "taco/tensor.h"
+#include "taco/expr.h"
+#include "taco/format.h"
+#include "taco/target.h"
+#include "taco/util/strings.h"
+#include "taco/util/timers.h"
+
+using namespace std;
+using namespace taco;
+
+static Tensor<double> createMatrix(string name, int rows, int cols,
+                                   size_t nnz, unsigned seed) {
+  Tensor<double> tensor(name, {rows, cols}, CSR);
+  std::mt19937 random(seed);
+  std::uniform_real_distribution<double> values(0.0, 1.0);
+  vector<vector<int>> coordinates(2, vector<int>(nnz));
+  vector<double> vals(nnz);
+  for (size_t k = 0; k < nnz; k++) {
+    coordinates[0][k] = random() % rows;
+    coordinates[1][k] = random() % cols;
+    vals[k] = values(random);
+  }
+  tensor.insertBulk(coordinates, vals);
+  tensor.pack();
+  return tensor;
+}
+
+/// Time the assembly and the computation of the result's expression, which is
+/// compiled for the given target and run on the given number of threads.
+static pair<double,double> getTimes(Tensor<double> result, Target target,
+                                    int numThreads, int repeat) {
+  result.setTarget(target);
+  result.setNumThreads(numThreads);
+  result.compile();
+  util::Timer assembleTimer;
+  util::Timer computeTimer;
+  for (int r = 0; r < repeat; r++) {
+    assembleTimer.start();
+    result.assemble();
+    assembleTimer.stop();
+    computeTimer.start();
+    result.compute();
+    computeTimer.stop();
+  }
+  return {assembleTimer.getResult().median, computeTimer.getResult().median};
+}
+
+int main(int argc, char* argv[]) {
+  size_t nnz = 10000000;
+  int maxThreads = (int)std::max(thread::hardware_concurrency(), 1u);
+  int repeat = 10;
+  for (int i = 1; i < argc; i++) {
+    vector<string> arg = util::split(argv[i], "=");
+    if (arg.size() == 2 && arg[0] == "-nnz") {
+      nnz = std::stoul(arg[1]);
+    }
+    else if (arg.size() == 2 && arg[0] == "-threads") {
+      maxThreads = std::stoi(arg[1]);
+    }
+    else if (arg.size() == 2 && arg[0] == "-repeat") {
+      repeat = std::stoi(arg[1]);
+    }
+    else {
+      cerr << "Usage: sparse_assembly [-nnz=<n>] [-threads=<max>] "
+           << "[-repeat=<n>]" << endl;
+      return 1;
+    }
+  }
+
+  // Matrices with 100 nonzeros per row
+  const int rows = (int)std::max(nnz / 100, (size_t)1);
+  const int cols = 100000;
+  Tensor<double> B = createMatrix("B", rows, cols, nnz, 0);
+  Tensor<double> C = createMatrix("C", rows, cols, nnz, 1);
+  Var i("i"), j("j");
+
+  cout << "Median time (ms) of " << repeat << " runs of A = B + C with " << nnz
+       << " nonzeros per operand" << endl;
+  cout << left << setw(12) << "threads" << right << setw(12) << "assemble"
+       << setw(10) << "speedup" << setw(12) << "compute" << setw(10)
+       << "speedup" << endl;
+  cout << fixed << setprecision(2);
+
+  Target target = getTargetFromEnvironment();
+  Tensor<double> serial("A", {rows, cols}, CSR);
+  serial(i,j) = B(i,j) + C(i,j);
+  pair<double,double> serialTimes =
+      getTimes(serial, Target(Target::C99, target.os, Target::Serial), 1,
+               repeat);
+  cout << left << setw(12) << "serial" << right << setw(12)
+       << serialTimes.first << setw(10) << "" << setw(12)
+       << serialTimes.second << endl;
+
+  for (int numThreads = 1; numThreads <= maxThreads; numThreads *= 2) {
+    Tensor<double> A("A", {rows, cols}, CSR);
+    A(i,j) = B(i,j) + C(i,j);
+    pair<double,double> times =
+        getTimes(A, Target(Target::C99, target.os, Target::OpenMP),
+                 numThreads, repeat);
+    cout << left << setw(12) << numThreads << right << setw(12)
+         << times.first << setw(9) << serialTimes.first / times.first << "x"
+         << setw(12) << times.second << setw(9)
+         << serialTimes.second / times.second << "x" << endl;
+  }
+  return 0;
+}
@@ -0,0 +1,109 @@
+/// Measures how the component type of the operands affects the time of a
+/// sparse matrix-vector multiplication.  The benchmark packs the same random
+/// CSR matrix and dense vector with double and with float components, and
+/// times `y(i) = A(i,j) * x(j)` on both.
+///
+/// Usage: spmv_component_type [-nnz=<n>] [-cols=<n>] [-repeat=<n>]
+
+#include <iostream>
+#include <iomanip>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "taco/tensor.h"
+#include "taco/expr.h"
+#include "taco/format.h"
+#include "taco/storage/storage.h"
+#include "taco/util/strings.h"
+#include "taco/util/timers.h"
+
+using namespace std;
+using namespace taco;
+
+static TensorBase createMatrix(ComponentType ctype, int rows, int cols,
+                               size_t nnz) {
+  TensorBase A("A", ctype, {rows, cols}, CSR);
+  std::mt19937 random(0);
+  std::uniform_real_distribution<double> values(-1.0, 1.0);
+  vector<vector<int>> coordinates(2, vector<int>(nnz));
+  vector<double> vals(nnz);
+  for (size_t k = 0; k < nnz; k++) {
+    coordinates[0][k] = random() % rows;
+    coordinates[1][k] = random() % cols;
+    vals[k] = values(random);
+  }
+  A.insertBulk(coordinates, vals);
+  A.pack();
+  return A;
+}
+
+static TensorBase createVector(ComponentType ctype, int size) {
+  TensorBase x("x", ctype, {size}, Dense);
+  for (int j = 0; j < size; j++) {
+    x.insert({j}, 1.0 / (j + 1));
+  }
+  x.pack();
+  return x;
+}
+
+static double getSpMVTime(TensorBase A, TensorBase x, int repeat) {
+  Var i("i"), j("j", Var::Sum);
+  TensorBase y("y", A.getComponentType(), {A.getDimensions()[0]}, Dense);
+  y(i) = A(i,j) * x(j);
+  y.compile();
+  y.assemble();
+
+  util::Timer timer;
+  for (int r = 0; r < repeat; r++) {
+    timer.start();
+    y.compute();
+    timer.stop();
+  }
+  return timer.getResult().median;
+}
+
+int main(int argc, char* argv[]) {
+  size_t nnz = 20000000;
+  int cols = 50000;
+  int repeat = 10;
+  for (int i = 1; i < argc; i++) {
+    vector<string> arg = util::split(argv[i], "=");
+    if (arg.size() == 2 && arg[0] == "-nnz") {
+      nnz = std::stoul(arg[1]);
+    }
+    else if (arg.size() == 2 && arg[0] == "-cols") {
+      cols = std::stoi(arg[1]);
+    }
+    else if (arg.size() == 2 && arg[0] == "-repeat") {
+      repeat = std::stoi(arg[1]);
+    }
+    else {
+      cerr << "Usage: spmv_component_type [-nnz=<n>] [-cols=<n>] "
+           << "[-repeat=<n>]" << endl;
+      return 1;
+    }
+  }
+
+  int rows = (int)std::max(nnz / 50, (size_t)1);
+  cout << "Median SpMV time of " << repeat << " runs on a " << rows << "x"
+       << cols << " matrix with " << nnz << " nonzeros" << endl;
+  cout << left << setw(10) << "type" << right << setw(14) << "values MB"
+       << setw(12) << "time (ms)" << setw(10) << "speedup" << endl;
+  cout << fixed << setprecision(2);
+  double baseline = 0.0;
+  for (ComponentType ctype : {ComponentType::Double, ComponentType::Float}) {
+    TensorBase A = createMatrix(ctype, rows, cols, nnz);
+    TensorBase x = createVector(ctype, cols);
+    auto size = A.getStorage().getSize();
+    double valueBytes = (double)size.numValues() * size.numBytesPerValue();
+    double time = getSpMVTime(A, x, repeat);
+    if (ctype == ComponentType::Double) {
+      baseline = time;
+    }
+    cout << left << setw(10) << util::toString(ctype) << right << setw(14)
+         << valueBytes / 1e6 << setw(12) << time << setw(9) << baseline / time
+         << "x" << endl;
+  }
+  return 0;
+}
@@ -0,0 +1,119 @@
+/// Compares a sparse matrix-vector multiplication on a matrix stored as ELL
+/// (`{Dense,Fixed}`) with the same multiplication on CSR.  Every row of the
+/// random matrix has about the same number of nonzeros, which is where ELL's
+/// fixed row stride pays off: the kernel loads no row positions and the
+/// compiler can vectorize the loop over a row.
+///
+/// Usage: spmv_ell [-rows=<n>] [-cols=<n>] [-row-nnz=<n>] [-repeat=<n>]
+
+#include <iostream>
+#include <iomanip>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "taco/tensor.h"
+#include "taco/expr.h"
+#include "taco/format.h"
+#include "taco/util/strings.h"
+#include "taco/util/timers.h"
+
+using namespace std;
+using namespace taco;
+
+static Tensor<double> createMatrix(int rows, int cols, int rowNnz,
+                                   Format format) {
+  Tensor<double> A("A", {rows, cols}, format);
+  std::mt19937 random(0);
+  std::uniform_real_distribution<double> values(-1.0, 1.0);
+  const size_t nnz = (size_t)rows * rowNnz;
+  vector<vector<int>> coordinates(2, vector<int>(nnz));
+  vector<double> vals(nnz);
+  size_t k = 0;
+  for (int i = 0; i < rows; i++) {
+    for (int r = 0; r < rowNnz; r++, k++) {
+      coordinates[0][k] = i;
+      coordinates[1][k] = random() % cols;
+      vals[k] = values(random);
+    }
+  }
+  A.insertBulk(coordinates, vals);
+  A.pack();
+  return A;
+}
+
+static double getSpMVTime(Tensor<double> A, Tensor<double> x,
+                          Tensor<double> y, int repeat) {
+  Var i("i"), j("j", Var::Sum);
+  y(i) = A(i,j) * x(j);
+  y.compile();
+  y.assemble();
+
+  util::Timer timer;
+  for (int r = 0; r < repeat; r++) {
+    timer.start();
+    y.compute();
+    timer.stop();
+  }
+  return timer.getResult().median;
+}
+
+int main(int argc, char* argv[]) {
+  int rows = 500000;
+  int cols = 500000;
+  int rowNnz = 32;
+  int repeat = 10;
+  for (int i = 1; i < argc; i++) {
+    vector<string> arg = util::split(argv[i], "=");
+    if (arg.size() == 2 && arg[0] == "-rows") {
+      rows = std::stoi(arg[1]);
+    }
+    else if (arg.size() == 2 && arg[0] == "-cols") {
+      cols = std::stoi(arg[1]);
+    }
+    else if (arg.size() == 2 && arg[0] == "-row-nnz") {
+      rowNnz = std::stoi(arg[1]);
+    }
+    else if (arg.size() == 2 && arg[0] == "-repeat") {
+      repeat = std::stoi(arg[1]);
+    }
+    else {
+      cerr << "Usage: spmv_ell [-rows=<n>] [-cols=<n>] [-row-nnz=<n>] "
+           << "[-repeat=<n>]" << endl;
+      return 1;
+    }
+  }
+
+  Tensor<double> x("x", {cols}, Dense);
+  for (int j = 0; j < cols; j++) {
+    x.insert({j}, 1.0 / (j + 1));
+  }
+  x.pack();
+
+  cout << "Median SpMV time of " << repeat << " runs on a " << rows << "x"
+       << cols << " matrix with up to " << rowNnz << " nonzeros per row"
+       << endl;
+  cout << left << setw(10) << "format" << right << setw(14) << "stored"
+       << setw(12) << "time (ms)" << setw(10) << "speedup" << endl;
+  cout << fixed << setprecision(2);
+  Tensor<double> expected("expected", {rows}, Dense);
+  double baseline = 0.0;
+  for (bool ell : {false, true}) {
+    Format format = ell ? Format({Dense,Fixed}) : CSR;
+    Tensor<double> A = createMatrix(rows, cols, rowNnz, format);
+    Tensor<double> y("y", {rows}, Dense);
+    double time = getSpMVTime(A, x, y, repeat);
+    if (!ell) {
+      baseline = time;
+      expected = y;
+    }
+    else if (!equals(expected, y)) {
+      cerr << "ELL and CSR results differ" << endl;
+      return 1;
+    }
+    cout << left << setw(10) << (ell ? "ELL" : "CSR") << right << setw(14)
+         << A.getStorage().getSize().numValues() << setw(12) << time
+         << setw(9) << baseline / time << "x" << endl;
+  }
+  return 0;
+}
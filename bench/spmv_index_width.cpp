@@ -0,0 +1,107 @@
+/// Measures how the width of the column indices of a CSR matrix affects the
+/// time of a sparse matrix-vector multiplication.  The benchmark packs a random
+/// matrix with 32-bit column indices and with the narrowest column indices that
+/// hold its columns (`pack(true)`), and times `y(i) = A(i,j) * x(j)` on both.
+///
+/// Usage: spmv_index_width [-nnz=<n>] [-cols=<n>] [-repeat=<n>]
+
+#include <iostream>
+#include <iomanip>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "taco/tensor.h"
+#include "taco/expr.h"
+#include "taco/format.h"
+#include "taco/storage/storage.h"
+#include "taco/util/strings.h"
+#include "taco/util/timers.h"
+
+using namespace std;
+using namespace taco;
+
+static Tensor<double> createMatrix(int rows, int cols, size_t nnz,
+                                   bool narrowIndices) {
+  Tensor<double> A("A", {rows, cols}, CSR);
+  std::mt19937 random(0);
+  std::uniform_real_distribution<double> values(-1.0, 1.0);
+  vector<vector<int>> coordinates(2, vector<int>(nnz));
+  vector<double> vals(nnz);
+  for (size_t k = 0; k < nnz; k++) {
+    coordinates[0][k] = random() % rows;
+    coordinates[1][k] = random() % cols;
+    vals[k] = values(random);
+  }
+  A.insertBulk(coordinates, vals);
+  A.pack(narrowIndices);
+  return A;
+}
+
+static double getSpMVTime(Tensor<double> A, Tensor<double> x, int repeat) {
+  Var i("i"), j("j", Var::Sum);
+  Tensor<double> y("y", {A.getDimensions()[0]}, Dense);
+  y(i) = A(i,j) * x(j);
+  y.compile();
+  y.assemble();
+
+  util::Timer timer;
+  for (int r = 0; r < repeat; r++) {
+    timer.start();
+    y.compute();
+    timer.stop();
+  }
+  return timer.getResult().median;
+}
+
+int main(int argc, char* argv[]) {
+  size_t nnz = 20000000;
+  int cols = 50000;
+  int repeat = 10;
+  for (int i = 1; i < argc; i++) {
+    vector<string> arg = util::split(argv[i], "=");
+    if (arg.size() == 2 && arg[0] == "-nnz") {
+      nnz = std::stoul(arg[1]);
+    }
+    else if (arg.size() == 2 && arg[0] == "-cols") {
+      cols = std::stoi(arg[1]);
+    }
+    else if (arg.size() == 2 && arg[0] == "-repeat") {
+      repeat = std::stoi(arg[1]);
+    }
+    else {
+      cerr << "Usage: spmv_index_width [-nnz=<n>] [-cols=<n>] [-repeat=<n>]"
+           << endl;
+      return 1;
+    }
+  }
+
+  int rows = (int)std::max(nnz / 50, (size_t)1);
+  Tensor<double> x("x", {cols}, Dense);
+  for (int j = 0; j < cols; j++) {
+    x.insert({j}, 1.0 / (j + 1));
+  }
+  x.pack();
+
+  cout << "Median SpMV time of " << repeat << " runs on a " << rows << "x"
+       << cols << " matrix with " << nnz << " nonzeros" << endl;
+  cout << left << setw(10) << "indices" << right << setw(14) << "index MB"
+       << setw(12) << "time (ms)" << setw(10) << "speedup" << endl;
+  cout << fixed << setprecision(2);
+  double baseline = 0.0;
+  for (bool narrow : {false, true}) {
+    Tensor<double> A = createMatrix(rows, cols, nnz, narrow);
+    auto size = A.getStorage().getSize();
+    double indexBytes = (double)size.numIndexValues(1,1) *
+                        size.numBytesPerIndexValue(1,1);
+    double time = getSpMVTime(A, x, repeat);
+    if (!narrow) {
+      baseline = time;
+    }
+    cout << left << setw(10)
+         << util::toString(A.getFormat().getLevels()[1].getIndexType())
+         << right << setw(14) << indexBytes / 1e6 << setw(12) << time
+         << setw(9) << baseline / time << "x" << endl;
+  }
+  return 0;
+}
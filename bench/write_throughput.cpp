@@ -0,0 +1,158 @@
+/// Measures the throughput of writing .tns and .mtx files on 1, 2, 4, ...
+/// threads.  The benchmark packs a random sparse 3-tensor and a random sparse
+/// matrix and writes them to the temporary directory.  The `iterator` row
+/// writes them one component at a time with a tensor iterator and `std::endl`,
+/// like the writers used to.
+///
+/// Usage: write_throughput [-nnz=<n>] [-threads=<max>] [-repeat=<n>]
+
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <iomanip>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "taco/tensor.h"
+#include "taco/format.h"
+#include "taco/util/env.h"
+#include "taco/util/parallel.h"
+#include "taco/util/strings.h"
+#include "taco/util/timers.h"
+
+using namespace std;
+using namespace taco;
+
+struct Benchmark {
+  string      name;
+  string      filename;
+  FileType    fileType;
+  TensorBase  tensor;
+  size_t      bytes;
+};
+
+static TensorBase createTensor(const vector<int>& dimensions,
+                               const Format& format, size_t nnz) {
+  TensorBase tensor(ComponentType::Double, dimensions, format);
+  std::mt19937 random(0);
+  std::uniform_real_distribution<double> values(-1.0, 1.0);
+  vector<vector<int>> coordinates(dimensions.size(), vector<int>(nnz));
+  vector<double> vals(nnz);
+  for (size_t k = 0; k < nnz; k++) {
+    for (size_t i = 0; i < dimensions.size(); i++) {
+      coordinates[i][k] = random() % dimensions[i];
+    }
+    vals[k] = values(random);
+  }
+  tensor.insertBulk(coordinates, vals);
+  tensor.pack();
+  return tensor;
+}
+
+static void writeIterated(const Benchmark& benchmark) {
+  std::ofstream file(benchmark.filename);
+  const TensorBase& tensor = benchmark.tensor;
+  if (benchmark.fileType == FileType::mtx) {
+    file << "%%MatrixMarket matrix coordinate real general" << endl;
+    file << "%" << endl;
+    file << util::join(tensor.getDimensions(), " ") << " "
+         << tensor.getStorage().getSize().numValues() << endl;
+  }
+  for (auto& value : iterate<double>(tensor)) {
+    for (int coord : value.first) {
+      file << coord+1 << " ";
+    }
+    file << value.second << endl;
+  }
+}
+
+static double getWriteTime(const Benchmark& benchmark, int numThreads,
+                           int repeat) {
+  util::Timer timer;
+  for (int i = 0; i < repeat; i++) {
+    timer.start();
+    if (numThreads > 0) {
+      util::setNumThreads(numThreads);
+      write(benchmark.filename, benchmark.fileType, benchmark.tensor);
+    }
+    else {
+      writeIterated(benchmark);
+    }
+    timer.stop();
+  }
+  return timer.getResult().median;
+}
+
+int main(int argc, char* argv[]) {
+  size_t nnz = 10000000;
+  int maxThreads = (int)std::max(thread::hardware_concurrency(), 1u);
+  int repeat = 3;
+  for (int i = 1; i < argc; i++) {
+    vector<string> arg = util::split(argv[i], "=");
+    if (arg.size() == 2 && arg[0] == "-nnz") {
+      nnz = std::stoul(arg[1]);
+    }
+    else if (arg.size() == 2 && arg[0] == "-threads") {
+      maxThreads = std::stoi(arg[1]);
+    }
+    else if (arg.size() == 2 && arg[0] == "-repeat") {
+      repeat = std::stoi(arg[1]);
+    }
+    else {
+      cerr << "Usage: write_throughput [-nnz=<n>] [-threads=<max>] "
+           << "[-repeat=<n>]" << endl;
+      return 1;
+    }
+  }
+
+  int rows = (int)std::max(nnz / 100, (size_t)1);
+  string tmpdir = util::getTmpdir();
+  vector<Benchmark> benchmarks = {
+    {"tns", tmpdir + "write_throughput.tns", FileType::tns,
+     createTensor({rows, 1000, 1000}, Format({Sparse,Sparse,Sparse}), nnz), 0},
+    {"mtx", tmpdir + "write_throughput.mtx", FileType::mtx,
+     createTensor({rows, rows}, CSR, nnz), 0}
+  };
+  for (auto& benchmark : benchmarks) {
+    write(benchmark.filename, benchmark.fileType, benchmark.tensor);
+    benchmark.bytes = std::ifstream(benchmark.filename,
+                                    std::ios::ate | std::ios::binary).tellg();
+  }
+
+  cout << "Median write throughput (MB/s) of " << repeat << " writes of "
+       << nnz << " nonzeros" << endl;
+  cout << left << setw(12) << "threads";
+  for (auto& benchmark : benchmarks) {
+    cout << right << setw(12) << benchmark.name << setw(10) << "speedup";
+  }
+  cout << endl;
+
+  // Thread count 0 stands for the iterator writer
+  cout << fixed << setprecision(2);
+  vector<double> iteratorTimes;
+  vector<int> threadCounts = {0};
+  for (int numThreads = 1; numThreads <= maxThreads; numThreads *= 2) {
+    threadCounts.push_back(numThreads);
+  }
+  for (int numThreads : threadCounts) {
+    cout << left << setw(12) << (numThreads > 0 ? to_string(numThreads)
+                                                : string("iterator"));
+    for (size_t b = 0; b < benchmarks.size(); b++) {
+      double time = getWriteTime(benchmarks[b], numThreads, repeat);
+      if (numThreads == 0) {
+        iteratorTimes.push_back(time);
+      }
+      double throughput = benchmarks[b].bytes / (time * 1e3);
+      cout << right << setw(12) << throughput << setw(9)
+           << iteratorTimes[b] / time << "x";
+    }
+    cout << endl;
+  }
+
+  for (auto& benchmark : benchmarks) {
+    remove(benchmark.filename.c_str());
+  }
+  return 0;
+}
@@ -0,0 +1,73 @@
+#ifndef TACO_COMPONENT_TYPES_H
+#define TACO_COMPONENT_TYPES_H
+
+#include <cassert>
+#include <cstddef>
+#include <ostream>
+
+namespace taco {
+
+/// Tensor component types. These are basic types such as double and int.
+class ComponentType {
+public:
+  enum Kind {Bool, Int, Float, Double, Unknown};
+  ComponentType() : ComponentType(Unknown) {}
+  ComponentType(Kind kind) : kind(kind)  {}
+  size_t bytes() const;
+  Kind getKind() const;
+private:
+  Kind kind;
+};
+
+bool operator==(const ComponentType& a, const ComponentType& b);
+bool operator!=(const ComponentType& a, const ComponentType& b);
+std::ostream& operator<<(std::ostream&, const ComponentType&);
+template <typename T> inline ComponentType type() {
+  assert(false && "Unsupported type");
+  return ComponentType::Double;
+}
+template <> inline ComponentType type<bool>() {return ComponentType::Bool;}
+template <> inline ComponentType type<int>() {return ComponentType::Int;}
+template <> inline ComponentType type<float>() {return ComponentType::Float;}
+template <> inline ComponentType type<double>() {return ComponentType::Double;}
+
+/// Returns element `i` of a value array whose components have the given type,
+/// converted to double.  Every bool, int and float converts exactly.
+inline double loadValue(const void* values, ComponentType ctype, size_t i) {
+  switch (ctype.getKind()) {
+    case ComponentType::Bool:
+      return ((const bool*)values)[i];
+    case ComponentType::Int:
+      return ((const int*)values)[i];
+    case ComponentType::Float:
+      return ((const float*)values)[i];
+    case ComponentType::Double:
+    case ComponentType::Unknown:
+      break;
+  }
+  return ((const double*)values)[i];
+}
+
+/// Set element `i` of a value array whose components have the given type to
+/// `value`, converted like a C cast.
+inline void storeValue(void* values, ComponentType ctype, size_t i,
+                       double value) {
+  switch (ctype.getKind()) {
+    case ComponentType::Bool:
+      ((bool*)values)[i] = (value != 0.0);
+      break;
+    case ComponentType::Int:
+      ((int*)values)[i] = (int)value;
+      break;
+    case ComponentType::Float:
+      ((float*)values)[i] = (float)value;
+      break;
+    case ComponentType::Double:
+    case ComponentType::Unknown:
+      ((double*)values)[i] = value;
+      break;
+  }
+}
+
+}
+#endif
@@ -15,6 +15,17 @@ enum DimensionType {
   Fixed       // e.g. second dimension in ELL
 };
 
+/// The integer type of the elements of an index array.
+enum class IndexArrayType {
+  Int32,
+  Int64,
+  UInt8,
+  UInt16
+};
+
+/// Returns the size in bytes of an index of the given type.
+size_t getIndexArrayTypeSize(IndexArrayType indexType);
+
 class Format {
 public:
   /// Create a format for a tensor with no dimensions
@@ -33,6 +44,20 @@ public:
   Format(const std::vector<DimensionType>& dimensionTypes,
          const std::vector<int>& dimensionOrder);
 
+  /// Create a tensor format like the above whose positions have the given
+  /// type.  Tensors with more than 2^31 nonzeros need Int64 positions, while
+  /// the default Int32 positions take half the memory and bandwidth.
+  Format(const std::vector<DimensionType>& dimensionTypes,
+         const std::vector<int>& dimensionOrder, IndexArrayType positionType);
+
+  /// Create a tensor format like the above whose levels store their idx arrays
+  /// with the given types, in level order.  UInt8 and UInt16 idx arrays cut
+  /// the memory traffic of sparse and fixed levels of small dimensions, while
+  /// dense levels have no idx array and must be given Int32.
+  Format(const std::vector<DimensionType>& dimensionTypes,
+         const std::vector<int>& dimensionOrder, IndexArrayType positionType,
+         const std::vector<IndexArrayType>& indexTypes);
+
   /// Returns the number of dimensions in the format.
   size_t getOrder() const;
 
@@ -47,6 +72,13 @@ public:
   /// Get the tensor storage levels.
   const std::vector<Level>& getLevels() const {return levels;}
 
+  /// Returns the type of the tensor positions, which are stored in the pos
+  /// arrays of sparse levels and index the arrays of the next level.
+  IndexArrayType getPositionType() const;
+
+  /// Returns the types of the idx arrays of the levels, in level order.
+  std::vector<IndexArrayType> getIndexTypes() const;
+
   // True if all dimensions are Dense
   bool isDense() const;
 
@@ -55,6 +87,7 @@ private:
 
   std::vector<DimensionType> dimensionTypes;
   std::vector<int> dimensionOrder;
+  IndexArrayType positionType = IndexArrayType::Int32;
 };
 
 bool operator==(const Format&, const Format&);
@@ -65,7 +98,9 @@ std::ostream &operator<<(std::ostream&, const Format&);
 
 class Level {
 public:
-  Level(size_t dimension, DimensionType type) : dimension(dimension), type(type) {}
+  Level(size_t dimension, DimensionType type,
+        IndexArrayType indexType=IndexArrayType::Int32)
+      : dimension(dimension), type(type), indexType(indexType) {}
 
   DimensionType getType() const {
     return type;
@@ -75,12 +110,31 @@ public:
     return dimension;
   }
 
+  /// Returns the type of the elements of the level's idx array.
+  IndexArrayType getIndexType() const {
+    return indexType;
+  }
+
 private:
   size_t dimension;  // The tensor dimension described by the format level
   DimensionType type;
+  IndexArrayType indexType;
 };
 
+/// Returns the format with the narrowest idx array type that holds the
+/// coordinates of each sparse and fixed level of a tensor with the given
+/// dimension sizes: UInt8 for dimensions of up to 2^8, UInt16 for dimensions of
+/// up to 2^16, and Int32 otherwise.
+Format getNarrowestIndexFormat(const Format& format,
+                               const std::vector<int>& dimensionSizes);
+
+/// Returns the format of a tensor of the given order that a format with a
+/// single level describes: every dimension gets the level's type and idx array
+/// type, in dimension order, and the position type is kept.
+Format getExpandedFormat(const Format& format, size_t order);
+
 std::ostream& operator<<(std::ostream&, const DimensionType&);
+std::ostream& operator<<(std::ostream&, const IndexArrayType&);
 std::ostream& operator<<(std::ostream&, const Level&);
 
 
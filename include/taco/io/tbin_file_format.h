@@ -0,0 +1,32 @@
+#ifndef IO_TBIN_FILE_FORMAT_H
+#define IO_TBIN_FILE_FORMAT_H
+
+#include <istream>
+#include <ostream>
+#include <string>
+
+namespace taco {
+class TensorBase;
+class Format;
+namespace io {
+namespace tbin {
+
+/// Read a tbin tensor from a file.  The file is memory mapped and the tensor
+/// storage points into the mapping, so the tensor can be used without parsing
+/// or packing.  If `format` differs from the format the file was written in,
+/// the tensor is instead repacked into `format` (when `pack` is true).  The
+/// tensor has the component type it was written with.
+TensorBase read(std::string filename, const Format& format, bool pack = true);
+
+/// Read a tbin tensor from a stream into newly allocated storage.
+TensorBase read(std::istream& stream, const Format& format, bool pack = true);
+
+/// Write a packed tensor to a tbin file.
+void write(std::string filename, const TensorBase& tensor);
+
+/// Write a packed tensor to a stream in the tbin format.
+void write(std::ostream& stream, const TensorBase& tensor);
+
+}}}
+
+#endif
@@ -6,8 +6,12 @@
 #ifndef TACO_STORAGE_PACK_H
 #define TACO_STORAGE_PACK_H
 
+#include <cstddef>
+#include <memory>
 #include <vector>
 
+#include "taco/component_types.h"
+
 namespace taco {
 class Format;
 namespace ir {
@@ -16,19 +20,85 @@ class Stmt;
 namespace storage {
 class Storage;
 
+/// Sort tensor coordinates lexicographically and store them as a structure of
+/// arrays for pack.  The input coordinates are stored as an array of
+/// structures, where each coordinate is `order` ints followed by a double
+/// value.  The coordinates are sorted by dimension `permutation[0]`, then by
+/// dimension `permutation[1]`, and so on, and `(*coordinates)[i]` holds the
+/// coordinates of dimension `permutation[i]`.  The sort is stable and runs on
+/// `util::getNumThreads()` threads.  The sorted arrays are allocated after the
+/// sort has released its scratch arrays.
+void sortCoordinates(const char* buffer, size_t numCoordinates,
+                     const std::vector<int>& permutation,
+                     std::vector<std::vector<int>>* coordinates,
+                     std::vector<double>* values);
+
 /// Pack tensor coordinates into a format. The coordinates must be stored as a
 /// structure of arrays, that is one vector per axis coordinate and one vector
-/// for the values. The coordinates must be sorted lexicographically.
+/// for the values. The coordinates must be sorted lexicographically.  The
+/// sizes of the index arrays are counted before the indices and values are
+/// written into them, and large tensors are packed on `util::getNumThreads()`
+/// threads.  The values are converted to components of type `ctype` as they
+/// are packed, so no array of double values is allocated for other types.
 Storage pack(const std::vector<int>&              dimensionSizes,
              const Format&                        format,
              const std::vector<std::vector<int>>& coordinates,
-             const std::vector<double>            values);
+             const std::vector<double>&           values,
+             ComponentType ctype=ComponentType::Double);
+
+/// Packs coordinates that arrive sorted lexicographically in the level order of
+/// a format straight into index and value arrays, without buffering or sorting
+/// them, so that the arrays are the only copy of the tensor.  Formats with
+/// fixed levels, Int64 positions or narrow index types are not supported, and
+/// the dimension sizes of all dense levels but the first must be known up
+/// front.
+class SortedPacker {
+public:
+  /// Returns true if coordinates can be packed into the format as they arrive.
+  /// Unknown dimension sizes are 0.
+  static bool canPack(const Format& format,
+                      const std::vector<int>& dimensionSizes);
+
+  SortedPacker(const Format& format, const std::vector<int>& dimensionSizes);
+  ~SortedPacker();
+
+  /// Append a coordinate, given in tensor dimension order, and its value.
+  /// Returns false, and packs nothing, if the coordinate does not come
+  /// strictly after the previous one or is out of bounds.
+  bool insert(const int* coordinate, double value);
+
+  /// Finish packing a tensor with the given dimension sizes.  Returns the index
+  /// arrays of each level (none for dense levels) and the values, which are
+  /// allocated with malloc and owned by the caller (e.g. by adopting them with
+  /// TensorBase::adoptStorage).
+  void finish(const std::vector<int>& dimensionSizes,
+              std::vector<std::vector<int*>>* indices, double** values);
+
+private:
+  struct Content;
+  std::unique_ptr<Content> content;
+};
 
 /// Generate code to pack tensor coordinates into a specific format. In the
 /// generated code the coordinates must be stored as a structure of arrays,
 /// that is one vector per axis coordinate and one vector for the values.
-/// The coordinates must be sorted lexicographically.
-ir::Stmt packCode(const Format& format);
+/// The coordinates must be sorted lexicographically.  The generated function
+/// `pack(A, crd0, ..., crdN, vals, cursors, sizes...)` packs the coordinates
+/// [cursors[0],cursors[1]), and level 0 segments [cursors[2],cursors[3]) if
+/// level 0 is dense, into the preallocated index arrays and values of `A`.
+/// It starts writing the segment ends and index values of level i at
+/// cursors[4+i] and cursors[4+order+i], and the values at cursors[4+2*order].
+/// pack uses the generated code for tensors with at least
+/// `$TACO_PACK_CODE_THRESHOLD` coordinates (default 2^22), unless it does not
+/// compile, in which case they are packed by the interpreter.  Fixed levels read
+/// their segment size from the preallocated size array and pad each segment
+/// to it with zeros at the segment's last coordinate, like the interpreted
+/// packer.  The size of each non-empty segment before it is padded is stored
+/// in the `sizes` array of its level, one array per fixed level below level 0.
+/// The double `vals` are converted to components of type `ctype` as they are
+/// stored into `A`.
+ir::Stmt packCode(const Format& format,
+                  ComponentType ctype=ComponentType::Double);
 
 }}
 #endif
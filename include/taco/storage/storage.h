@@ -1,11 +1,15 @@
 #ifndef TACO_STORAGE_H
 #define TACO_STORAGE_H
 
+#include <cstdint>
+#include <functional>
 #include <vector>
 #include <memory>
 
+#include "taco/format.h"
+#include "taco/component_types.h"
+
 namespace taco {
-class Format;
 namespace storage {
 
 /// Storage for a tensor object.  Tensor storage consists of a value array that
@@ -16,26 +20,63 @@ class Storage {
 public:
   class Size;
 
+  /// Releases an index or value array when the storage is destroyed.  Arrays
+  /// that are set without a deleter are owned by the storage and released with
+  /// `free`, so they must be allocated with `malloc`.
+  typedef std::function<void(void*)> Deleter;
+
+  /// A deleter that leaves the array alone, for storage that is a view of
+  /// memory owned and released by someone else.
+  static void unowned(void*) {}
+
   /// Construct an undefined tensor storage.
   Storage();
 
-  /// Construct tensor storage for the given format.
-  Storage(const Format& format);
+  /// Construct tensor storage for the given format, whose value array holds
+  /// components of the given type.
+  Storage(const Format& format, ComponentType ctype=ComponentType::Double);
 
-  /// Set the given index of the given dimension.
+  /// Set the given index of the given dimension.  The storage takes ownership
+  /// of the index arrays.
   void setDimensionIndex(size_t dimension, std::vector<int*> index);
 
-  /// Set the tensor component value array.
+  /// Set the given index of the given dimension to arrays that are released
+  /// with the given deleters, one per array, instead of with `free`.
+  void setDimensionIndex(size_t dimension, std::vector<int*> index,
+                         std::vector<Deleter> deleters);
+
+  /// Set how many index values each segment of the given fixed dimension holds
+  /// before it is padded to the size of the dimension.  The storage takes
+  /// ownership of `sizes`, which has one element per segment and must be
+  /// allocated with `malloc`.
+  void setSegmentSizes(size_t dimension, int* sizes);
+
+  /// Set the tensor component value array.  The storage takes ownership of
+  /// the array.  The array holds components of the storage component type,
+  /// so `vals` must be cast to `double*` unless they are doubles.
   void setValues(double* vals);
 
+  /// Set the tensor component value array to an array that is released with
+  /// the given deleter instead of with `free`.
+  void setValues(double* vals, Deleter deleter);
+
   /// Returns the tensor storage format.
   const Format& getFormat() const;
 
+  /// Returns the type of the tensor components in the value array.
+  ComponentType getComponentType() const;
+
   /// Returns the index of the given dimension.  The index content is determined
   /// by the dimension type, which can be read from the format.
   const std::vector<int*>& getDimensionIndex(size_t dimension) const;
 
-  /// Returns the value array that contains the tensor components.
+  /// Returns how many index values each segment of the given fixed dimension
+  /// holds before it is padded, or nullptr if that is not known because the
+  /// index was not packed by taco.
+  const int* getSegmentSizes(size_t dimension) const;
+
+  /// Returns the value array that contains the tensor components.  It must be
+  /// cast to the component type (see `getComponentType`) before it is read.
   const double* getValues() const;
 
   /// Returns the tensor component value array.
@@ -72,8 +113,12 @@ public:
   private:
     size_t numVals;
     std::vector<std::vector<size_t>> numIndexVals;
+    std::vector<std::vector<size_t>> numBytesPerIndexVal;
+    size_t numBytesPerVal;
 
-    Size(size_t numVals, std::vector<std::vector<size_t>> numIndexVals);
+    Size(size_t numVals, std::vector<std::vector<size_t>> numIndexVals,
+         std::vector<std::vector<size_t>> numBytesPerIndexVal,
+         size_t numBytesPerVal);
     friend Storage::Size Storage::getSize() const;
   };
 
@@ -82,6 +127,43 @@ private:
   std::shared_ptr<Content> content;
 };
 
+/// Returns element `i` of an index array whose elements have the given type.
+/// Index arrays are passed around as `int*`, but the pos arrays of formats
+/// with Int64 positions hold `int64_t` elements and the idx arrays of levels
+/// with narrow index types hold `uint8_t` or `uint16_t` elements.
+inline size_t loadIndex(const int* array, IndexArrayType type, size_t i) {
+  switch (type) {
+    case IndexArrayType::Int64:
+      return (size_t)((const int64_t*)array)[i];
+    case IndexArrayType::UInt8:
+      return ((const uint8_t*)array)[i];
+    case IndexArrayType::UInt16:
+      return ((const uint16_t*)array)[i];
+    case IndexArrayType::Int32:
+      break;
+  }
+  return (size_t)array[i];
+}
+
+/// Set element `i` of an index array whose elements have the given type.
+inline void storeIndex(int* array, IndexArrayType type, size_t i,
+                       size_t value) {
+  switch (type) {
+    case IndexArrayType::Int64:
+      ((int64_t*)array)[i] = (int64_t)value;
+      break;
+    case IndexArrayType::UInt8:
+      ((uint8_t*)array)[i] = (uint8_t)value;
+      break;
+    case IndexArrayType::UInt16:
+      ((uint16_t*)array)[i] = (uint16_t)value;
+      break;
+    case IndexArrayType::Int32:
+      array[i] = (int)value;
+      break;
+  }
+}
+
 /// Print Storage objects to a stream.
 std::ostream& operator<<(std::ostream&, const Storage&);
 
@@ -14,27 +14,53 @@ struct Target {
   
   /// Operating System.  Used when deciding which OS-specific calls to use.
   enum OS {OSUnknown=0, Linux, MacOS, Windows} os;
-  
-  // As we support them, we'll stick in optional features into the target as
-  // well, including things like parallelism model (e.g. openmp, cilk) for
-  // C code generation, and hardware features (e.g. AVX) for LLVM code gen.
+
+  /// Parallelism model of generated C code.  OpenMP kernels are compiled with
+  /// the compiler's OpenMP flags and run their parallel loops on multiple
+  /// threads, while serial kernels ignore the parallel loop pragmas.
+  enum Parallelism {Serial=0, OpenMP} parallelism;
+
+  /// Vector instruction set of generated code.  Generic code only uses the
+  /// instructions that the compiler targets by default (SSE2 on x86-64), while
+  /// AVX2 and AVX512 code uses 256- and 512-bit vectors and only runs on
+  /// machines that support them.
+  enum VectorISA {Generic=0, AVX2, AVX512} isa;
   
   /// Given a string of the form arch-os-features, construct the corresponding
-  /// Target object.
+  /// Target object.  The features are the parallelism model, `openmp` or
+  /// `serial` (the default parallelism if neither is given), and the
+  /// vector instruction set, `avx2` or `avx512`, in any order (e.g.
+  /// `c99-linux-serial-avx2`).
   Target(const std::string &s);
 
-  Target(Arch a, OS o) : arch(a), os(o) {
-    taco_tassert(a == C99 && o != Windows && o != OSUnknown)
+  /// Construct a target with the default parallelism.
+  Target(Arch a, OS o);
+
+  Target(Arch a, OS o, Parallelism p, VectorISA v=Generic)
+      : arch(a), os(o), parallelism(p), isa(v) {
+    taco_tassert(o != Windows && o != OSUnknown)
         << "Unsupported target.";
   }
+
+  /// Returns the parallelism of targets that do not name one: serial, unless
+  /// `TACO_OPENMP_FLAGS` gives the flags to compile OpenMP kernels with.
+  /// Parallel kernels sum reductions in a nondeterministic order and allocate
+  /// per-thread copies of reduced results, so they are opt-in.
+  static Parallelism getDefaultParallelism();
+
+  /// Returns the number of bytes in a vector register of the target's vector
+  /// instruction set, or 0 for generic targets, whose vector width the
+  /// compiler chooses.
+  int getVectorBytes() const;
   
   /// Validate a target string
   static bool validateTargetString(const std::string &s);
   
 };
 
-  /// Gets the target from the environment.  If this is not set in the
-  /// environment, it uses the default C99 backend with the current OS
+  /// Gets the target from the environment variable TACO_TARGET (e.g.
+  /// x86-linux).  If this is not set in the environment, it uses the default
+  /// C99 backend with the current OS
   Target getTargetFromEnvironment();
 
 } // namespace taco
@@ -4,39 +4,27 @@
 #include <memory>
 #include <string>
 #include <vector>
+#include <future>
 #include <cassert>
 
+#include "taco/component_types.h"
 #include "taco/expr.h"
 #include "taco/format.h"
 #include "taco/error.h"
+#include "taco/target.h"
 #include "storage/storage.h"
 
 namespace taco {
 
-/// Tensor component types. These are basic types such as double and int.
-class ComponentType {
-public:
-  enum Kind {Bool, Int, Float, Double, Unknown};
-  ComponentType() : ComponentType(Unknown) {}
-  ComponentType(Kind kind) : kind(kind)  {}
-  size_t bytes() const;
-  Kind getKind() const;
-private:
-  Kind kind;
-};
-
-bool operator==(const ComponentType& a, const ComponentType& b);
-bool operator!=(const ComponentType& a, const ComponentType& b);
-std::ostream& operator<<(std::ostream&, const ComponentType&);
-template <typename T> inline ComponentType type() {
-  assert(false && "Unsupported type");
-  return ComponentType::Double;
-}
-template <> inline ComponentType type<bool>() {return ComponentType::Bool;}
-template <> inline ComponentType type<int>() {return ComponentType::Int;}
-template <> inline ComponentType type<float>() {return ComponentType::Float;}
-template <> inline ComponentType type<double>() {return ComponentType::Double;}
+/// How the parallel outer loop of a kernel splits its iterations among threads.
+enum class ParallelSchedule {
+  /// Every thread gets the same number of iterations (e.g. rows).
+  Rows,
 
+  /// Every thread gets the same number of nonzeros of the sparse operand that
+  /// the loop iterates over, so rows may be split between threads.
+  Nonzeros
+};
 
 /// TensorBase is the super-class for all tensors. You can use it directly to
 /// avoid templates, or you can use the templated `Tensor<T>` that inherits from
@@ -87,13 +75,26 @@ public:
   void reserve(size_t numCoordinates);
 
   /// Insert a value into the tensor. The number of coordinates must match the
-  /// tensor dimension.
+  /// tensor dimension.  The value is converted to the tensor component type
+  /// when the tensor is packed.
   void insert(const std::initializer_list<int>& coordinate, double value);
 
   /// Insert a value into the tensor. The number of coordinates must match the
   /// tensor dimension.
   void insert(const std::vector<int>& coordinate, double value);
 
+  /// Insert many values into the tensor at once.  `coordinates[i]` holds the
+  /// mode i coordinates of the values, so there must be one coordinate vector
+  /// per tensor dimension, each with one coordinate per value.
+  void insertBulk(const std::vector<std::vector<int>>& coordinates,
+                  const std::vector<double>& values);
+
+  /// Insert `numCoordinates` values into the tensor at once, given as COO
+  /// arrays: `coordinates[i]` points to the mode i coordinates of the values.
+  /// For example, `insertBulk({rows, cols}, vals, nnz)` inserts a matrix.
+  void insertBulk(const std::vector<const int*>& coordinates,
+                  const double* values, size_t numCoordinates);
+
   /// Returns the storage for this tensor. Tensor values are stored according
   /// to the format of the tensor.
   const storage::Storage& getStorage() const;
@@ -102,14 +103,32 @@ public:
   /// to the format of the tensor.
   storage::Storage& getStorage();
 
-  void setCSR(double* vals, int* rowPtr, int* colIdx);
+  /// Set the tensor storage to index and value arrays allocated by the caller,
+  /// without copying them.  `indices[i]` holds the arrays of format level i:
+  /// none for a dense level and the pos and idx arrays for a sparse or fixed
+  /// level.  The pos arrays of a format with Int64 positions must hold
+  /// `int64_t` elements, and `vals` must hold components of the tensor
+  /// component type.  The arrays are released with `deleter` (e.g.
+  /// `storage::Storage::unowned` to view memory owned elsewhere) when the
+  /// tensor no longer uses them, or with `free` if no deleter is given.  The
+  /// previous storage of the tensor is released.
+  void adoptStorage(const std::vector<std::vector<int*>>& indices,
+                    double* vals,
+                    storage::Storage::Deleter deleter=nullptr);
+
+  void setCSR(double* vals, int* rowPtr, int* colIdx,
+              storage::Storage::Deleter deleter=nullptr);
   void getCSR(double** vals, int** rowPtr, int** colIdx);
 
-  void setCSC(double* vals, int* colPtr, int* rowIdx);
+  void setCSC(double* vals, int* colPtr, int* rowIdx,
+              storage::Storage::Deleter deleter=nullptr);
   void getCSC(double** vals, int** colPtr, int** rowIdx);
 
-  /// Pack tensor into the given format
-  void pack();
+  /// Pack tensor into the given format.  If `narrowIndices` is true, the idx
+  /// arrays of sparse and fixed levels are packed with the narrowest type that
+  /// holds their coordinates (see `getNarrowestIndexFormat`), and the tensor
+  /// takes on that format.
+  void pack(bool narrowIndices=false);
 
   /// Zero out the values
   void zero();
@@ -129,9 +148,20 @@ public:
   /// Set the expression to be evaluated when calling compute or assemble.
   void setExpr(const std::vector<taco::Var>& indexVars, taco::Expr expr);
 
-  /// Compile the tensor expression.
+  /// Compile the tensor expression.  Tensors whose expressions only differ in
+  /// tensor and index variable names, and that have the same formats and
+  /// dimensions, share the compiled kernels.  Operands with fixed (ELL) levels
+  /// must be packed, since the size of their segments is compiled in.
   void compile();
 
+  /// Compile the tensor expression in the background on the compile thread
+  /// pool.  The expression is lowered before returning, after which the
+  /// operands may be packed while the kernels compile, except for operands
+  /// with fixed (ELL) levels, which must be packed before the call.
+  /// assemble() and compute() wait for the compilation to finish.  The
+  /// returned future is ready when the kernels are compiled.
+  std::shared_future<void> compileAsync();
+
   /// Assemble the tensor storage, including index and value arrays.
   void assemble();
 
@@ -163,6 +193,48 @@ public:
   /// Get the size of the initial index allocations.
   size_t getAllocSize() const;
 
+  /// Set the type of the temporaries that the tensor's kernels accumulate
+  /// reductions in, e.g. double to sum the products of float operands in
+  /// double precision.  The sums are converted to the tensor component type
+  /// when they are stored.  The default is the tensor component type.
+  /// Reductions that the kernels accumulate directly in the result values,
+  /// which they do when a free variable is nested inside the reduction
+  /// variables, are computed in the component type.
+  void setAccumulatorType(ComponentType ctype) const;
+
+  /// Get the type of the temporaries that the tensor's kernels accumulate
+  /// reductions in.
+  ComponentType getAccumulatorType() const;
+
+  /// Set the target that compile() generates code for.  The C99 target
+  /// compiles generated C code with the system compiler, while machine targets
+  /// (e.g. x86) compile in-process with the LLVM backend.  The default is
+  /// given by getTargetFromEnvironment().
+  void setTarget(const Target& target) const;
+
+  /// Get the target that compile() generates code for.
+  Target getTarget() const;
+
+  /// Set the number of threads that the parallel loops of the tensor's
+  /// kernels run on, which only OpenMP targets parallelize.  The default, 0,
+  /// uses util::getNumThreads().
+  void setNumThreads(int numThreads) const;
+
+  /// Get the number of threads that the tensor's kernels run on.
+  int getNumThreads() const;
+
+  /// Set how the parallel outer loop of the tensor's kernels splits its
+  /// iterations among threads.  The default, ParallelSchedule::Rows, splits
+  /// the rows evenly.  ParallelSchedule::Nonzeros splits the nonzeros of a
+  /// CSR-like operand evenly, which balances matrices with skewed rows, for
+  /// kernels like SpMV whose outer loop iterates over the rows of the operand
+  /// and computes a dense vector; other kernels split the rows.
+  void setParallelSchedule(ParallelSchedule schedule) const;
+
+  /// Get how the parallel outer loop of the tensor's kernels splits its
+  /// iterations among threads.
+  ParallelSchedule getParallelSchedule() const;
+
   /// True iff two tensors have the same type and the same values.
   friend bool equals(const TensorBase&, const TensorBase&);
 
@@ -192,6 +264,9 @@ private:
 
   void assembleInternal();
   void computeInternal();
+
+  /// Wait for a compilation started by compileAsync() to finish.
+  void waitForCompile() const;
 };
 
 
@@ -208,8 +283,11 @@ public:
   /// Create a scalar with the given name
   explicit Tensor(std::string name) : TensorBase(name, type<CType>()) {}
 
-  /// Create a scalar double
-  explicit Tensor(CType value) : TensorBase(value) {}
+  /// Create a scalar with the given value
+  explicit Tensor(CType value) : TensorBase(type<CType>()) {
+    this->insert({}, (double)value);
+    pack();
+  }
 
   /// Create a tensor with the given dimensions and format
   Tensor(std::vector<int> dimensions, Format format=Sparse)
@@ -270,7 +348,7 @@ public:
     const_iterator(const Tensor<CType>* tensor, bool isEnd = false) : 
         tensor(tensor),
         coord(std::vector<int>(tensor->getOrder())),
-        ptrs(std::vector<int>(tensor->getOrder())),
+        ptrs(std::vector<size_t>(tensor->getOrder())),
         curVal({std::vector<int>(tensor->getOrder()), 0}),
         count(1 + (size_t)isEnd * tensor->getStorage().getSize().numValues()),
         advance(false) {
@@ -285,6 +363,7 @@ public:
     bool advanceIndex(size_t lvl) {
       const auto& dimTypes = tensor->getFormat().getDimensionTypes();
       const auto& dimOrder = tensor->getFormat().getDimensionOrder();
+      const auto& levels   = tensor->getFormat().getLevels();
 
       if (lvl == tensor->getOrder()) {
         if (advance) {
@@ -293,7 +372,8 @@ public:
         }
 
         const size_t idx = (lvl == 0) ? 0 : ptrs[lvl - 1];
-        curVal.second = tensor->getStorage().getValues()[idx];
+        curVal.second =
+            ((const CType*)tensor->getStorage().getValues())[idx];
 
         for (size_t i = 0; i < lvl; ++i) {
           const size_t dim = dimOrder[i];
@@ -330,13 +410,16 @@ public:
           const auto& segs = index[0];
           const auto& vals = index[1];
           const auto  k    = (lvl == 0) ? 0 : ptrs[lvl - 1];
+          const auto  type = tensor->getFormat().getPositionType();
+          const auto  idxType = levels[lvl].getIndexType();
 
           if (advance) {
             goto resume_sparse;
           }
 
-          for (ptrs[lvl] = segs[k]; ptrs[lvl] < segs[k + 1]; ++ptrs[lvl]) {
-            coord[lvl] = vals[ptrs[lvl]];
+          for (ptrs[lvl] = storage::loadIndex(segs, type, k);
+               ptrs[lvl] < storage::loadIndex(segs, type, k + 1); ++ptrs[lvl]) {
+            coord[lvl] = (int)storage::loadIndex(vals, idxType, ptrs[lvl]);
 
           resume_sparse:
             if (advanceIndex(lvl + 1)) {
@@ -349,14 +432,16 @@ public:
           const auto  elems = index[0][0];
           const auto  base  = (lvl == 0) ? 0 : (ptrs[lvl - 1] * elems);
           const auto& vals  = index[1];
+          const auto  idxType = levels[lvl].getIndexType();
 
           if (advance) {
             goto resume_fixed;
           }
 
-          for (ptrs[lvl] = base; 
-               ptrs[lvl] < base + elems && vals[ptrs[lvl]] >= 0; ++ptrs[lvl]) {
-            coord[lvl] = vals[ptrs[lvl]];
+          for (ptrs[lvl] = base; ptrs[lvl] < base + elems &&
+               (int)storage::loadIndex(vals, idxType, ptrs[lvl]) >= 0;
+               ++ptrs[lvl]) {
+            coord[lvl] = (int)storage::loadIndex(vals, idxType, ptrs[lvl]);
 
           resume_fixed:
             if (advanceIndex(lvl + 1)) {
@@ -375,7 +460,7 @@ public:
 
     const Tensor<CType>*              tensor;
     std::vector<int>                  coord;
-    std::vector<int>                  ptrs;
+    std::vector<size_t>               ptrs;
     std::pair<std::vector<int>,CType> curVal;
     size_t                            count;
     bool                              advance;
@@ -411,7 +496,12 @@ enum class FileType {
   ttx,
 
   /// .rb  - The rutherford-boeing sparse matrix format.
-  rb
+  rb,
+
+  /// .tbin - A binary dump of packed tensor storage: the format, dimensions,
+  ///         index arrays and values.  The arrays are aligned so that the file
+  ///         can be memory mapped, which loads it without parsing or packing.
+  tbin
 };
 
 /// Read a tensor from a file. The file format is inferred from the filename
@@ -1,6 +1,9 @@
 #ifndef SRC_UTIL_ENV_H_
 #define SRC_UTIL_ENV_H_
 
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
 #include <string>
 #include <unistd.h>
 
@@ -9,6 +12,7 @@
 namespace taco {
 namespace util {
 std::string getFromEnv(std::string flag, std::string dflt);
+size_t getSizeFromEnv(std::string flag, size_t dflt);
 std::string getTmpdir();
 
 inline std::string getFromEnv(std::string flag, std::string dflt) {
@@ -20,6 +24,26 @@ inline std::string getFromEnv(std::string flag, std::string dflt) {
   }
 }
 
+/// Returns the non-negative integer in the environment variable `flag`, or
+/// `dflt` if it is not set.  A value that is not such an integer is ignored
+/// with a warning, and `dflt` is returned instead.
+inline size_t getSizeFromEnv(std::string flag, size_t dflt) {
+  char const *value = getenv(flag.c_str());
+  if (!value) {
+    return dflt;
+  }
+  char* end = nullptr;
+  errno = 0;
+  unsigned long long size = strtoull(value, &end, 10);
+  if (end == value || *end != '\0' || errno == ERANGE ||
+      strchr(value, '-') != nullptr) {
+    taco_uwarning << "Ignoring " << flag << "=" << value << ", which is not "
+                  << "a non-negative integer, and using " << dflt;
+    return dflt;
+  }
+  return (size_t)size;
+}
+
 inline std::string getTmpdir() {
   // use POSIX logic for finding a temp dir
   auto tmpdir = getFromEnv("TMPDIR", "/tmp/");
@@ -1,6 +1,7 @@
 #ifndef TACO_UTIL_INTRUSIVE_PTR_H
 #define TACO_UTIL_INTRUSIVE_PTR_H
 
+#include <atomic>
 #include <iostream>
 
 namespace taco {
@@ -130,7 +131,8 @@ class Manageable {
   friend void acquire(const Data *data) { ++data->ref; }
   friend void release(const Data *data) { if (--data->ref == 0) delete data; }
 
-  mutable long ref = 0;
+  // Atomic, so that expressions can be shared by concurrent compilations
+  mutable std::atomic<long> ref{0};
 };
 
 }} // namespace simit::util
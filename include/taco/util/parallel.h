@@ -0,0 +1,33 @@
+#ifndef TACO_UTIL_PARALLEL_H
+#define TACO_UTIL_PARALLEL_H
+
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+
+namespace taco {
+namespace util {
+
+/// Returns the number of threads that taco uses for parallel work on the host,
+/// such as packing tensors.  The default is `$TACO_NUM_THREADS`, or else the
+/// number of hardware threads.
+int getNumThreads();
+
+/// Returns the number of threads to split `size` items of work between, such
+/// that every thread gets at least `grainSize` items.
+int getNumThreads(size_t size, size_t grainSize);
+
+/// Set the number of threads that taco uses for parallel work on the host.
+void setNumThreads(int numThreads);
+
+/// Call `body(thread)` for every thread in [0,numThreads) concurrently.  Thread
+/// 0 runs on the calling thread.
+void parallelFor(int numThreads, const std::function<void(int)>& body);
+
+/// Returns the start of the `part`th of `numParts` equal parts of [0,size).
+inline size_t partition(size_t size, int part, int numParts) {
+  return (size / numParts) * part + std::min(size % numParts, (size_t)part);
+}
+
+}}
+#endif
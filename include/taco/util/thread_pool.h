@@ -0,0 +1,43 @@
+#ifndef TACO_UTIL_THREAD_POOL_H
+#define TACO_UTIL_THREAD_POOL_H
+
+#include <queue>
+#include <mutex>
+#include <vector>
+#include <thread>
+#include <future>
+#include <functional>
+#include <condition_variable>
+
+namespace taco {
+namespace util {
+
+/// A fixed number of worker threads that run submitted tasks in the order
+/// they were submitted.
+class ThreadPool {
+public:
+  /// Create a pool with `numThreads` worker threads (at least one).
+  explicit ThreadPool(size_t numThreads);
+
+  /// Run the queued tasks to completion and join the worker threads.
+  ~ThreadPool();
+
+  /// Queue a task.  The returned future becomes ready when the task has run,
+  /// and rethrows any exception thrown by the task.
+  std::future<void> submit(std::function<void()> task);
+
+  /// Returns the number of worker threads.
+  size_t getNumThreads() const;
+
+private:
+  std::vector<std::thread> workers;
+  std::queue<std::packaged_task<void()>> tasks;
+  std::mutex mutex;
+  std::condition_variable available;
+  bool stopping = false;
+
+  void work();
+};
+
+}}
+#endif
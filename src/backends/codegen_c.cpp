@@ -19,19 +19,48 @@ namespace {
 
 // Include stdio.h for printf
 // stdlib.h for malloc/realloc
+// stdbool.h for bool components
 // math.h for sqrt
-// MIN preprocessor macro
+// MIN and MAX preprocessor macros
+// omp.h and thread macros for the private copies of parallel reductions
+// vectorization hints for clang (loop pragmas) and GCC (ivdep), but no
+// alignment hints: arrays may be adopted, memory mapped or realloc'ed, and
+// sparse segments start at any position, so vector accesses are unaligned
 // This *must* be kept in sync with taco_tensor_t.h
 const string cHeaders = "#ifndef TACO_C_HEADERS\n"
                  "#define TACO_C_HEADERS\n"
                  "#include <stdio.h>\n"
                  "#include <stdlib.h>\n"
                  "#include <stdint.h>\n"
+                 "#include <stdbool.h>\n"
                  "#include <math.h>\n"
                  "#define TACO_MIN(_a,_b) ((_a) < (_b) ? (_a) : (_b))\n"
+                 "#define TACO_MAX(_a,_b) ((_a) > (_b) ? (_a) : (_b))\n"
+                 "#ifdef _OPENMP\n"
+                 "#include <omp.h>\n"
+                 "#define TACO_MAX_THREADS omp_get_max_threads()\n"
+                 "#define TACO_THREAD_NUM omp_get_thread_num()\n"
+                 "#else\n"
+                 "#define TACO_MAX_THREADS 1\n"
+                 "#define TACO_THREAD_NUM 0\n"
+                 "#endif\n"
+                 "#define TACO_PRAGMA(_x) _Pragma(#_x)\n"
+                 "#if defined(__clang__)\n"
+                 "#define TACO_VECTORIZE TACO_PRAGMA(clang loop "
+                 "vectorize(enable) interleave(enable))\n"
+                 "#define TACO_VECTORIZE_WIDTH(_w) TACO_PRAGMA(clang loop "
+                 "vectorize_width(_w) interleave(enable))\n"
+                 "#elif defined(__GNUC__)\n"
+                 "#define TACO_VECTORIZE TACO_PRAGMA(GCC ivdep)\n"
+                 "#define TACO_VECTORIZE_WIDTH(_w) TACO_PRAGMA(GCC ivdep)\n"
+                 "#else\n"
+                 "#define TACO_VECTORIZE\n"
+                 "#define TACO_VECTORIZE_WIDTH(_w)\n"
+                 "#endif\n"
                  "#ifndef TACO_TENSOR_T_DEFINED\n"
                  "#define TACO_TENSOR_T_DEFINED\n"
-                 "typedef enum { taco_dim_dense, taco_dim_sparse } taco_dim_t;\n"
+                 "typedef enum { taco_dim_dense, taco_dim_sparse, "
+                 "taco_dim_fixed } taco_dim_t;\n"
                  "\n"
                  "typedef struct {\n"
                  "  int32_t     order;      // tensor order (number of dimensions)\n"
@@ -164,9 +193,18 @@ string toCType(Type type, bool is_ptr) {
 
   switch (type.kind) {
     case Type::Int:
-      ret = "int"; //TODO: should use a specific width here
+      ret = (type.bits == 64) ? "int64_t" : "int";
       break;
     case Type::UInt:
+      if (type.bits == 1) {
+        ret = "bool";
+      }
+      else if (type.bits == 8) {
+        ret = "uint8_t";
+      }
+      else if (type.bits == 16) {
+        ret = "uint16_t";
+      }
       break;
     case Type::Float:
       if (type.bits == 32) {
@@ -196,8 +234,8 @@ string unpackTensorProperty(string varname, const GetProperty* op,
   auto tensor = op->tensor.as<Var>();
   if (op->property == TensorProperty::Values) {
     // for the values, it's in the last slot
-    ret << toCType(tensor->type, true);
-    ret << " restrict " << varname << " = (double*)(";
+    string tp = toCType(tensor->type, true);
+    ret << tp << " restrict " << varname << " = (" << tp << ")(";
     ret << tensor->name << "->vals);\n";
     return ret.str();
   }
@@ -210,19 +248,19 @@ string unpackTensorProperty(string varname, const GetProperty* op,
   
   // for a Dense level, nnz is an int
   // for a Fixed level, ptr is an int
-  // all others are int*
+  // all others are arrays of the property type
   if ((levels[op->dim].getType() == DimensionType::Dense &&
       op->property == TensorProperty::Pointer)
       ||(levels[op->dim].getType() == DimensionType::Fixed &&
       op->property == TensorProperty::Pointer)) {
     tp = "int";
-    ret << tp << " " << varname << " = *(" <<
+    ret << tp << " " << varname << " = *(int*)(" <<
       tensor->name << "->indices[" << op->dim << "][0]);\n";
   } else {
-    tp = "int*";
+    tp = toCType(op->type, true);
     auto nm = op->property == TensorProperty::Pointer ? "[0]" : "[1]";
     ret << tp << " restrict " << varname << " = ";
-    ret << "(int*)(" << tensor->name << "->indices[" << op->dim;
+    ret << "(" << tp << ")(" << tensor->name << "->indices[" << op->dim;
     ret << "]" << nm << ");\n";
   }
   
@@ -328,7 +366,8 @@ string printPack(map<tuple<Expr, TensorProperty, int>,
 
 // seed the unique names with all C99 keywords
 // from: http://en.cppreference.com/w/c/keyword
-map<string, int> uniqueNameCounters;
+// (thread local, since modules may be compiled concurrently)
+thread_local map<string, int> uniqueNameCounters;
 
 void resetUniqueNameCounters() {
   uniqueNameCounters =
@@ -514,13 +553,15 @@ void CodeGen_C::visit(const Var* op) {
   out << varMap[op];
 }
 
+// Vectorization hints are macros that expand to the pragmas of the compiler
+// (see cHeaders).  GCC has no pragma that sets the vector width, so it only
+// learns that the iterations are independent.
 static string genVectorizePragma(int width) {
   stringstream ret;
-  ret << "#pragma clang loop interleave(enable) ";
   if (!width)
-    ret << "vectorize(enable)";
+    ret << "TACO_VECTORIZE";
   else
-    ret << "vectorize_width(" << width << ")";
+    ret << "TACO_VECTORIZE_WIDTH(" << width << ")";
   
   return ret.str();
 }
@@ -531,11 +572,97 @@ static string getParallelizePragma() {
   return ret.str();
 }
 
+// Loops with reductions into arrays add into a private copy of each array per
+// thread.  The copies are allocated on the heap, since OpenMP array section
+// reductions allocate them on the (small) stacks of the threads.
+void CodeGen_C::genArrayReductions(const For* op) {
+  struct Privatized {
+    string array, copies, size, type;
+  };
+  vector<Privatized> privatized;
+  vector<string> scalars;
+  string numThreads = genUniqueName("num_threads");
+  doIndent();
+  stream << "int " << numThreads << " = TACO_MAX_THREADS;\n";
+  for (auto& reduction : op->reductions) {
+    if (!reduction.second.defined()) {
+      scalars.push_back(varMap[reduction.first]);
+      continue;
+    }
+    Privatized copy;
+    copy.array  = varMap[reduction.first];
+    copy.copies = genUniqueName(copy.array + "_private");
+    copy.size   = genUniqueName(copy.array + "_size");
+    copy.type   = toCType(reduction.first.type(), false);
+    doIndent();
+    stream << "int64_t " << copy.size << " = ";
+    reduction.second.accept(this);
+    stream << ";\n";
+    doIndent();
+    stream << copy.type << "* restrict " << copy.copies << " = ("
+           << copy.type << "*)calloc(" << numThreads << " * " << copy.size
+           << ", sizeof(" << copy.type << "));\n";
+    privatized.push_back(copy);
+  }
+
+  doIndent();
+  stream << "#pragma omp parallel\n";
+  doIndent();
+  stream << "{\n";
+  indent++;
+  for (auto& copy : privatized) {
+    doIndent();
+    stream << copy.type << "* restrict " << copy.array << " = " << copy.copies
+           << " + TACO_THREAD_NUM * " << copy.size << ";\n";
+  }
+  doIndent();
+  stream << "#pragma omp for";
+  for (auto& scalar : scalars) {
+    stream << " reduction(+:" << scalar << ")";
+  }
+  stream << "\n";
+  IRPrinter::visit(op);
+  stream << "\n";
+  indent--;
+  doIndent();
+  stream << "}\n";
+
+  for (auto& copy : privatized) {
+    string i = genUniqueName(copy.array + "_i");
+    string t = genUniqueName("thread");
+    doIndent();
+    stream << getParallelizePragma() << "\n";
+    doIndent();
+    stream << "for (int64_t " << i << " = 0; " << i << " < " << copy.size
+           << "; " << i << "++) {\n";
+    indent++;
+    doIndent();
+    stream << "for (int " << t << " = 0; " << t << " < " << numThreads
+           << "; " << t << "++) {\n";
+    indent++;
+    doIndent();
+    stream << copy.array << "[" << i << "] += " << copy.copies << "[" << t
+           << " * " << copy.size << " + " << i << "];\n";
+    indent--;
+    doIndent();
+    stream << "}\n";
+    indent--;
+    doIndent();
+    stream << "}\n";
+    doIndent();
+    stream << "free(" << copy.copies << ");";
+    if (&copy != &privatized.back()) {
+      stream << "\n";
+    }
+  }
+}
+
 // The next two need to output the correct pragmas depending
 // on the loop kind (Serial, Parallel, Vectorized)
 //
 // Docs for vectorization pragmas:
 // http://clang.llvm.org/docs/LanguageExtensions.html#extensions-for-loop-hint-optimizations
+// https://gcc.gnu.org/onlinedocs/gcc/Loop-Specific-Pragmas.html
 void CodeGen_C::visit(const For* op) {
   if (op->kind == LoopKind::Vectorized) {
     doIndent();
@@ -544,8 +671,17 @@ void CodeGen_C::visit(const For* op) {
   }
 
   if (op->kind == LoopKind::Parallel) {
+    for (auto& reduction : op->reductions) {
+      if (reduction.second.defined()) {
+        genArrayReductions(op);
+        return;
+      }
+    }
     doIndent();
     out << getParallelizePragma();
+    for (auto& reduction : op->reductions) {
+      out << " reduction(+:" << varMap[reduction.first] << ")";
+    }
     out << "\n";
   }
   
@@ -589,6 +725,14 @@ void CodeGen_C::visit(const Min* op) {
 
 }
 
+void CodeGen_C::visit(const Max* op) {
+  stream << "TACO_MAX(";
+  op->a.accept(this);
+  stream << ",";
+  op->b.accept(this);
+  stream << ")";
+}
+
 void CodeGen_C::visit(const Allocate* op) {
   string elementType = toCType(op->var.type(), false);
 
@@ -612,9 +756,16 @@ void CodeGen_C::visit(const Allocate* op) {
 }
 
 void CodeGen_C::visit(const Sqrt* op) {
-  taco_tassert(op->type.isFloat() && op->type.bits == 64) <<
-      "Codegen doesn't currently support non-double sqrt";
-  stream << "sqrt(";
+  // Integer square roots are computed in double and truncated
+  if (op->type.isFloat() && op->type.bits == 32) {
+    stream << "sqrtf(";
+  }
+  else if (op->type.isFloat()) {
+    stream << "sqrt(";
+  }
+  else {
+    stream << "(" << toCType(op->type, false) << ")sqrt(";
+  }
   op->a.accept(this);
   stream << ")";
 }
@@ -632,7 +783,7 @@ void CodeGen_C::generateShim(const Stmt* f, stringstream &ret) {
     : toCType(var->type, var->is_ptr);
     
     ret << "(" << cast_type << ")(parameterPack[" << i++ << "])";
-    if (i <= func->outputs.size() || func->inputs.size() > 0)
+    if (i < func->outputs.size() || func->inputs.size() > 0)
       ret << ", ";
   }
   for (auto input : func->inputs) {
@@ -640,7 +791,7 @@ void CodeGen_C::generateShim(const Stmt* f, stringstream &ret) {
     auto cast_type = var->is_tensor ? "taco_tensor_t*"
     : toCType(var->type, var->is_ptr);
     ret << "(" << cast_type << ")(parameterPack[" << i++ << "])";
-    if (i <= func->inputs.size()) {
+    if (i < func->outputs.size() + func->inputs.size()) {
       ret << ", ";
     }
   }
@@ -39,9 +39,14 @@ protected:
   void visit(const While*);
   void visit(const GetProperty*);
   void visit(const Min*);
+  void visit(const Max*);
   void visit(const Allocate*);
   void visit(const Sqrt*);
 
+  /// Generate a parallel loop whose threads add into private copies of its
+  /// array reductions
+  void genArrayReductions(const For*);
+
   std::map<Expr, std::string, ExprCompare> varMap;
   std::ostream &out;
   
@@ -0,0 +1,895 @@
+#include "codegen_llvm.h"
+
+#include <map>
+#include <set>
+#include <mutex>
+#include <algorithm>
+#include <tuple>
+#include <cstddef>
+#include <cstdint>
+
+#include "llvm/ExecutionEngine/Orc/LLJIT.h"
+#include "llvm/ExecutionEngine/Orc/ExecutionUtils.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include "llvm/IR/Verifier.h"
+#include "llvm/Passes/PassBuilder.h"
+#include "llvm/Support/TargetSelect.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Target/TargetMachine.h"
+
+#include "ir/ir_visitor.h"
+#include "ir/simplify.h"
+#include "taco/error.h"
+
+extern "C" {
+#include "taco_tensor_t.h"
+}
+
+using namespace std;
+
+namespace taco {
+namespace ir {
+
+namespace {
+
+// Print formats are C string literals
+string unescape(const string& fmt) {
+  string str;
+  for (size_t i = 0; i < fmt.size(); i++) {
+    if (fmt[i] == '\\' && i+1 < fmt.size()) {
+      switch (fmt[++i]) {
+        case 'n': str += '\n'; break;
+        case 't': str += '\t'; break;
+        default:  str += fmt[i]; break;
+      }
+    }
+    else {
+      str += fmt[i];
+    }
+  }
+  return str;
+}
+
+bool hasStore(Stmt stmt) {
+  struct StoreFinder : public IRVisitor {
+    using IRVisitor::visit;
+    bool hasStore = false;
+    void visit(const Store*) {
+      hasStore = true;
+    }
+  };
+  StoreFinder storeFinder;
+  stmt.accept(&storeFinder);
+  return storeFinder.hasStore;
+}
+
+/// Find the distinct tensor properties used by a function, in the order they
+/// are first used.
+class FindProperties : public IRVisitor {
+public:
+  vector<const GetProperty*> properties;
+  set<tuple<const IRNode*, TensorProperty, size_t>> keys;
+
+protected:
+  using IRVisitor::visit;
+  void visit(const GetProperty* op) {
+    if (keys.insert(make_tuple(op->tensor.ptr, op->property, op->dim)).second) {
+      properties.push_back(op);
+    }
+  }
+};
+
+/// Generates LLVM IR for lowered functions, mirroring the C code generated by
+/// CodeGen_C: tensor properties are unpacked into locals at function entry,
+/// and the properties of output tensors are packed back before returning.
+class LLVMGenerator : public IRVisitorStrict {
+public:
+  LLVMGenerator(llvm::LLVMContext& context, llvm::Module* module)
+      : context(context), module(module), builder(context) {
+    // Matches the default -ffast-math of the C backend
+    builder.setFastMathFlags(llvm::FastMathFlags::getFast());
+  }
+
+  void compile(Stmt stmt) {
+    stmt.accept(this);
+  }
+
+  void generateShim(const Function* func) {
+    llvm::Function* f = module->getFunction(func->name);
+    llvm::Type* voidPtrPtr = builder.getInt8PtrTy()->getPointerTo();
+    llvm::Function* shim = llvm::Function::Create(
+        llvm::FunctionType::get(builder.getInt32Ty(), {voidPtrPtr}, false),
+        llvm::Function::ExternalLinkage, "_shim_" + func->name, module);
+    builder.SetInsertPoint(llvm::BasicBlock::Create(context, "entry", shim));
+
+    vector<llvm::Value*> args;
+    llvm::Value* parameterPack = shim->getArg(0);
+    for (size_t i = 0; i < f->arg_size(); i++) {
+      llvm::Value* param = builder.CreateLoad(builder.getInt8PtrTy(),
+          builder.CreateConstInBoundsGEP1_64(builder.getInt8PtrTy(),
+                                             parameterPack, i));
+      llvm::Type* paramType = f->getArg(i)->getType();
+      args.push_back(paramType->isPointerTy()
+                     ? builder.CreateBitCast(param, paramType)
+                     : builder.CreatePtrToInt(param, paramType));
+    }
+    builder.CreateRet(builder.CreateCall(f, args));
+  }
+
+protected:
+  llvm::LLVMContext& context;
+  llvm::Module* module;
+  llvm::IRBuilder<> builder;
+
+  llvm::Function* function = nullptr;
+  llvm::BasicBlock* entry = nullptr;
+  llvm::Value* value = nullptr;
+
+  map<const Var*, llvm::Value*> tensors;
+  map<const Var*, llvm::AllocaInst*> vars;
+  map<tuple<const IRNode*,TensorProperty,size_t>, llvm::AllocaInst*> properties;
+
+  llvm::Type* toLLVMType(Type type, bool is_ptr=false) {
+    llvm::Type* ret = nullptr;
+    switch (type.kind) {
+      case Type::UInt:
+      case Type::Int:
+        ret = type.isBool() ? builder.getInt1Ty()
+                            : builder.getIntNTy(type.bits);
+        break;
+      case Type::Float:
+        if (type.bits == 32) {
+          ret = builder.getFloatTy();
+        }
+        else if (type.bits == 64) {
+          ret = builder.getDoubleTy();
+        }
+        break;
+    }
+    taco_iassert(ret != nullptr) << "Unknown type in codegen";
+    return is_ptr ? ret->getPointerTo() : ret;
+  }
+
+  llvm::Value* codegen(Expr expr) {
+    value = nullptr;
+    expr.accept(this);
+    taco_iassert(value != nullptr) << "No value generated for " << expr;
+    return value;
+  }
+
+  llvm::Value* codegen(Expr expr, llvm::Type* type) {
+    return cast(codegen(expr), type);
+  }
+
+  llvm::Value* codegenBool(Expr expr) {
+    return cast(codegen(expr), builder.getInt1Ty());
+  }
+
+  // Convert a value like a C cast between the corresponding types
+  llvm::Value* cast(llvm::Value* val, llvm::Type* type) {
+    llvm::Type* from = val->getType();
+    if (from == type) {
+      return val;
+    }
+    // Conversions to bool compare with zero instead of truncating
+    if (type->isIntegerTy(1) && from->isFloatingPointTy()) {
+      return builder.CreateFCmpUNE(val, llvm::ConstantFP::get(from, 0));
+    }
+    if (type->isIntegerTy(1) && from->isIntegerTy()) {
+      return builder.CreateICmpNE(val, llvm::ConstantInt::get(from, 0));
+    }
+    if (from->isIntegerTy() && type->isIntegerTy()) {
+      return from->isIntegerTy(1) ? builder.CreateZExt(val, type)
+                                  : builder.CreateSExtOrTrunc(val, type);
+    }
+    if (from->isIntegerTy() && type->isFloatingPointTy()) {
+      return from->isIntegerTy(1) ? builder.CreateUIToFP(val, type)
+                                  : builder.CreateSIToFP(val, type);
+    }
+    if (from->isFloatingPointTy() && type->isIntegerTy()) {
+      return builder.CreateFPToSI(val, type);
+    }
+    if (from->isFloatingPointTy() && type->isFloatingPointTy()) {
+      return builder.CreateFPCast(val, type);
+    }
+    if (from->isPointerTy() && type->isPointerTy()) {
+      return builder.CreateBitCast(val, type);
+    }
+    taco_ierror << "Unable to cast between LLVM types";
+    return nullptr;
+  }
+
+  // The type that both operands of a comparison are converted to
+  llvm::Type* getCommonType(Expr a, Expr b) {
+    if (a.type().isFloat() || b.type().isFloat()) {
+      return builder.getDoubleTy();
+    }
+    bool is64 = a.type().bits == 64 || b.type().bits == 64;
+    return is64 ? builder.getInt64Ty() : builder.getInt32Ty();
+  }
+
+  llvm::AllocaInst* createAlloca(llvm::Type* type, const string& name) {
+    llvm::IRBuilder<> entryBuilder(entry, entry->begin());
+    return entryBuilder.CreateAlloca(type, nullptr, name);
+  }
+
+  llvm::AllocaInst* getVar(const Var* var) {
+    if (vars.count(var) == 0) {
+      vars[var] = createAlloca(toLLVMType(var->type, var->is_ptr), var->name);
+    }
+    return vars.at(var);
+  }
+
+  // Dense and fixed levels store their size in the pointer slot, and all
+  // other properties are arrays
+  static bool isScalarProperty(const GetProperty* op) {
+    if (op->property != TensorProperty::Pointer) {
+      return false;
+    }
+    auto tensor = op->tensor.as<Var>();
+    DimensionType type = tensor->format.getLevels()[op->dim].getType();
+    return type == DimensionType::Dense || type == DimensionType::Fixed;
+  }
+
+  llvm::Type* getPropertyType(const GetProperty* op) {
+    if (op->property == TensorProperty::Values) {
+      return toLLVMType(op->tensor.type(), true);
+    }
+    llvm::Type* type = toLLVMType(op->type);
+    return isScalarProperty(op) ? type : type->getPointerTo();
+  }
+
+  // Returns the address of the taco_tensor_t slot that holds the property
+  llvm::Value* getPropertySlot(const GetProperty* op) {
+    llvm::Value* tensor = tensors.at(op->tensor.as<Var>());
+    llvm::Type* bytePtr = builder.getInt8PtrTy();
+    if (op->property == TensorProperty::Values) {
+      return builder.CreateBitCast(
+          builder.CreateConstInBoundsGEP1_64(builder.getInt8Ty(), tensor,
+                                             offsetof(taco_tensor_t, vals)),
+          bytePtr->getPointerTo());
+    }
+    llvm::Type* indexType = bytePtr->getPointerTo()->getPointerTo();
+    llvm::Value* indices = builder.CreateLoad(indexType,
+        builder.CreateBitCast(
+            builder.CreateConstInBoundsGEP1_64(builder.getInt8Ty(), tensor,
+                                               offsetof(taco_tensor_t,indices)),
+            indexType->getPointerTo()));
+    llvm::Value* dimIndex = builder.CreateLoad(bytePtr->getPointerTo(),
+        builder.CreateConstInBoundsGEP1_64(bytePtr->getPointerTo(), indices,
+                                           op->dim));
+    size_t slot = op->property == TensorProperty::Pointer ? 0 : 1;
+    return builder.CreateConstInBoundsGEP1_64(bytePtr, dimIndex, slot);
+  }
+
+  void unpackProperty(const GetProperty* op) {
+    llvm::Type* type = getPropertyType(op);
+    llvm::Value* data = builder.CreateLoad(builder.getInt8PtrTy(),
+                                           getPropertySlot(op));
+    llvm::Value* val = isScalarProperty(op)
+        ? builder.CreateLoad(type,
+              builder.CreateBitCast(data, type->getPointerTo()))
+        : builder.CreateBitCast(data, type);
+
+    auto key = make_tuple(op->tensor.ptr, op->property, op->dim);
+    properties[key] = createAlloca(type, "");
+    builder.CreateStore(val, properties[key]);
+  }
+
+  void packProperty(const GetProperty* op) {
+    auto key = make_tuple(op->tensor.ptr, op->property, op->dim);
+    llvm::Value* val = builder.CreateLoad(getPropertyType(op), properties[key]);
+    val = isScalarProperty(op)
+          ? builder.CreateIntToPtr(val, builder.getInt8PtrTy())
+          : builder.CreateBitCast(val, builder.getInt8PtrTy());
+    builder.CreateStore(val, getPropertySlot(op));
+  }
+
+  llvm::Value* getAddress(Expr var) {
+    if (auto prop = var.as<GetProperty>()) {
+      return properties.at(make_tuple(prop->tensor.ptr, prop->property,
+                                      prop->dim));
+    }
+    auto v = var.as<Var>();
+    taco_iassert(v != nullptr) << "Can only assign to vars and properties";
+    return getVar(v);
+  }
+
+  llvm::Value* getElementAddress(Expr arr, Expr loc) {
+    llvm::Value* ptr = codegen(arr);
+    llvm::Value* index = codegen(loc, builder.getInt64Ty());
+    return builder.CreateInBoundsGEP(
+        ptr->getType()->getPointerElementType(), ptr, index);
+  }
+
+  llvm::BasicBlock* createBlock(const string& name) {
+    return llvm::BasicBlock::Create(context, name, function);
+  }
+
+  void visit(const Literal* op) {
+    llvm::Type* type = toLLVMType(op->type);
+    if (op->type.isFloat()) {
+      value = llvm::ConstantFP::get(type, op->dbl_value);
+    }
+    else {
+      value = llvm::ConstantInt::get(type, op->value, true);
+    }
+  }
+
+  void visit(const Var* op) {
+    if (tensors.count(op) > 0) {
+      value = tensors.at(op);
+      return;
+    }
+    llvm::AllocaInst* var = getVar(op);
+    value = builder.CreateLoad(var->getAllocatedType(), var);
+  }
+
+  void visit(const Neg* op) {
+    llvm::Value* a = codegen(op->a, toLLVMType(op->type));
+    value = op->type.isFloat() ? builder.CreateFNeg(a) : builder.CreateNeg(a);
+  }
+
+  void visit(const Sqrt* op) {
+    // Integer square roots are computed in double and truncated, like the C
+    // code does
+    llvm::Type* type = toLLVMType(op->type);
+    llvm::Type* floatType = type->isFloatingPointTy() ? type
+                                                      : builder.getDoubleTy();
+    value = cast(builder.CreateUnaryIntrinsic(llvm::Intrinsic::sqrt,
+                                              codegen(op->a, floatType)),
+                 type);
+  }
+
+  template <class T>
+  void visitArith(const T* op, llvm::Instruction::BinaryOps intOp,
+                  llvm::Instruction::BinaryOps floatOp, bool nsw) {
+    llvm::Type* type = toLLVMType(op->type);
+    llvm::Value* a = codegen(op->a, type);
+    llvm::Value* b = codegen(op->b, type);
+    if (op->type.isFloat()) {
+      value = builder.CreateBinOp(floatOp, a, b);
+    }
+    else {
+      value = builder.CreateBinOp(intOp, a, b);
+      // Signed overflow is undefined in the generated C code as well
+      auto inst = llvm::dyn_cast<llvm::BinaryOperator>(value);
+      if (nsw && op->type.isInt() && inst != nullptr) {
+        inst->setHasNoSignedWrap();
+      }
+    }
+  }
+
+  void visit(const Add* op) {
+    visitArith(op, llvm::Instruction::Add, llvm::Instruction::FAdd, true);
+  }
+
+  void visit(const Sub* op) {
+    visitArith(op, llvm::Instruction::Sub, llvm::Instruction::FSub, true);
+  }
+
+  void visit(const Mul* op) {
+    visitArith(op, llvm::Instruction::Mul, llvm::Instruction::FMul, true);
+  }
+
+  void visit(const Div* op) {
+    visitArith(op, llvm::Instruction::SDiv, llvm::Instruction::FDiv, false);
+  }
+
+  void visit(const Rem* op) {
+    visitArith(op, llvm::Instruction::SRem, llvm::Instruction::FRem, false);
+  }
+
+  llvm::Value* createLt(llvm::Value* a, llvm::Value* b) {
+    return a->getType()->isFloatingPointTy() ? builder.CreateFCmpOLT(a, b)
+                                             : builder.CreateICmpSLT(a, b);
+  }
+
+  void visit(const Min* op) {
+    llvm::Type* type = toLLVMType(op->type);
+    llvm::Value* min = codegen(op->operands.back(), type);
+    for (size_t i = op->operands.size()-1; i > 0; i--) {
+      llvm::Value* a = codegen(op->operands[i-1], type);
+      min = builder.CreateSelect(createLt(a, min), a, min);
+    }
+    value = min;
+  }
+
+  void visit(const Max* op) {
+    llvm::Type* type = toLLVMType(op->type);
+    llvm::Value* a = codegen(op->a, type);
+    llvm::Value* b = codegen(op->b, type);
+    value = builder.CreateSelect(createLt(a, b), b, a);
+  }
+
+  void visit(const BitAnd* op) {
+    llvm::Type* type = toLLVMType(op->type);
+    llvm::Value* a = codegen(op->a, type);
+    value = builder.CreateAnd(a, codegen(op->b, type));
+  }
+
+  template <class T>
+  void visitCompare(const T* op, llvm::CmpInst::Predicate intPredicate,
+                    llvm::CmpInst::Predicate floatPredicate) {
+    llvm::Type* type = getCommonType(op->a, op->b);
+    llvm::Value* a = codegen(op->a, type);
+    llvm::Value* b = codegen(op->b, type);
+    value = type->isFloatingPointTy() ? builder.CreateFCmp(floatPredicate, a, b)
+                                      : builder.CreateICmp(intPredicate, a, b);
+  }
+
+  void visit(const Eq* op) {
+    visitCompare(op, llvm::CmpInst::ICMP_EQ, llvm::CmpInst::FCMP_OEQ);
+  }
+
+  void visit(const Neq* op) {
+    visitCompare(op, llvm::CmpInst::ICMP_NE, llvm::CmpInst::FCMP_UNE);
+  }
+
+  void visit(const Gt* op) {
+    visitCompare(op, llvm::CmpInst::ICMP_SGT, llvm::CmpInst::FCMP_OGT);
+  }
+
+  void visit(const Lt* op) {
+    visitCompare(op, llvm::CmpInst::ICMP_SLT, llvm::CmpInst::FCMP_OLT);
+  }
+
+  void visit(const Gte* op) {
+    visitCompare(op, llvm::CmpInst::ICMP_SGE, llvm::CmpInst::FCMP_OGE);
+  }
+
+  void visit(const Lte* op) {
+    visitCompare(op, llvm::CmpInst::ICMP_SLE, llvm::CmpInst::FCMP_OLE);
+  }
+
+  // && and || short-circuit, like in C
+  void visitLogical(Expr a, Expr b, bool isAnd) {
+    llvm::Value* lhs = codegenBool(a);
+    llvm::BasicBlock* lhsBlock = builder.GetInsertBlock();
+    llvm::BasicBlock* rhsBlock = createBlock(isAnd ? "and_rhs" : "or_rhs");
+    llvm::BasicBlock* end = createBlock(isAnd ? "and_end" : "or_end");
+    if (isAnd) {
+      builder.CreateCondBr(lhs, rhsBlock, end);
+    }
+    else {
+      builder.CreateCondBr(lhs, end, rhsBlock);
+    }
+
+    builder.SetInsertPoint(rhsBlock);
+    llvm::Value* rhs = codegenBool(b);
+    rhsBlock = builder.GetInsertBlock();
+    builder.CreateBr(end);
+
+    builder.SetInsertPoint(end);
+    llvm::PHINode* phi = builder.CreatePHI(builder.getInt1Ty(), 2);
+    phi->addIncoming(builder.getInt1(!isAnd), lhsBlock);
+    phi->addIncoming(rhs, rhsBlock);
+    value = phi;
+  }
+
+  void visit(const And* op) {
+    visitLogical(op->a, op->b, true);
+  }
+
+  void visit(const Or* op) {
+    visitLogical(op->a, op->b, false);
+  }
+
+  void visit(const IfThenElse* op) {
+    llvm::BasicBlock* thenBlock = createBlock("then");
+    llvm::BasicBlock* end = createBlock("endif");
+    llvm::BasicBlock* otherwiseBlock = op->otherwise.defined()
+                                       ? createBlock("else") : end;
+    builder.CreateCondBr(codegenBool(op->cond), thenBlock, otherwiseBlock);
+
+    builder.SetInsertPoint(thenBlock);
+    op->then.accept(this);
+    builder.CreateBr(end);
+
+    if (op->otherwise.defined()) {
+      builder.SetInsertPoint(otherwiseBlock);
+      op->otherwise.accept(this);
+      builder.CreateBr(end);
+    }
+    builder.SetInsertPoint(end);
+  }
+
+  void visit(const Case* op) {
+    llvm::BasicBlock* end = createBlock("endcase");
+    for (size_t i = 0; i < op->clauses.size(); i++) {
+      auto& clause = op->clauses[i];
+      if (i == op->clauses.size()-1 && op->alwaysMatch) {
+        clause.second.accept(this);
+        builder.CreateBr(end);
+        break;
+      }
+      llvm::BasicBlock* body = createBlock("case");
+      llvm::BasicBlock* next = createBlock("nextcase");
+      builder.CreateCondBr(codegenBool(clause.first), body, next);
+      builder.SetInsertPoint(body);
+      clause.second.accept(this);
+      builder.CreateBr(end);
+      builder.SetInsertPoint(next);
+      if (i == op->clauses.size()-1) {
+        builder.CreateBr(end);
+      }
+    }
+    builder.SetInsertPoint(end);
+  }
+
+  void visit(const Load* op) {
+    llvm::Value* ptr = getElementAddress(op->arr, op->loc);
+    value = builder.CreateLoad(ptr->getType()->getPointerElementType(), ptr);
+    // Narrow unsigned index values are loaded as int
+    llvm::Type* type = toLLVMType(op->type);
+    if (value->getType()->isIntegerTy() && type->isIntegerTy() &&
+        value->getType()->getIntegerBitWidth() < type->getIntegerBitWidth()) {
+      value = builder.CreateZExt(value, type);
+    }
+  }
+
+  void visit(const Store* op) {
+    llvm::Value* ptr = getElementAddress(op->arr, op->loc);
+    llvm::Type* type = ptr->getType()->getPointerElementType();
+    builder.CreateStore(codegen(op->data, type), ptr);
+  }
+
+  /// Returns the self-referential loop id of a loop to be vectorized.
+  llvm::MDNode* getVectorizeMetadata(int width) {
+    vector<llvm::Metadata*> operands = {nullptr};
+    operands.push_back(llvm::MDNode::get(context, {
+        llvm::MDString::get(context, "llvm.loop.vectorize.enable"),
+        llvm::ConstantAsMetadata::get(builder.getTrue())}));
+    if (width > 0) {
+      operands.push_back(llvm::MDNode::get(context, {
+          llvm::MDString::get(context, "llvm.loop.vectorize.width"),
+          llvm::ConstantAsMetadata::get(builder.getInt32(width))}));
+    }
+    llvm::MDNode* loopID = llvm::MDNode::getDistinct(context, operands);
+    loopID->replaceOperandWith(0, loopID);
+    return loopID;
+  }
+
+  // Parallel loops are compiled as serial loops.  Vectorized loops carry loop
+  // metadata that asks the loop vectorizer to vectorize them, with the given
+  // width, while it decides by itself whether to vectorize other loops.
+  void visit(const For* op) {
+    auto loopVar = op->var.as<Var>();
+    taco_iassert(loopVar != nullptr) << "Loop variables must be vars";
+    llvm::AllocaInst* var = getVar(loopVar);
+    llvm::Type* type = var->getAllocatedType();
+    builder.CreateStore(codegen(op->start, type), var);
+
+    llvm::BasicBlock* header = createBlock("for_header");
+    llvm::BasicBlock* body = createBlock("for_body");
+    llvm::BasicBlock* end = createBlock("for_end");
+    builder.CreateBr(header);
+
+    builder.SetInsertPoint(header);
+    llvm::Value* cond = createLt(builder.CreateLoad(type, var),
+                                 codegen(op->end, type));
+    builder.CreateCondBr(cond, body, end);
+
+    builder.SetInsertPoint(body);
+    op->contents.accept(this);
+    llvm::Value* next = builder.CreateNSWAdd(builder.CreateLoad(type, var),
+                                             codegen(op->increment, type));
+    builder.CreateStore(next, var);
+    llvm::BranchInst* latch = builder.CreateBr(header);
+    if (op->kind == LoopKind::Vectorized) {
+      latch->setMetadata(llvm::LLVMContext::MD_loop,
+                         getVectorizeMetadata(op->vec_width));
+    }
+
+    builder.SetInsertPoint(end);
+  }
+
+  void visit(const While* op) {
+    llvm::BasicBlock* header = createBlock("while_header");
+    llvm::BasicBlock* body = createBlock("while_body");
+    llvm::BasicBlock* end = createBlock("while_end");
+    builder.CreateBr(header);
+
+    builder.SetInsertPoint(header);
+    builder.CreateCondBr(codegenBool(op->cond), body, end);
+
+    builder.SetInsertPoint(body);
+    op->contents.accept(this);
+    builder.CreateBr(header);
+
+    builder.SetInsertPoint(end);
+  }
+
+  void visit(const Block* op) {
+    for (auto& stmt : op->contents) {
+      stmt.accept(this);
+    }
+  }
+
+  void visit(const Scope* op) {
+    op->scopedStmt.accept(this);
+  }
+
+  void visit(const Function* func) {
+    vector<Expr> params = func->outputs;
+    params.insert(params.end(), func->inputs.begin(), func->inputs.end());
+
+    vector<llvm::Type*> paramTypes;
+    for (auto& param : params) {
+      auto var = param.as<Var>();
+      taco_iassert(var) << "Function parameters must be vars in codegen";
+      paramTypes.push_back(var->is_tensor ? builder.getInt8PtrTy()
+                                          : toLLVMType(var->type, var->is_ptr));
+    }
+    function = llvm::Function::Create(
+        llvm::FunctionType::get(builder.getInt32Ty(), paramTypes, false),
+        llvm::Function::ExternalLinkage, func->name, module);
+    function->addFnAttr(llvm::Attribute::NoUnwind);
+
+    tensors.clear();
+    vars.clear();
+    properties.clear();
+    entry = createBlock("entry");
+    builder.SetInsertPoint(entry);
+    for (size_t i = 0; i < params.size(); i++) {
+      auto var = params[i].as<Var>();
+      llvm::Argument* arg = function->getArg(i);
+      arg->setName(var->name);
+      if (var->is_tensor) {
+        tensors[var] = arg;
+      }
+      else {
+        builder.CreateStore(arg, getVar(var));
+      }
+    }
+
+    // Don't generate bodies that don't do anything (e.g. assemble functions
+    // when the result is dense)
+    if (hasStore(func->body)) {
+      Stmt body = simplify(func->body);
+      FindProperties propertyFinder;
+      body.accept(&propertyFinder);
+      for (auto& property : propertyFinder.properties) {
+        unpackProperty(property);
+      }
+
+      body.accept(this);
+
+      for (auto& property : propertyFinder.properties) {
+        auto tensor = property->tensor;
+        if (find(func->outputs.begin(), func->outputs.end(), tensor) !=
+            func->outputs.end()) {
+          packProperty(property);
+        }
+      }
+    }
+    builder.CreateRet(builder.getInt32(0));
+  }
+
+  void visit(const VarAssign* op) {
+    llvm::Value* ptr = getAddress(op->lhs);
+    llvm::Type* type = ptr->getType()->getPointerElementType();
+    builder.CreateStore(codegen(op->rhs, type), ptr);
+  }
+
+  void visit(const Allocate* op) {
+    llvm::Value* ptr = getAddress(op->var);
+    llvm::Type* type = ptr->getType()->getPointerElementType();
+    llvm::Type* elementType = type->getPointerElementType();
+
+    llvm::Type* sizeType = builder.getInt64Ty();
+    llvm::Value* size = builder.CreateMul(
+        llvm::ConstantInt::get(sizeType,
+            module->getDataLayout().getTypeAllocSize(elementType)),
+        codegen(op->num_elements, sizeType));
+
+    llvm::Type* bytePtr = builder.getInt8PtrTy();
+    llvm::Value* memory;
+    if (op->is_realloc) {
+      llvm::FunctionCallee realloc = module->getOrInsertFunction("realloc",
+          llvm::FunctionType::get(bytePtr, {bytePtr, sizeType}, false));
+      llvm::Value* old = builder.CreateBitCast(builder.CreateLoad(type, ptr),
+                                               bytePtr);
+      memory = builder.CreateCall(realloc, {old, size});
+    }
+    else {
+      llvm::FunctionCallee malloc = module->getOrInsertFunction("malloc",
+          llvm::FunctionType::get(bytePtr, {sizeType}, false));
+      memory = builder.CreateCall(malloc, {size});
+    }
+    builder.CreateStore(builder.CreateBitCast(memory, type), ptr);
+  }
+
+  void visit(const Free* op) {
+    llvm::Value* ptr = getAddress(op->var);
+    llvm::Type* type = ptr->getType()->getPointerElementType();
+    llvm::Type* bytePtr = builder.getInt8PtrTy();
+    llvm::FunctionCallee free = module->getOrInsertFunction("free",
+        llvm::FunctionType::get(builder.getVoidTy(), {bytePtr}, false));
+    builder.CreateCall(free, {builder.CreateBitCast(
+        builder.CreateLoad(type, ptr), bytePtr)});
+  }
+
+  void visit(const Comment*) {
+  }
+
+  void visit(const BlankLine*) {
+  }
+
+  void visit(const Print* op) {
+    llvm::FunctionCallee printf = module->getOrInsertFunction("printf",
+        llvm::FunctionType::get(builder.getInt32Ty(), {builder.getInt8PtrTy()},
+                                true));
+    vector<llvm::Value*> args = {builder.CreateGlobalStringPtr(unescape(op->fmt))};
+    for (auto& param : op->params) {
+      llvm::Value* arg = codegen(param);
+      // Apply the C default argument promotions
+      if (arg->getType()->isFloatTy()) {
+        arg = builder.CreateFPExt(arg, builder.getDoubleTy());
+      }
+      else if (arg->getType()->isIntegerTy(1)) {
+        arg = builder.CreateZExt(arg, builder.getInt32Ty());
+      }
+      args.push_back(arg);
+    }
+    builder.CreateCall(printf, args);
+  }
+
+  void visit(const GetProperty* op) {
+    llvm::AllocaInst* property = properties.at(make_tuple(op->tensor.ptr,
+                                                          op->property,
+                                                          op->dim));
+    value = builder.CreateLoad(property->getAllocatedType(), property);
+  }
+};
+
+void initializeLLVM() {
+  static once_flag initialized;
+  call_once(initialized, []() {
+    llvm::InitializeNativeTarget();
+    llvm::InitializeNativeTargetAsmPrinter();
+  });
+}
+
+void optimize(llvm::Module& module, llvm::TargetMachine* targetMachine) {
+  llvm::PassBuilder passBuilder(targetMachine);
+  llvm::LoopAnalysisManager loopAnalyses;
+  llvm::FunctionAnalysisManager functionAnalyses;
+  llvm::CGSCCAnalysisManager cgsccAnalyses;
+  llvm::ModuleAnalysisManager moduleAnalyses;
+  passBuilder.registerModuleAnalyses(moduleAnalyses);
+  passBuilder.registerCGSCCAnalyses(cgsccAnalyses);
+  passBuilder.registerFunctionAnalyses(functionAnalyses);
+  passBuilder.registerLoopAnalyses(loopAnalyses);
+  passBuilder.crossRegisterProxies(loopAnalyses, functionAnalyses,
+                                   cgsccAnalyses, moduleAnalyses);
+  passBuilder.buildPerModuleDefaultPipeline(llvm::OptimizationLevel::O3)
+      .run(module, moduleAnalyses);
+}
+
+} // anonymous namespace
+
+struct CodeGen_LLVM::Content {
+  Content(Target target) : target(target) {}
+
+  Target target;
+  unique_ptr<llvm::orc::LLJIT> jit;
+  string source;
+};
+
+CodeGen_LLVM::CodeGen_LLVM(Target target) : content(new Content(target)) {
+}
+
+CodeGen_LLVM::~CodeGen_LLVM() {
+}
+
+void CodeGen_LLVM::compile(const vector<Stmt>& funcs) {
+  initializeLLVM();
+
+  auto machineBuilder = llvm::orc::JITTargetMachineBuilder::detectHost();
+  if (!machineBuilder) {
+    taco_uerror << "Unable to detect the host machine: "
+                << llvm::toString(machineBuilder.takeError());
+  }
+  taco_uassert(content->target.arch != Target::X86 ||
+               machineBuilder->getTargetTriple().isX86())
+      << "The x86 target can only compile for an x86 host";
+  machineBuilder->setCodeGenOptLevel(llvm::CodeGenOpt::Aggressive);
+
+  // The vector instruction set of the target is enabled explicitly, like the
+  // -m flags of the C backend, on top of the detected host features
+  switch (content->target.isa) {
+    case Target::Generic:
+      break;
+    case Target::AVX2:
+      machineBuilder->addFeatures({"+avx2", "+fma"});
+      break;
+    case Target::AVX512:
+      machineBuilder->addFeatures({"+avx512f", "+avx512vl", "+avx512dq",
+                                   "+avx512bw", "+fma"});
+      break;
+  }
+
+  auto targetMachine = machineBuilder->createTargetMachine();
+  if (!targetMachine) {
+    taco_uerror << "Unable to create the target machine: "
+                << llvm::toString(targetMachine.takeError());
+  }
+
+  auto context = std::make_unique<llvm::LLVMContext>();
+  auto module = std::make_unique<llvm::Module>("taco", *context);
+  module->setTargetTriple((*targetMachine)->getTargetTriple().str());
+  module->setDataLayout((*targetMachine)->createDataLayout());
+
+  LLVMGenerator generator(*context, module.get());
+  for (auto& func : funcs) {
+    generator.compile(func);
+  }
+  for (auto& func : funcs) {
+    generator.generateShim(func.as<Function>());
+  }
+
+  // Like -mprefer-vector-width=512 for the C backend, since the vectorizer
+  // otherwise prefers 256-bit vectors on most AVX-512 machines
+  if (content->target.isa == Target::AVX512) {
+    for (auto& function : *module) {
+      function.addFnAttr("prefer-vector-width", "512");
+    }
+  }
+
+  string errors;
+  llvm::raw_string_ostream errorStream(errors);
+  taco_iassert(!llvm::verifyModule(*module, &errorStream))
+      << "Invalid LLVM IR generated: " << errorStream.str();
+
+  optimize(*module, targetMachine->get());
+
+  llvm::raw_string_ostream sourceStream(content->source);
+  module->print(sourceStream, nullptr);
+  sourceStream.flush();
+
+  auto jit = llvm::orc::LLJITBuilder()
+      .setJITTargetMachineBuilder(std::move(*machineBuilder))
+      .create();
+  if (!jit) {
+    taco_uerror << "Unable to create the JIT: "
+                << llvm::toString(jit.takeError());
+  }
+  content->jit = std::move(*jit);
+
+  // Resolve malloc, realloc and printf from the host process
+  auto process = llvm::orc::DynamicLibrarySearchGenerator::GetForCurrentProcess(
+      content->jit->getDataLayout().getGlobalPrefix());
+  if (!process) {
+    taco_uerror << "Unable to load the process symbols: "
+                << llvm::toString(process.takeError());
+  }
+  content->jit->getMainJITDylib().addGenerator(std::move(*process));
+
+  llvm::Error err = content->jit->addIRModule(
+      llvm::orc::ThreadSafeModule(std::move(module), std::move(context)));
+  if (err) {
+    taco_uerror << "Unable to JIT compile the module: "
+                << llvm::toString(std::move(err));
+  }
+}
+
+string CodeGen_LLVM::getSource() const {
+  return content->source;
+}
+
+void* CodeGen_LLVM::getFunc(const string& name) const {
+  if (content->jit == nullptr) {
+    return nullptr;
+  }
+  auto symbol = content->jit->lookup(name);
+  if (!symbol) {
+    llvm::consumeError(symbol.takeError());
+    return nullptr;
+  }
+  return (void*)symbol->getAddress();
+}
+
+}}
@@ -0,0 +1,40 @@
+#ifndef TACO_BACKEND_LLVM_H
+#define TACO_BACKEND_LLVM_H
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "taco/target.h"
+#include "ir/ir.h"
+
+namespace taco {
+namespace ir {
+
+/// Compiles lowered functions to native code in-process with the LLVM ORC JIT,
+/// instead of generating C and running an external compiler.  The compiled
+/// functions, and the `_shim_` functions that unpack their arguments, have the
+/// same signatures as the ones generated by CodeGen_C.  This header does not
+/// depend on LLVM; the backend is only built if LLVM is found (TACO_LLVM).
+class CodeGen_LLVM {
+public:
+  /// Create a JIT for the target machine, which must be the host.
+  CodeGen_LLVM(Target target);
+  ~CodeGen_LLVM();
+
+  /// Compile the lowered functions to native code.
+  void compile(const std::vector<Stmt>& funcs);
+
+  /// Returns the optimized LLVM IR of the compiled functions.
+  std::string getSource() const;
+
+  /// Returns a pointer to a compiled function, or nullptr if there is none.
+  void* getFunc(const std::string& name) const;
+
+private:
+  struct Content;
+  std::unique_ptr<Content> content;
+};
+
+}}
+#endif
@@ -0,0 +1,211 @@
+#include "jit_cache.h"
+
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <map>
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include "taco/error.h"
+#include "taco/util/env.h"
+
+using namespace std;
+
+namespace taco {
+namespace ir {
+
+static const size_t DEFAULT_CACHE_SIZE_MB = 256;
+
+static void makeDirectory(const string& dir) {
+  for (size_t pos = dir.find('/', 1); pos != string::npos;
+       pos = dir.find('/', pos+1)) {
+    mkdir(dir.substr(0, pos).c_str(), 0755);
+  }
+  mkdir(dir.c_str(), 0755);
+}
+
+static bool readFile(const string& path, string* contents) {
+  ifstream file(path, ios::binary);
+  if (!file.is_open()) {
+    return false;
+  }
+  stringstream buffer;
+  buffer << file.rdbuf();
+  *contents = buffer.str();
+  return true;
+}
+
+// class JITCache
+JITCache::JITCache(string dir, size_t maxBytes) : dir(dir), maxBytes(maxBytes) {
+  if (this->dir.empty() || this->dir.back() != '/') {
+    this->dir += '/';
+  }
+  makeDirectory(this->dir);
+}
+
+const string& JITCache::getDir() const {
+  return dir;
+}
+
+string JITCache::getPrefix(const string& key) const {
+  return dir + key;
+}
+
+bool JITCache::lookup(const string& key, const string& source) {
+  string prefix = getPrefix(key);
+  string library = prefix + ".so";
+
+  // A hit requires both the library and an identical source, which guards
+  // against hash collisions.
+  string cachedSource;
+  bool hit = access(library.c_str(), R_OK) == 0 &&
+             readFile(prefix + ".c", &cachedSource) && cachedSource == source;
+
+  if (hit) {
+    // The library modification time is its last access time
+    utimes(library.c_str(), nullptr);
+  }
+
+  lock_guard<std::mutex> lock(mutex);
+  if (hit) {
+    stats.hits++;
+  }
+  else {
+    stats.misses++;
+  }
+  return hit;
+}
+
+void JITCache::insert(const string& key) {
+  lock_guard<std::mutex> lock(mutex);
+  evict(key);
+}
+
+namespace {
+struct Entry {
+  time_t lastAccess = 0;
+  size_t bytes = 0;
+  vector<string> files;
+};
+}
+
+static map<string,Entry> getEntries(const string& dir) {
+  map<string,Entry> entries;
+  DIR* dirp = opendir(dir.c_str());
+  if (dirp == nullptr) {
+    return entries;
+  }
+  while (struct dirent* file = readdir(dirp)) {
+    string name = file->d_name;
+    if (name[0] == '.') {
+      continue;
+    }
+    struct stat st;
+    if (stat((dir + name).c_str(), &st) != 0 || !S_ISREG(st.st_mode)) {
+      continue;
+    }
+    // Entry files are named <key>.<ext> or <key>_shims.<ext>
+    string key = name.substr(0, name.find_first_of("._"));
+    Entry& entry = entries[key];
+    entry.bytes += st.st_size;
+    entry.files.push_back(dir + name);
+    if (name == key + ".so") {
+      entry.lastAccess = st.st_mtime;
+    }
+  }
+  closedir(dirp);
+  return entries;
+}
+
+void JITCache::evict(const string& keep) {
+  map<string,Entry> entries = getEntries(dir);
+
+  size_t totalBytes = 0;
+  vector<pair<time_t,string>> lru;
+  for (auto& entry : entries) {
+    totalBytes += entry.second.bytes;
+    if (entry.first != keep) {
+      lru.push_back({entry.second.lastAccess, entry.first});
+    }
+  }
+  sort(lru.begin(), lru.end());
+
+  for (auto& candidate : lru) {
+    if (totalBytes <= maxBytes) {
+      break;
+    }
+    Entry& entry = entries.at(candidate.second);
+    for (auto& file : entry.files) {
+      unlink(file.c_str());
+    }
+    totalBytes -= entry.bytes;
+    stats.evictions++;
+  }
+}
+
+size_t JITCache::getSize() const {
+  lock_guard<std::mutex> lock(mutex);
+  size_t totalBytes = 0;
+  for (auto& entry : getEntries(dir)) {
+    totalBytes += entry.second.bytes;
+  }
+  return totalBytes;
+}
+
+JITCacheStats JITCache::getStats() const {
+  lock_guard<std::mutex> lock(mutex);
+  return stats;
+}
+
+void JITCache::resetStats() {
+  lock_guard<std::mutex> lock(mutex);
+  stats = JITCacheStats();
+}
+
+string getJITCacheKey(const vector<string>& contents) {
+  // Two independent 64-bit FNV-1a hashes
+  uint64_t h1 = 0xcbf29ce484222325ull;
+  uint64_t h2 = 0x84222325cbf29ce4ull;
+  for (auto& content : contents) {
+    for (unsigned char c : content) {
+      h1 = (h1 ^ c) * 0x100000001b3ull;
+      h2 = (h2 ^ c) * 0x100000001b3ull;
+      h2 ^= h2 >> 29;
+    }
+    // Separate the strings so that ("ab","c") and ("a","bc") differ
+    h1 = (h1 ^ 0xff) * 0x100000001b3ull;
+    h2 = (h2 ^ 0xff) * 0x100000001b3ull;
+  }
+  stringstream key;
+  key << hex << setfill('0') << setw(16) << h1 << setw(16) << h2;
+  return key.str();
+}
+
+JITCache* getJITCache() {
+  static JITCache* cache = []() -> JITCache* {
+    size_t sizeMB = util::getSizeFromEnv("TACO_CACHE_SIZE",
+                                         DEFAULT_CACHE_SIZE_MB);
+    if (sizeMB == 0) {
+      return nullptr;
+    }
+    string dir = util::getFromEnv("TACO_CACHE_DIR",
+                                  util::getTmpdir() + "taco-cache/");
+    JITCache* cache = new JITCache(dir, sizeMB << 20);
+    if (access(cache->getDir().c_str(), W_OK) != 0) {
+      taco_uwarning << "Unable to write to the kernel cache directory " << dir
+                    << ". Compiled kernels will not be cached.";
+      delete cache;
+      return nullptr;
+    }
+    return cache;
+  }();
+  return cache;
+}
+
+}}
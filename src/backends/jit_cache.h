@@ -0,0 +1,73 @@
+#ifndef TACO_JIT_CACHE_H
+#define TACO_JIT_CACHE_H
+
+#include <string>
+#include <vector>
+#include <mutex>
+
+namespace taco {
+namespace ir {
+
+/// Hit, miss and eviction counts of a JIT cache.
+struct JITCacheStats {
+  size_t hits      = 0;
+  size_t misses    = 0;
+  size_t evictions = 0;
+};
+
+/// A content-addressed on-disk cache of compiled kernel libraries. Each entry
+/// is a set of files `<dir>/<key>*` (the generated sources and the compiled
+/// `<key>.so`), where the key is a hash of the generated source and the
+/// compiler command.  The modification time of a library is used as its last
+/// access time, and the least recently used entries are evicted when the total
+/// size of the cache exceeds the size limit.  The cache may be shared by
+/// several processes, so entries are created by renaming complete files into
+/// place.
+class JITCache {
+public:
+  /// Create a cache in `dir` that holds at most `maxBytes` bytes.
+  JITCache(std::string dir, size_t maxBytes);
+
+  /// Returns the cache directory (with a trailing slash).
+  const std::string& getDir() const;
+
+  /// Returns the path of the cache entry files for the key, without extension.
+  std::string getPrefix(const std::string& key) const;
+
+  /// Returns true iff a library compiled from `source` is cached under `key`,
+  /// and marks the entry as recently used.
+  bool lookup(const std::string& key, const std::string& source);
+
+  /// Register a newly compiled entry, and evict the least recently used
+  /// entries until the cache fits its size limit.
+  void insert(const std::string& key);
+
+  /// Returns the total size in bytes of the cached entries.
+  size_t getSize() const;
+
+  /// Returns the hit/miss/eviction counts since the last reset.
+  JITCacheStats getStats() const;
+
+  /// Reset the hit/miss/eviction counts.
+  void resetStats();
+
+private:
+  std::string dir;
+  size_t maxBytes;
+
+  mutable std::mutex mutex;
+  JITCacheStats stats;
+
+  void evict(const std::string& keep);
+};
+
+/// Hash the given strings into a cache key.
+std::string getJITCacheKey(const std::vector<std::string>& contents);
+
+/// Returns the process-wide JIT cache, or nullptr if caching is disabled. The
+/// cache is stored in `$TACO_CACHE_DIR` (default `$TMPDIR/taco-cache`) and
+/// holds at most `$TACO_CACHE_SIZE` megabytes (default 256, 0 disables it).
+JITCache* getJITCache();
+
+}}
+#endif
@@ -5,6 +5,8 @@
 
 
 #include "module.h"
+#include "jit_cache.h"
+#include "codegen_llvm.h"
 #include "taco/error.h"
 #include "taco/util/strings.h"
 #include "taco/util/env.h"
@@ -18,29 +20,38 @@ void Module::setJITTmpdir() {
   tmpdir = util::getTmpdir();
 }
 
-void Module::setJITLibname() {
+string Module::randomName() {
   string chars = "abcdefghijkmnpqrstuvwxyz0123456789";
-  libname.resize(12);
+  string name;
+  name.resize(12);
   for (int i=0; i<12; i++)
-    libname[i] = chars[rand() % chars.length()];
+    name[i] = chars[rand() % chars.length()];
+  return name;
+}
+
+void Module::setJITLibname() {
+  libname = randomName();
+}
+
+Module::~Module() {
+  if (lib_handle != nullptr) {
+    dlclose(lib_handle);
+  }
 }
 
 void Module::addFunction(Stmt func) {
   funcs.push_back(func);
 }
 
-void Module::compileToSource(string path, string prefix) {
+void Module::generateSource() {
   // create a codegen instance and add all the funcs
   bool didGenRuntime = false;
   
   header.str("");
-  source.str("");
   header.clear();
-  source.clear();
   
-  taco_tassert(target.arch == Target::C99)
-  << "Only C99 codegen supported currently";
-  CodeGen_C codegen(source, CodeGen_C::OutputKind::C99Implementation);
+  stringstream generated;
+  CodeGen_C codegen(generated, CodeGen_C::OutputKind::C99Implementation);
   CodeGen_C headergen(header, CodeGen_C::OutputKind::C99Header);
   
   
@@ -50,6 +61,20 @@ void Module::compileToSource(string path, string prefix) {
     didGenRuntime = true;
   }
 
+  // A source set with setSource implements the functions instead
+  if (!hasSetSource) {
+    source.str("");
+    source.clear();
+    source << generated.str();
+  }
+}
+
+void Module::compileToSource(string path, string prefix) {
+  generateSource();
+  writeSource(path, prefix);
+}
+
+void Module::writeSource(string path, string prefix) {
   ofstream source_file;
   source_file.open(path+prefix+".c");
   source_file << source.str();
@@ -68,54 +93,197 @@ void Module::compileToStaticLibrary(string path, string prefix) {
   
 namespace {
 
-void writeShims(vector<Stmt> funcs, string path, string prefix) {
+string generateShims(vector<Stmt> funcs) {
   stringstream shims;
   
   for (auto func: funcs) {
     CodeGen_C::generateShim(&func, shims);
   }
-  
+  return shims.str();
+}
+
+/// Write the shims to path/prefix_shims.c, including the header `header`.
+void writeShims(string shims, string path, string prefix, string header) {
   ofstream shims_file;
   shims_file.open(path+prefix+"_shims.c");
-  shims_file << "#include \"" << path << prefix << ".h\"\n";
-  shims_file << shims.str();
+  shims_file << "#include \"" << header << "\"\n";
+  shims_file << shims;
   shims_file.close();
 }
 
-} // anonymous namespace
+/// Returns the flags that compile and link OpenMP code for the target.  Apple's
+/// compiler driver only passes OpenMP pragmas on to the compiler proper, and
+/// the runtime must be linked explicitly.
+string getOpenMPFlags(const Target& target) {
+  if (target.parallelism != Target::OpenMP) {
+    return "";
+  }
+  string flags = (target.os == Target::MacOS) ? "-Xpreprocessor -fopenmp -lomp"
+                                              : "-fopenmp";
+  return " " + util::getFromEnv("TACO_OPENMP_FLAGS", flags);
+}
 
-string Module::compile() {
-  string prefix = tmpdir+libname;
-  string fullpath = prefix + ".so";
-  
+/// Returns the flags that let the compiler use the target's vector instruction
+/// set.  AVX-512 code prefers 512-bit vectors, which compilers otherwise avoid
+/// for loops they vectorize by themselves.
+string getVectorFlags(const Target& target) {
+  switch (target.isa) {
+    case Target::Generic:
+      return "";
+    case Target::AVX2:
+      return " -mavx2 -mfma";
+    case Target::AVX512:
+      return " -mavx512f -mavx512vl -mavx512dq -mavx512bw -mfma "
+             "-mprefer-vector-width=512";
+  }
+  return "";
+}
+
+string getCompileCommand(const Target& target, string prefix, string output) {
   string cc = util::getFromEnv("TACO_CC", "cc");
   string cflags = util::getFromEnv("TACO_CFLAGS",
-    "-O3 -ffast-math -std=c99") + " -shared -fPIC";
+    "-O3 -ffast-math -std=c99") + " -shared -fPIC" + getOpenMPFlags(target) +
+    getVectorFlags(target);
   
-  string cmd = cc + " " + cflags + " " +
+  return cc + " " + cflags + " " +
     prefix + ".c " +
     prefix + "_shims.c " +
-    "-o " + prefix + ".so";
+    "-o " + output;
+}
 
-  // open the output file & write out the source
-  compileToSource(tmpdir, libname);
-  
-  // write out the shims
-  writeShims(funcs, tmpdir, libname);
-  
-  // now compile it
+/// Run a compile command, describing how it failed in `error` if it fails.
+bool runCompileCommand(string cmd, string* error) {
   int err = system(cmd.data());
-  taco_uassert(err == 0) << "Compilation command failed:\n" << cmd
-    << "\nreturned " << err;
+  if (err != 0) {
+    *error = "Compilation command failed:\n" + cmd + "\nreturned " +
+             to_string(err);
+  }
+  return err == 0;
+}
+
+} // anonymous namespace
+
+string Module::compile() {
+  string path;
+  string error;
+  taco_uassert(compileLibrary(&path, &error)) << error;
+  return path;
+}
+
+bool Module::tryCompile(string* path) {
+  string fullpath;
+  string error;
+  if (!compileLibrary(&fullpath, &error)) {
+    return false;
+  }
+  if (path != nullptr) {
+    *path = fullpath;
+  }
+  return true;
+}
+
+bool Module::compileLibrary(string* path, string* error) {
+  generateSource();
+
+  if (target.arch != Target::C99) {
+#ifdef TACO_LLVM
+    llvmCode = make_shared<CodeGen_LLVM>(target);
+    llvmCode->compile(funcs);
+    *path = "";
+    return true;
+#else
+    *error = "taco was built without LLVM, so only the C99 target is "
+             "supported";
+    return false;
+#endif
+  }
+
+  string shims = generateShims(funcs);
+
+  JITCache* cache = getJITCache();
+  string fullpath;
+  if (cache == nullptr) {
+    string prefix = tmpdir+libname;
+    fullpath = prefix + ".so";
+
+    // open the output file & write out the source and shims
+    writeSource(tmpdir, libname);
+    writeShims(shims, tmpdir, libname, prefix + ".h");
+
+    // now compile it
+    if (!runCompileCommand(getCompileCommand(target, prefix, fullpath),
+                           error)) {
+      return false;
+    }
+  }
+  else {
+    // The compile command is hashed with placeholder paths, since the actual
+    // paths depend on the key
+    string key = getJITCacheKey({getCompileCommand(target, "", ""),
+                                 source.str(), header.str(), shims});
+    tmpdir = cache->getDir();
+    libname = key;
+    string prefix = cache->getPrefix(key);
+    fullpath = prefix + ".so";
+
+    if (!cache->lookup(key, source.str())) {
+      // Write and compile under a unique name, then rename the files into
+      // place, so that concurrent compilations of the same key (possibly in
+      // other processes) never see partially written files
+      string tmpname = key + "." + to_string(getpid()) + "." + randomName();
+      string tmpprefix = tmpdir + tmpname;
+
+      writeSource(tmpdir, tmpname);
+      writeShims(shims, tmpdir, tmpname, tmpprefix + ".h");
+      if (!runCompileCommand(getCompileCommand(target, tmpprefix,
+                                               tmpprefix + ".so"), error)) {
+        for (string suffix : {".h", "_shims.c", ".so", ".c"}) {
+          remove((tmpprefix + suffix).c_str());
+        }
+        return false;
+      }
+
+      // The cached shims include the header by the name it is renamed to
+      writeShims(shims, tmpdir, tmpname, prefix + ".h");
+
+      rename((tmpprefix + ".h").c_str(),       (prefix + ".h").c_str());
+      rename((tmpprefix + "_shims.c").c_str(), (prefix + "_shims.c").c_str());
+      rename((tmpprefix + ".so").c_str(),      fullpath.c_str());
+      rename((tmpprefix + ".c").c_str(),       (prefix + ".c").c_str());
+      cache->insert(key);
+    }
+  }
 
   // use dlsym() to open the compiled library
   lib_handle = dlopen(fullpath.data(), RTLD_NOW | RTLD_LOCAL);
+  if (lib_handle == nullptr) {
+    *error = "Unable to load " + fullpath + ": " + dlerror();
+    return false;
+  }
+  loadThreadControl();
+  *path = fullpath;
+  return true;
+}
 
-  return fullpath;
+void Module::loadThreadControl() {
+  // dlsym also searches the libraries that the library depends on, which
+  // include the OpenMP runtime of OpenMP kernels
+  setOpenMPNumThreads = (void (*)(int))dlsym(lib_handle,
+                                             "omp_set_num_threads");
+}
+
+void Module::setNumThreads(int numThreads) {
+  taco_uassert(numThreads > 0) << "The number of threads must be positive";
+  if (setOpenMPNumThreads != nullptr) {
+    setOpenMPNumThreads(numThreads);
+  }
 }
 
 void Module::setSource(string source) {
+  this->source.str("");
+  this->source.clear();
   this->source << source;
+  hasSetSource = true;
 }
 
 string Module::getSource() {
@@ -123,7 +291,12 @@ string Module::getSource() {
 }
 
 void* Module::getFunc(std::string name) {
+#ifdef TACO_LLVM
+  void* ret = (llvmCode != nullptr) ? llvmCode->getFunc(name)
+                                    : dlsym(lib_handle, name.data());
+#else
   void* ret = dlsym(lib_handle, name.data());
+#endif
   taco_uassert(ret != nullptr) <<
       "Function " << name << " not found in module " << tmpdir << libname;
   return ret;
@@ -2,6 +2,7 @@
 #define TACO_MODULE_H
 
 #include <map>
+#include <memory>
 #include <vector>
 #include <string>
 #include <utility>
@@ -12,18 +13,33 @@
 
 namespace taco {
 namespace ir {
+class CodeGen_LLVM;
 
 class Module {
 public:
   /// Create a module for some target
-  Module(Target target=getTargetFromEnvironment()) :  target(target) {
+  Module(Target target=getTargetFromEnvironment())
+      : lib_handle(nullptr), setOpenMPNumThreads(nullptr),
+        hasSetSource(false), target(target) {
     setJITLibname();
     setJITTmpdir();
   }
 
+  /// Unload the compiled library
+  ~Module();
+
   /// Compile the source into a library, returning
-  /// its full path
+  /// its full path.  Libraries are reused from the on-disk JIT cache when
+  /// the same source was compiled before with the same compiler command.
+  /// Modules for a machine target (e.g. x86) are instead compiled in-process
+  /// by the LLVM backend, which creates no library, so an empty path is
+  /// returned.
   std::string compile();
+
+  /// Compile like `compile`, but return false instead of aborting if the
+  /// module cannot be compiled or loaded, e.g. on a machine without a working
+  /// C compiler.  The path of the library is stored in `path`.
+  bool tryCompile(std::string* path=nullptr);
   
   /// Compile the module into a source file located
   /// at the specified location path and prefix.  The generated
@@ -67,8 +83,15 @@ public:
     return callFuncPacked(name, args.data());
   }
   
-  /// Set the source of the module
+  /// Set the source of the module, which must implement the module's
+  /// functions, replacing any source set before.  The module then only
+  /// generates their header and shims.
   void setSource(std::string source);
+
+  /// Set the number of threads that the parallel loops of the functions that
+  /// the calling thread calls next run on.  This only affects compiled OpenMP
+  /// modules; other modules run their parallel loops serially.
+  void setNumThreads(int numThreads);
   
 private:
   std::stringstream source;
@@ -76,12 +99,21 @@ private:
   std::string libname;
   std::string tmpdir;
   void* lib_handle;
+  void (*setOpenMPNumThreads)(int);
+  bool hasSetSource;
   std::vector<Stmt> funcs;
+  std::shared_ptr<CodeGen_LLVM> llvmCode;
 
   Target target;
   
   void setJITLibname();
   void setJITTmpdir();
+  void generateSource();
+  void writeSource(std::string path, std::string prefix);
+  bool compileLibrary(std::string* path, std::string* error);
+  void loadThreadControl();
+
+  static std::string randomName();
 };
 
 } // namespace ir
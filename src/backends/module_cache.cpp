@@ -0,0 +1,154 @@
+#include "module_cache.h"
+
+#include <chrono>
+#include <thread>
+
+#include "module.h"
+#include "taco/util/env.h"
+#include "taco/util/timers.h"
+#include "taco/util/thread_pool.h"
+
+using namespace std;
+
+namespace taco {
+namespace ir {
+
+// class ModuleCache
+shared_ptr<Module>
+ModuleCache::getOrCompile(const string& key,
+                          function<shared_ptr<Module>()> compile) {
+  unique_lock<std::mutex> lock(mutex);
+  auto it = entries.find(key);
+  while (it != entries.end()) {
+    shared_future<Entry> entry = it->second;
+    lock.unlock();
+
+    // Wait for the module if it is still being compiled by another thread
+    Entry cached = entry.get();
+    shared_ptr<Module> module = cached.module.lock();
+
+    lock.lock();
+    if (module != nullptr) {
+      stats.hits++;
+      stats.savedMilliseconds += cached.compileMilliseconds;
+      use(module);
+      return module;
+    }
+
+    // The module was unloaded, so it is compiled again
+    removeUnloaded();
+    it = entries.find(key);
+  }
+
+  removeUnloaded();
+  promise<Entry> compiled;
+  entries.insert({key, compiled.get_future().share()});
+  stats.misses++;
+  lock.unlock();
+
+  shared_ptr<Module> module;
+  Entry entry;
+  try {
+    util::Timer timer;
+    timer.start();
+    module = compile();
+    timer.stop();
+    entry.module = module;
+    entry.compileMilliseconds = timer.getResult().mean;
+  }
+  catch (...) {
+    // The entry is removed before it fails, so that only the threads that
+    // already wait for it see the failure
+    lock.lock();
+    entries.erase(key);
+    lock.unlock();
+    compiled.set_exception(current_exception());
+    throw;
+  }
+
+  // The module is kept loaded before its entry is ready, so that the threads
+  // that wait for it find it loaded
+  lock.lock();
+  use(module);
+  lock.unlock();
+  compiled.set_value(entry);
+  return module;
+}
+
+size_t ModuleCache::getSize() const {
+  lock_guard<std::mutex> lock(mutex);
+  size_t size = 0;
+  for (auto& entry : entries) {
+    if (!isUnloaded(entry.second)) {
+      size++;
+    }
+  }
+  return size;
+}
+
+size_t ModuleCache::getCapacity() const {
+  lock_guard<std::mutex> lock(mutex);
+  return capacity;
+}
+
+void ModuleCache::setCapacity(size_t capacity) {
+  lock_guard<std::mutex> lock(mutex);
+  this->capacity = capacity;
+  while (recent.size() > capacity) {
+    recent.pop_back();
+  }
+  removeUnloaded();
+}
+
+ModuleCacheStats ModuleCache::getStats() const {
+  lock_guard<std::mutex> lock(mutex);
+  return stats;
+}
+
+void ModuleCache::resetStats() {
+  lock_guard<std::mutex> lock(mutex);
+  stats = ModuleCacheStats();
+}
+
+void ModuleCache::clear() {
+  lock_guard<std::mutex> lock(mutex);
+  entries.clear();
+  recent.clear();
+}
+
+/// True iff the entry's module was compiled and has since been unloaded.
+bool ModuleCache::isUnloaded(const shared_future<Entry>& entry) {
+  return entry.wait_for(chrono::seconds(0)) == future_status::ready &&
+         entry.get().module.expired();
+}
+
+void ModuleCache::removeUnloaded() {
+  for (auto it = entries.begin(); it != entries.end();) {
+    it = isUnloaded(it->second) ? entries.erase(it) : next(it);
+  }
+}
+
+/// Moves the module to the front of the recently used modules, and releases
+/// the least recently used module if there are more than `capacity`.
+void ModuleCache::use(const shared_ptr<Module>& module) {
+  recent.remove(module);
+  recent.push_front(module);
+  if (recent.size() > capacity) {
+    recent.pop_back();
+  }
+}
+
+ModuleCache& getModuleCache() {
+  static ModuleCache cache(util::getSizeFromEnv("TACO_MODULE_CACHE_SIZE", 16));
+  return cache;
+}
+
+util::ThreadPool& getCompileThreadPool() {
+  // Compile jobs use the module cache, so it must be destroyed after the pool
+  getModuleCache();
+  static util::ThreadPool pool(util::getSizeFromEnv("TACO_COMPILE_THREADS",
+      thread::hardware_concurrency()));
+  return pool;
+}
+
+}}
@@ -0,0 +1,91 @@
+#ifndef TACO_MODULE_CACHE_H
+#define TACO_MODULE_CACHE_H
+
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <future>
+#include <functional>
+
+namespace taco {
+namespace util {
+class ThreadPool;
+}
+namespace ir {
+class Module;
+
+/// Hit and miss counts of the module cache, and the compile time saved by the
+/// hits.
+struct ModuleCacheStats {
+  size_t hits              = 0;
+  size_t misses            = 0;
+  double savedMilliseconds = 0.0;
+};
+
+/// A process-wide, thread-safe registry of compiled modules.  Modules are
+/// keyed by a canonical description of the kernels they contain, so tensors
+/// whose kernels have the same key share one loaded module and only bind
+/// their own arguments.  The cache only keeps the most recently used modules
+/// loaded; the others stay cached while tensors use them and are unloaded
+/// with the last tensor.
+class ModuleCache {
+public:
+  /// Create a cache that keeps the `capacity` most recently used modules
+  /// loaded.
+  explicit ModuleCache(size_t capacity) : capacity(capacity) {}
+
+  /// Returns the module cached under `key`.  If there is none, then `compile`
+  /// is called to compile it.  Concurrent requests for a key that is being
+  /// compiled wait for that compilation instead of compiling it again.
+  std::shared_ptr<Module>
+  getOrCompile(const std::string& key,
+               std::function<std::shared_ptr<Module>()> compile);
+
+  /// Returns the number of cached modules that are loaded.
+  size_t getSize() const;
+
+  /// Returns the number of recently used modules that are kept loaded.
+  size_t getCapacity() const;
+
+  /// Set the number of recently used modules that are kept loaded.
+  void setCapacity(size_t capacity);
+
+  /// Returns the hit/miss counts and saved compile time since the last reset.
+  ModuleCacheStats getStats() const;
+
+  /// Reset the hit/miss counts and saved compile time.
+  void resetStats();
+
+  /// Remove all modules from the cache.  Tensors that use them keep them.
+  void clear();
+
+private:
+  struct Entry {
+    std::weak_ptr<Module> module;
+    double compileMilliseconds;
+  };
+
+  mutable std::mutex mutex;
+  std::map<std::string, std::shared_future<Entry>> entries;
+  std::list<std::shared_ptr<Module>> recent;
+  size_t capacity;
+  ModuleCacheStats stats;
+
+  static bool isUnloaded(const std::shared_future<Entry>& entry);
+  void removeUnloaded();
+  void use(const std::shared_ptr<Module>& module);
+};
+
+/// Returns the process-wide module cache.  It keeps the
+/// `$TACO_MODULE_CACHE_SIZE` (default: 16) most recently used modules loaded.
+ModuleCache& getModuleCache();
+
+/// Returns the process-wide thread pool that compiles modules in the
+/// background.  It has `$TACO_COMPILE_THREADS` threads (default: the number of
+/// hardware threads).
+util::ThreadPool& getCompileThreadPool();
+
+}}
+#endif
@@ -1,5 +1,6 @@
 #include "taco/format.h"
 
+#include <cstdint>
 #include <iostream>
 
 #include "taco/error.h"
@@ -38,6 +39,30 @@ Format::Format(const std::vector<DimensionType>& dimensionTypes,
   }
 }
 
+Format::Format(const std::vector<DimensionType>& dimensionTypes,
+               const std::vector<int>& dimensionOrder,
+               IndexArrayType positionType)
+    : Format(dimensionTypes, dimensionOrder) {
+  this->positionType = positionType;
+}
+
+Format::Format(const std::vector<DimensionType>& dimensionTypes,
+               const std::vector<int>& dimensionOrder,
+               IndexArrayType positionType,
+               const std::vector<IndexArrayType>& indexTypes)
+    : Format(dimensionTypes, dimensionOrder, positionType) {
+  taco_uassert(indexTypes.size() == dimensionTypes.size()) <<
+      "You must provide an index type for every level";
+  for (size_t i = 0; i < indexTypes.size(); i++) {
+    taco_uassert(indexTypes[i] != IndexArrayType::Int64) <<
+        "Coordinates are int, so idx arrays cannot be Int64";
+    taco_uassert(dimensionTypes[i] != Dense ||
+                 indexTypes[i] == IndexArrayType::Int32) <<
+        "Dense levels have no idx array, so their index type must be Int32";
+    levels[i] = Level(dimensionOrder[i], dimensionTypes[i], indexTypes[i]);
+  }
+}
+
 size_t Format::getOrder() const {
   taco_iassert(this->dimensionTypes.size() == this->getDimensionOrder().size());
   return this->dimensionTypes.size();
@@ -51,6 +76,18 @@ const std::vector<int>& Format::getDimensionOrder() const {
   return this->dimensionOrder;
 }
 
+IndexArrayType Format::getPositionType() const {
+  return this->positionType;
+}
+
+std::vector<IndexArrayType> Format::getIndexTypes() const {
+  std::vector<IndexArrayType> indexTypes;
+  for (auto& level : levels) {
+    indexTypes.push_back(level.getIndexType());
+  }
+  return indexTypes;
+}
+
 bool Format::isDense() const {
   for (size_t i=0; i < dimensionTypes.size(); ++i) {
     if (dimensionTypes[i]!=Dense) {
@@ -65,6 +102,10 @@ bool operator==(const Format& a, const Format& b){
   auto bDimTypes = b.getDimensionTypes();
   auto aDimOrder = a.getDimensionOrder();
   auto bDimOrder = b.getDimensionOrder();
+  if (a.getPositionType() != b.getPositionType() ||
+      a.getIndexTypes() != b.getIndexTypes()) {
+    return false;
+  }
   if (aDimTypes.size() == bDimTypes.size()) {
     for (size_t i = 0; i < aDimTypes.size(); i++) {
       if ((aDimTypes[i] != bDimTypes[i]) || (aDimOrder[i] != bDimOrder[i])) {
@@ -81,8 +122,17 @@ bool operator!=(const Format& a, const Format& b) {
 }
 
 std::ostream &operator<<(std::ostream& os, const Format& format) {
-  return os << "(" << util::join(format.getDimensionTypes(), ",") << "; "
-            << util::join(format.getDimensionOrder(), ",") << ")";
+  os << "(" << util::join(format.getDimensionTypes(), ",") << "; "
+     << util::join(format.getDimensionOrder(), ",");
+  if (format.getPositionType() != IndexArrayType::Int32) {
+    os << "; " << format.getPositionType() << " positions";
+  }
+  auto indexTypes = format.getIndexTypes();
+  if (indexTypes != std::vector<IndexArrayType>(indexTypes.size(),
+                                                IndexArrayType::Int32)) {
+    os << "; " << util::join(indexTypes, ",") << " indices";
+  }
+  return os << ")";
 }
 
 std::ostream& operator<<(std::ostream& os, const DimensionType& dimensionType) {
@@ -100,6 +150,74 @@ std::ostream& operator<<(std::ostream& os, const DimensionType& dimensionType) {
   return os;
 }
 
+size_t getIndexArrayTypeSize(IndexArrayType indexType) {
+  switch (indexType) {
+    case IndexArrayType::Int32:
+      return sizeof(int32_t);
+    case IndexArrayType::Int64:
+      return sizeof(int64_t);
+    case IndexArrayType::UInt8:
+      return sizeof(uint8_t);
+    case IndexArrayType::UInt16:
+      return sizeof(uint16_t);
+  }
+  taco_ierror;
+  return 0;
+}
+
+std::ostream& operator<<(std::ostream& os, const IndexArrayType& indexType) {
+  switch (indexType) {
+    case IndexArrayType::Int32:
+      os << "int32";
+      break;
+    case IndexArrayType::Int64:
+      os << "int64";
+      break;
+    case IndexArrayType::UInt8:
+      os << "uint8";
+      break;
+    case IndexArrayType::UInt16:
+      os << "uint16";
+      break;
+  }
+  return os;
+}
+
+Format getNarrowestIndexFormat(const Format& format,
+                               const std::vector<int>& dimensionSizes) {
+  taco_iassert(dimensionSizes.size() == format.getOrder());
+  std::vector<IndexArrayType> indexTypes;
+  for (auto& level : format.getLevels()) {
+    const int size = dimensionSizes[level.getDimension()];
+    if (level.getType() == Dense) {
+      indexTypes.push_back(IndexArrayType::Int32);
+    }
+    else if (size <= (1 << 8)) {
+      indexTypes.push_back(IndexArrayType::UInt8);
+    }
+    else if (size <= (1 << 16)) {
+      indexTypes.push_back(IndexArrayType::UInt16);
+    }
+    else {
+      indexTypes.push_back(IndexArrayType::Int32);
+    }
+  }
+  return Format(format.getDimensionTypes(), format.getDimensionOrder(),
+                format.getPositionType(), indexTypes);
+}
+
+Format getExpandedFormat(const Format& format, size_t order) {
+  taco_iassert(format.getOrder() == 1);
+  const Level& level = format.getLevels()[0];
+  std::vector<int> dimensionOrder;
+  for (size_t i = 0; i < order; i++) {
+    dimensionOrder.push_back((int)i);
+  }
+  return Format(std::vector<DimensionType>(order, level.getType()),
+                dimensionOrder, format.getPositionType(),
+                std::vector<IndexArrayType>(order, level.getIndexType()));
+}
+
 std::ostream& operator<<(std::ostream& os, const Level& level) {
   return os << level.getDimension() << ":" << level.getType();
 }
@@ -0,0 +1,546 @@
+#include "io/coordinate_parser.h"
+
+#include <algorithm>
+#include <climits>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+#include "taco/tensor.h"
+#include "taco/format.h"
+#include "taco/error.h"
+#include "taco/storage/pack.h"
+#include "taco/util/parallel.h"
+
+using namespace std;
+
+namespace taco {
+namespace io {
+
+// Text is split across threads if each thread gets at least this many bytes.
+static const size_t minBytesPerThread = 1 << 20;
+
+// The powers of ten that are exactly representable as doubles.
+static const double powersOf10[] = {
+  1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+  1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+static inline bool isSpace(char c) {
+  return c == ' ' || c == '\t' || c == '\r';
+}
+
+static inline bool isDigit(char c) {
+  return c >= '0' && c <= '9';
+}
+
+static inline const char* skipSpaces(const char* p, const char* end) {
+  while (p < end && isSpace(*p)) {
+    p++;
+  }
+  return p;
+}
+
+static inline const char* skipLine(const char* p, const char* end) {
+  const char* lineBreak = (const char*)memchr(p, '\n', end - p);
+  return (lineBreak != nullptr) ? lineBreak + 1 : end;
+}
+
+/// Parse a non-negative integer no larger than INT_MAX.  Returns the end of the
+/// integer, or null if there is none.
+static inline const char* parseInt(const char* p, const char* end, int* value){
+  const char* begin = p;
+  long result = 0;
+  while (p < end && isDigit(*p)) {
+    result = result*10 + (*p - '0');
+    if (result > INT_MAX) {
+      return nullptr;
+    }
+    p++;
+  }
+  *value = (int)result;
+  return (p != begin) ? p : nullptr;
+}
+
+/// Parse a floating-point number.  Returns the end of the number, or null if
+/// there is none.  Numbers with at most 15 significant digits and a decimal
+/// exponent of at most 22 are computed exactly with one multiplication or
+/// division (Clinger's fast path); other numbers fall back to strtod.
+static inline const char* parseDouble(const char* p, const char* end,
+                                      double* value) {
+  const char* begin = p;
+  bool negative = false;
+  if (p < end && (*p == '-' || *p == '+')) {
+    negative = (*p == '-');
+    p++;
+  }
+
+  uint64_t mantissa = 0;
+  int numDigits = 0;
+  int exponent = 0;
+  bool exact = true;
+  bool hasDigits = false;
+  while (p < end && isDigit(*p)) {
+    if (numDigits < 19) {
+      mantissa = mantissa*10 + (*p - '0');
+      numDigits += (mantissa != 0);
+    }
+    else {
+      exponent++;
+      exact = false;
+    }
+    hasDigits = true;
+    p++;
+  }
+  if (p < end && *p == '.') {
+    p++;
+    while (p < end && isDigit(*p)) {
+      if (numDigits < 19) {
+        mantissa = mantissa*10 + (*p - '0');
+        numDigits += (mantissa != 0);
+        exponent--;
+      }
+      else {
+        exact = false;
+      }
+      hasDigits = true;
+      p++;
+    }
+  }
+  if (hasDigits && p < end && (*p == 'e' || *p == 'E')) {
+    const char* exponentBegin = p++;
+    bool negativeExponent = false;
+    if (p < end && (*p == '-' || *p == '+')) {
+      negativeExponent = (*p == '-');
+      p++;
+    }
+    int exponentValue = 0;
+    if (p < end && isDigit(*p)) {
+      while (p < end && isDigit(*p)) {
+        exponentValue = std::min(exponentValue*10 + (*p - '0'), 100000);
+        p++;
+      }
+      exponent += negativeExponent ? -exponentValue : exponentValue;
+    }
+    else {
+      p = exponentBegin;
+    }
+  }
+
+  if (hasDigits && exact && numDigits <= 15 && exponent >= -22 &&
+      exponent <= 22) {
+    double result = (double)mantissa;
+    result = (exponent < 0) ? result / powersOf10[-exponent]
+                            : result * powersOf10[exponent];
+    *value = negative ? -result : result;
+    return p;
+  }
+
+  // Slow path, e.g. for long mantissas, large exponents, inf and nan
+  char token[128];
+  size_t length = 0;
+  for (p = begin; p < end && !isSpace(*p) && *p != '\n'; p++) {
+    if (length == sizeof(token)-1) {
+      return nullptr;
+    }
+    token[length++] = *p;
+  }
+  token[length] = '\0';
+  char* tokenEnd;
+  *value = strtod(token, &tokenEnd);
+  return (tokenEnd != token) ? begin + (tokenEnd - token) : nullptr;
+}
+
+namespace {
+enum class LineResult {Parsed, End, Malformed};
+}
+
+/// Parse the next line of [*p,end) that is neither empty nor a comment, and
+/// move `*p` past it.  `*line` is set to the start of the line.
+static inline LineResult parseLine(const char** p, const char* end,
+                                   size_t order, int base, char comment,
+                                   int* coordinate, double* value,
+                                   const char** line) {
+  const char* q = *p;
+  while (true) {
+    *line = q;
+    q = skipSpaces(q, end);
+    if (q == end) {
+      *p = end;
+      return LineResult::End;
+    }
+    if (*q != '\n' && *q != comment) {
+      break;
+    }
+    q = skipLine(q, end);
+  }
+
+  for (size_t i = 0; i < order; i++) {
+    q = parseInt(skipSpaces(q, end), end, &coordinate[i]);
+    if (q == nullptr || coordinate[i] < base) {
+      return LineResult::Malformed;
+    }
+    coordinate[i] -= base;
+  }
+  q = parseDouble(skipSpaces(q, end), end, value);
+  if (q == nullptr) {
+    return LineResult::Malformed;
+  }
+  *p = skipLine(q, end);
+  return LineResult::Parsed;
+}
+
+static void reportMalformedLine(const char* line, const char* end,
+                                size_t order) {
+  taco_uerror << "Could not parse the line '" << getLine(&line, end) <<
+      "' as " << order << " coordinates and a value";
+}
+
+/// True iff coordinate `a` comes strictly before coordinate `b` when their
+/// dimensions are compared in the order of `levelDimensions`.
+static inline bool isBefore(const int* a, const int* b,
+                            const vector<size_t>& levelDimensions) {
+  for (size_t dimension : levelDimensions) {
+    if (a[dimension] != b[dimension]) {
+      return a[dimension] < b[dimension];
+    }
+  }
+  return false;
+}
+
+static void parseChunk(const char* p, const char* end, size_t order, int base,
+                       char comment, const vector<size_t>& levelDimensions,
+                       CoordinateChunk* chunk) {
+  chunk->coordinates.resize(order);
+  chunk->dimensions.resize(order, 0);
+  chunk->sorted = !levelDimensions.empty();
+  vector<int> coordinate(order);
+  vector<int> previous(order);
+  double value;
+  const char* line;
+  LineResult result;
+  while ((result = parseLine(&p, end, order, base, comment, coordinate.data(),
+                             &value, &line)) == LineResult::Parsed) {
+    if (chunk->sorted && !chunk->values.empty()) {
+      chunk->sorted = isBefore(previous.data(), coordinate.data(),
+                               levelDimensions);
+    }
+    for (size_t i = 0; i < order; i++) {
+      chunk->coordinates[i].push_back(coordinate[i]);
+      chunk->dimensions[i] = std::max(chunk->dimensions[i], coordinate[i]+1);
+    }
+    chunk->values.push_back(value);
+    std::swap(previous, coordinate);
+  }
+  if (result == LineResult::Malformed) {
+    chunk->error = line;
+  }
+}
+
+std::string getLine(const char** begin, const char* end) {
+  const char* lineEnd = skipLine(*begin, end);
+  std::string line(*begin, lineEnd);
+  *begin = lineEnd;
+  while (!line.empty() && (line.back() == '\n' || line.back() == '\r')) {
+    line.pop_back();
+  }
+  return line;
+}
+
+size_t countTokens(const char* begin, const char* end, char comment) {
+  const char* p = begin;
+  while (p < end) {
+    p = skipSpaces(p, end);
+    if (p < end && *p != '\n' && *p != comment) {
+      break;
+    }
+    p = skipLine(p, end);
+  }
+
+  size_t numTokens = 0;
+  while (p < end && *p != '\n') {
+    numTokens++;
+    while (p < end && !isSpace(*p) && *p != '\n') {
+      p++;
+    }
+    p = skipSpaces(p, end);
+  }
+  return numTokens;
+}
+
+std::vector<CoordinateChunk>
+parseCoordinates(const char* begin, const char* end, size_t order, int base,
+                 char comment, const std::vector<size_t>& levelDimensions) {
+  // Split the text at the first line break after each equal part
+  const size_t size = end - begin;
+  const int numThreads = util::getNumThreads(size, minBytesPerThread);
+  vector<const char*> bounds(numThreads + 1);
+  bounds[0] = begin;
+  bounds[numThreads] = end;
+  for (int t = 1; t < numThreads; t++) {
+    const char* p = begin + util::partition(size, t, numThreads);
+    p = std::max(p, bounds[t-1]);
+    bounds[t] = (p == begin || p[-1] == '\n') ? p : skipLine(p, end);
+  }
+
+  vector<CoordinateChunk> chunks(numThreads);
+  util::parallelFor(numThreads, [&](int t) {
+    parseChunk(bounds[t], bounds[t+1], order, base, comment, levelDimensions,
+               &chunks[t]);
+  });
+
+  for (auto& chunk : chunks) {
+    if (chunk.error != nullptr) {
+      reportMalformedLine(chunk.error, end, order);
+    }
+  }
+  return chunks;
+}
+
+/// Returns the format of a tensor of the given order.  A format with one
+/// level applies to every dimension, as in the TensorBase constructor.
+static Format getTensorFormat(const Format& format, size_t order) {
+  return (order > 1 && format.getOrder() == 1)
+         ? getExpandedFormat(format, order) : format;
+}
+
+/// True iff the chunks hold coordinates that are sorted in the order of
+/// `levelDimensions`, both within and across chunks.
+static bool isSorted(const vector<CoordinateChunk>& chunks,
+                     const vector<size_t>& levelDimensions) {
+  const size_t order = levelDimensions.size();
+  vector<int> previous(order);
+  vector<int> first(order);
+  bool empty = true;
+  for (auto& chunk : chunks) {
+    if (!chunk.sorted) {
+      return false;
+    }
+    if (chunk.values.empty()) {
+      continue;
+    }
+    for (size_t i = 0; i < order; i++) {
+      first[i] = chunk.coordinates[i].front();
+    }
+    if (!empty && !isBefore(previous.data(), first.data(), levelDimensions)) {
+      return false;
+    }
+    for (size_t i = 0; i < order; i++) {
+      previous[i] = chunk.coordinates[i].back();
+    }
+    empty = false;
+  }
+  return order > 0;
+}
+
+/// Pack sorted chunks into a tensor of the format with a SortedPacker.
+/// Returns false if the packer cannot pack them.
+static bool packSorted(const vector<CoordinateChunk>& chunks,
+                       const Format& format, const vector<int>& dimensions,
+                       TensorBase* tensor) {
+  if (!storage::SortedPacker::canPack(format, dimensions)) {
+    return false;
+  }
+  const size_t order = dimensions.size();
+  storage::SortedPacker packer(format, dimensions);
+  vector<int> coordinate(order);
+  for (auto& chunk : chunks) {
+    for (size_t k = 0; k < chunk.values.size(); k++) {
+      for (size_t i = 0; i < order; i++) {
+        coordinate[i] = chunk.coordinates[i][k];
+      }
+      if (!packer.insert(coordinate.data(), chunk.values[k])) {
+        return false;
+      }
+    }
+  }
+
+  vector<vector<int*>> indices;
+  double* values;
+  packer.finish(dimensions, &indices, &values);
+  *tensor = TensorBase(ComponentType::Double, dimensions, format);
+  tensor->adoptStorage(indices, values);
+  return true;
+}
+
+/// Append the coordinates below position `parentPosition` of level `level` of
+/// packed dense and sparse levels, and their values, to the chunk.
+static void unpack(const vector<vector<int*>>& indices, const double* values,
+                   const Format& format, const vector<int>& dimensions,
+                   size_t level, size_t parentPosition, vector<int>* coordinate,
+                   CoordinateChunk* chunk) {
+  const size_t order = format.getOrder();
+  if (level == order) {
+    for (size_t i = 0; i < order; i++) {
+      chunk->coordinates[i].push_back((*coordinate)[i]);
+    }
+    chunk->values.push_back(values[parentPosition]);
+    return;
+  }
+
+  const size_t dimension = format.getLevels()[level].getDimension();
+  if (format.getLevels()[level].getType() == Dense) {
+    const size_t size = dimensions[dimension];
+    for (size_t c = 0; c < size; c++) {
+      (*coordinate)[dimension] = (int)c;
+      unpack(indices, values, format, dimensions, level+1,
+             parentPosition * size + c, coordinate, chunk);
+    }
+  }
+  else {
+    const int* pos = indices[level][0];
+    const int* idx = indices[level][1];
+    for (int p = pos[parentPosition]; p < pos[parentPosition+1]; p++) {
+      (*coordinate)[dimension] = idx[p];
+      unpack(indices, values, format, dimensions, level+1, p, coordinate,
+             chunk);
+    }
+  }
+}
+
+const char* readSorted(const char* begin, const char* end, size_t order,
+                       int base, char comment, size_t maxCoordinates,
+                       const Format& format, std::vector<int> dimensions,
+                       TensorBase* tensor, CoordinateChunk* prefix) {
+  prefix->coordinates.assign(order, vector<int>());
+  prefix->values.clear();
+  prefix->dimensions.assign(order, 0);
+  prefix->sorted = true;
+  Format tensorFormat = getTensorFormat(format, order);
+  const bool inferDimensions = dimensions.empty();
+  if (inferDimensions) {
+    dimensions.resize(order, 0);
+  }
+  if (tensorFormat.getOrder() != order ||
+      !storage::SortedPacker::canPack(tensorFormat, dimensions)) {
+    return begin;
+  }
+
+  storage::SortedPacker packer(tensorFormat, dimensions);
+  vector<int> coordinate(order);
+  vector<int> packedDimensions(order, 0);
+  double value;
+  const char* line;
+  const char* unsorted = nullptr;
+  LineResult result = LineResult::End;
+  for (size_t n = 0; n < maxCoordinates; n++) {
+    result = parseLine(&begin, end, order, base, comment, coordinate.data(),
+                       &value, &line);
+    if (result != LineResult::Parsed) {
+      break;
+    }
+    if (!packer.insert(coordinate.data(), value)) {
+      unsorted = line;
+      break;
+    }
+    for (size_t i = 0; i < order; i++) {
+      packedDimensions[i] = std::max(packedDimensions[i], coordinate[i] + 1);
+    }
+  }
+  if (result == LineResult::Malformed) {
+    reportMalformedLine(line, end, order);
+  }
+  if (inferDimensions) {
+    dimensions = packedDimensions;
+  }
+
+  vector<vector<int*>> indices;
+  double* values;
+  packer.finish(dimensions, &indices, &values);
+  if (unsorted == nullptr) {
+    *tensor = TensorBase(ComponentType::Double, dimensions, tensorFormat);
+    tensor->adoptStorage(indices, values);
+    return nullptr;
+  }
+
+  // The packed lines are handed back as coordinates, so that they are not
+  // parsed again
+  unpack(indices, values, tensorFormat, dimensions, 0, 0, &coordinate, prefix);
+  prefix->dimensions = packedDimensions;
+  for (auto& levelIndices : indices) {
+    for (int* index : levelIndices) {
+      free(index);
+    }
+  }
+  free(values);
+  return unsorted;
+}
+
+TensorBase readCoordinates(const char* begin, const char* end, size_t order,
+                           int base, char comment, size_t maxCoordinates,
+                           const Format& format, std::vector<int> dimensions,
+                           bool pack) {
+  // Text that is parsed on one thread is streamed into the packer, which
+  // needs no buffers for the coordinates.  If it turns out to be unsorted,
+  // the lines before the first unsorted one are not parsed again.
+  TensorBase tensor;
+  vector<CoordinateChunk> chunks(1);
+  if (pack && util::getNumThreads(end - begin, minBytesPerThread) == 1) {
+    begin = readSorted(begin, end, order, base, comment, maxCoordinates,
+                       format, dimensions, &tensor, &chunks[0]);
+    if (begin == nullptr) {
+      return tensor;
+    }
+  }
+  else {
+    chunks.clear();
+  }
+
+  // Other text is parsed in parallel, and the chunks check that their
+  // coordinates are sorted in the level order of the format
+  Format tensorFormat = getTensorFormat(format, order);
+  vector<size_t> levelDimensions;
+  if (pack && tensorFormat.getOrder() == order) {
+    for (auto& level : tensorFormat.getLevels()) {
+      levelDimensions.push_back(level.getDimension());
+    }
+  }
+  for (auto& chunk : parseCoordinates(begin, end, order, base, comment,
+                                      levelDimensions)) {
+    chunks.push_back(std::move(chunk));
+  }
+  for (auto& chunk : chunks) {
+    size_t chunkSize = std::min(maxCoordinates, chunk.values.size());
+    chunk.values.resize(chunkSize);
+    for (auto& dimCoordinates : chunk.coordinates) {
+      dimCoordinates.resize(chunkSize);
+    }
+    maxCoordinates -= chunkSize;
+  }
+  if (dimensions.empty()) {
+    dimensions.resize(order, 0);
+    for (auto& chunk : chunks) {
+      for (size_t i = 0; i < order; i++) {
+        dimensions[i] = std::max(dimensions[i], chunk.dimensions[i]);
+      }
+    }
+  }
+
+  // Sorted coordinates are packed without being buffered in the tensor and
+  // sorted
+  if (pack && isSorted(chunks, levelDimensions) &&
+      packSorted(chunks, tensorFormat, dimensions, &tensor)) {
+    return tensor;
+  }
+
+  tensor = TensorBase(ComponentType::Double, dimensions, format);
+  insertCoordinates(chunks, &tensor);
+  if (pack) {
+    tensor.pack();
+  }
+  return tensor;
+}
+
+void insertCoordinates(const std::vector<CoordinateChunk>& chunks,
+                       TensorBase* tensor) {
+  size_t numCoordinates = 0;
+  for (auto& chunk : chunks) {
+    numCoordinates += chunk.values.size();
+  }
+  tensor->reserve(numCoordinates);
+  for (auto& chunk : chunks) {
+    tensor->insertBulk(chunk.coordinates, chunk.values);
+  }
+}
+
+}}
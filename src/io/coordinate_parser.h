@@ -0,0 +1,83 @@
+#ifndef TACO_IO_COORDINATE_PARSER_H
+#define TACO_IO_COORDINATE_PARSER_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace taco {
+class TensorBase;
+class Format;
+namespace io {
+
+/// The coordinates and values parsed from one chunk of a text file.
+struct CoordinateChunk {
+  /// The coordinates of each tensor dimension.
+  std::vector<std::vector<int>> coordinates;
+  std::vector<double>           values;
+
+  /// One more than the largest coordinate of each tensor dimension.
+  std::vector<int>              dimensions;
+
+  /// The first line that could not be parsed, or null.
+  const char*                   error = nullptr;
+
+  /// True iff the coordinates are strictly increasing in the level order
+  /// that parseCoordinates checked, if any.
+  bool                          sorted = true;
+};
+
+/// Returns the first line of [*begin,end), without the line break, and moves
+/// `*begin` to the start of the next line.
+std::string getLine(const char** begin, const char* end);
+
+/// Returns the number of whitespace-separated tokens on the first line of
+/// [begin,end) that is neither empty nor a comment, or 0 if there is none.
+size_t countTokens(const char* begin, const char* end, char comment);
+
+/// Parse the lines of text in [begin,end), each with `order` integer
+/// coordinates followed by a value.  The text is split at line breaks into one
+/// chunk per thread, which are parsed in parallel and returned in file order.
+/// Empty lines and lines that start with `comment` are skipped, and `base` is
+/// subtracted from the coordinates (e.g. 1 for one-based files).  If
+/// `levelDimensions` is not empty, each chunk records whether its coordinates
+/// are sorted when their dimensions are compared in that order.
+std::vector<CoordinateChunk>
+parseCoordinates(const char* begin, const char* end, size_t order, int base,
+                 char comment, const std::vector<size_t>& levelDimensions={});
+
+/// Parse lines of coordinates like parseCoordinates, but on one thread, and
+/// pack them into `format` as they are parsed instead of collecting them.  At
+/// most `maxCoordinates` lines are read.  `dimensions` holds the dimension
+/// sizes, or is empty if they are inferred from the largest coordinates.
+/// Returns null if every line was packed into `*tensor`.  Packing stops at the
+/// first line whose coordinate does not come after the previous one in the
+/// level order of the format: that line is returned, and the lines before it
+/// are unpacked into `*prefix`, so that only the rest of the text is parsed
+/// again.  The fallback then costs one walk over the packed prefix on top of
+/// packing it.  If the format cannot be packed this way (see
+/// storage::SortedPacker), `begin` is returned without parsing anything.
+const char* readSorted(const char* begin, const char* end, size_t order,
+                       int base, char comment, size_t maxCoordinates,
+                       const Format& format, std::vector<int> dimensions,
+                       TensorBase* tensor, CoordinateChunk* prefix);
+
+/// Read the lines of coordinates in [begin,end) into a tensor of the format,
+/// like parseCoordinates, and pack it if `pack` is true.  At most
+/// `maxCoordinates` lines are read.  `dimensions` holds the dimension sizes,
+/// or is empty if they are inferred from the largest coordinates.  Text that
+/// is parsed on one thread anyway is packed as it is parsed if it is sorted
+/// (see readSorted).  Other text is parsed in parallel, and if the chunks turn
+/// out to be sorted in the level order of the format, they are packed without
+/// being sorted.
+TensorBase readCoordinates(const char* begin, const char* end, size_t order,
+                           int base, char comment, size_t maxCoordinates,
+                           const Format& format, std::vector<int> dimensions,
+                           bool pack);
+
+/// Insert the coordinates and values of the chunks, in order, into a tensor.
+void insertCoordinates(const std::vector<CoordinateChunk>& chunks,
+                       TensorBase* tensor);
+
+}}
+#endif
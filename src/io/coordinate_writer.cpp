@@ -0,0 +1,252 @@
+#include "io/coordinate_writer.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <limits>
+#include <ostream>
+#include <vector>
+
+#include "taco/tensor.h"
+#include "taco/format.h"
+#include "taco/error.h"
+#include "taco/storage/storage.h"
+#include "taco/util/parallel.h"
+
+using namespace std;
+
+namespace taco {
+namespace io {
+
+// The first level is split into ranges of about this many components, and each
+// thread formats one range at a time.
+static const size_t componentsPerRange = 1 << 18;
+
+// The most bytes that a coordinate and the space after it take.
+static const size_t maxCoordinateBytes = 12;
+
+// The most bytes that a value and the line break after it take.
+static const size_t maxValueBytes = 64;
+
+namespace {
+
+/// The index arrays of one format level.
+struct LevelIndex {
+  DimensionType  type;
+  size_t         dimension;  // The tensor dimension of the level
+  int            size;       // The size of a dense level or a fixed segment
+  const int*     pos;
+  const int*     idx;
+  const int*     segmentSizes;  // Of a fixed level, if they are known
+  IndexArrayType positionType;
+  IndexArrayType indexType;
+
+  /// Returns the positions of the level below position `parent` of the level
+  /// above, without the padding of fixed segments whose size is known.
+  void getRange(size_t parent, size_t* begin, size_t* end) const {
+    if (type == Sparse) {
+      *begin = storage::loadIndex(pos, positionType, parent);
+      *end   = storage::loadIndex(pos, positionType, parent + 1);
+    }
+    else {
+      *begin = parent * size;
+      *end   = *begin + ((segmentSizes != nullptr) ? segmentSizes[parent]
+                                                   : size);
+    }
+  }
+};
+
+/// Formats the components below a range of the first level as lines of text.
+class RangeFormatter {
+public:
+  RangeFormatter(const vector<LevelIndex>& levels, const double* values,
+                 ComponentType ctype, int base, bool withCoordinates,
+                 int precision)
+      : levels(levels), values(values), ctype(ctype), base(base),
+        withCoordinates(withCoordinates), precision(precision),
+        coordinate(levels.size()), used(0) {
+    maxLineBytes = maxValueBytes +
+                   (withCoordinates ? levels.size() * maxCoordinateBytes : 0);
+  }
+
+  /// Format the components below positions [begin,end) of the first level,
+  /// replacing the text of the previous range.
+  void format(size_t begin, size_t end) {
+    used = 0;
+    if (levels.empty()) {
+      formatLine(0);
+    }
+    else {
+      formatLevel(0, 0, begin, end);
+    }
+  }
+
+  const char* data() const {
+    return text.data();
+  }
+
+  size_t size() const {
+    return used;
+  }
+
+private:
+  const vector<LevelIndex>& levels;
+  const double*             values;
+  ComponentType             ctype;
+  int                       base;
+  bool                      withCoordinates;
+  int                       precision;
+  vector<int>               coordinate;
+  size_t                    maxLineBytes;
+  vector<char>              text;
+  size_t                    used;
+
+  void formatLevel(size_t level, size_t parent, size_t begin, size_t end) {
+    const LevelIndex& index = levels[level];
+    const bool isLast = (level + 1 == levels.size());
+    for (size_t p = begin; p < end; p++) {
+      if (index.type == Dense) {
+        coordinate[index.dimension] = (int)(p - parent * index.size);
+      }
+      else {
+        int c = (int)storage::loadIndex(index.idx, index.indexType, p);
+        // Fixed segments below level 0 are padded to their size with zeros at
+        // the last coordinate of the segment, or at coordinate 0 if it is
+        // empty.  Without their sizes, a segment ends where its coordinate
+        // repeats, and one that holds only a zero at coordinate 0 is empty.
+        if (index.type == Fixed && level > 0 && index.segmentSizes == nullptr &&
+            ((p > begin && c == coordinate[index.dimension]) ||
+             (p == begin && c == 0 && isLast &&
+              loadValue(values, ctype, p) == 0.0))) {
+          break;
+        }
+        coordinate[index.dimension] = c;
+      }
+
+      if (isLast) {
+        formatLine(p);
+      }
+      else {
+        size_t childBegin, childEnd;
+        levels[level + 1].getRange(p, &childBegin, &childEnd);
+        formatLevel(level + 1, p, childBegin, childEnd);
+      }
+    }
+  }
+
+  void formatLine(size_t position) {
+    if (text.size() - used < maxLineBytes) {
+      text.resize(std::max(2 * text.size(), used + maxLineBytes));
+    }
+    char* p = text.data() + used;
+    if (withCoordinates) {
+      for (int c : coordinate) {
+        p = formatInt(p, (long)c + base);
+        *p++ = ' ';
+      }
+    }
+    switch (ctype.getKind()) {
+      case ComponentType::Bool:
+        *p++ = ((const bool*)values)[position] ? '1' : '0';
+        break;
+      case ComponentType::Int: {
+        long value = ((const int*)values)[position];
+        if (value < 0) {
+          *p++ = '-';
+          value = -value;
+        }
+        p = formatInt(p, value);
+        break;
+      }
+      case ComponentType::Float:
+      case ComponentType::Double:
+      case ComponentType::Unknown:
+        p += snprintf(p, maxValueBytes - 1, "%.*g", precision,
+                      loadValue(values, ctype, position));
+        break;
+    }
+    *p++ = '\n';
+    used = p - text.data();
+  }
+
+  /// Write the digits of a non-negative integer.
+  static inline char* formatInt(char* p, long value) {
+    char digits[maxCoordinateBytes];
+    int numDigits = 0;
+    do {
+      digits[numDigits++] = (char)('0' + value % 10);
+      value /= 10;
+    } while (value != 0);
+    while (numDigits > 0) {
+      *p++ = digits[--numDigits];
+    }
+    return p;
+  }
+};
+
+}
+
+void writeCoordinates(std::ostream& stream, const TensorBase& tensor, int base,
+                      bool withCoordinates) {
+  taco_iassert(base >= 0);
+  const storage::Storage& storage = tensor.getStorage();
+  const double* values = storage.getValues();
+  if (values == nullptr) {
+    return;
+  }
+
+  vector<LevelIndex> levels;
+  for (size_t i = 0; i < tensor.getOrder(); i++) {
+    const Level& level = tensor.getFormat().getLevels()[i];
+    const vector<int*>& index = storage.getDimensionIndex(i);
+    LevelIndex levelIndex;
+    levelIndex.type      = level.getType();
+    levelIndex.dimension = level.getDimension();
+    levelIndex.size      = (level.getType() == Sparse) ? 0 : index[0][0];
+    levelIndex.pos       = (level.getType() == Sparse) ? index[0] : nullptr;
+    levelIndex.idx       = (level.getType() == Dense) ? nullptr : index[1];
+    levelIndex.segmentSizes = storage.getSegmentSizes(i);
+    levelIndex.positionType = tensor.getFormat().getPositionType();
+    levelIndex.indexType = level.getIndexType();
+    levels.push_back(levelIndex);
+  }
+
+  // Positions of the first level
+  size_t begin = 0;
+  size_t end = 1;
+  if (!levels.empty()) {
+    levels[0].getRange(0, &begin, &end);
+  }
+  const size_t numPositions = end - begin;
+  const size_t numValues = storage.getSize().numValues();
+  const size_t numRanges =
+      std::min(std::max((numValues + componentsPerRange - 1) /
+                        componentsPerRange, (size_t)1), numPositions);
+  const int numThreads =
+      (int)std::min((size_t)util::getNumThreads(numValues, componentsPerRange),
+                    std::max(numRanges, (size_t)1));
+
+  // Digits past max_digits10 only print the binary rounding error
+  const int precision =
+      (int)std::min(stream.precision(),
+                    (streamsize)numeric_limits<double>::max_digits10);
+  vector<RangeFormatter> formatters(numThreads,
+                                    RangeFormatter(levels, values,
+                                                   storage.getComponentType(),
+                                                   base, withCoordinates,
+                                                   precision));
+  for (size_t range = 0; range < numRanges; range += numThreads) {
+    const int numBatchRanges = (int)std::min((size_t)numThreads,
+                                             numRanges - range);
+    util::parallelFor(numBatchRanges, [&](int t) {
+      const int part = (int)range + t;
+      formatters[t].format(
+          begin + util::partition(numPositions, part, (int)numRanges),
+          begin + util::partition(numPositions, part + 1, (int)numRanges));
+    });
+    for (int t = 0; t < numBatchRanges; t++) {
+      stream.write(formatters[t].data(), formatters[t].size());
+    }
+  }
+}
+
+}}
@@ -0,0 +1,21 @@
+#ifndef TACO_IO_COORDINATE_WRITER_H
+#define TACO_IO_COORDINATE_WRITER_H
+
+#include <iosfwd>
+
+namespace taco {
+class TensorBase;
+namespace io {
+
+/// Write one line of text per component in the packed storage of a tensor, in
+/// the level order of its format.  Each line holds the coordinates of the
+/// component plus `base` (e.g. 1 for one-based files) in tensor dimension
+/// order, unless `withCoordinates` is false, followed by the value formatted
+/// like `stream << value`.  The storage arrays are walked directly, and ranges
+/// of the first level are formatted into separate buffers on separate threads
+/// and written in order.
+void writeCoordinates(std::ostream& stream, const TensorBase& tensor, int base,
+                      bool withCoordinates=true);
+
+}}
+#endif
@@ -0,0 +1,157 @@
+#include "io/gzip_stream.h"
+
+#include <cerrno>
+#include <cstring>
+
+#ifdef TACO_ZLIB
+#include <zlib.h>
+#endif
+
+#include "taco/error.h"
+
+using namespace std;
+
+namespace taco {
+namespace io {
+
+// The size of the stream buffer and of zlib's own buffers.
+static const size_t bufferSize = 1 << 17;
+
+bool hasGzip() {
+#ifdef TACO_ZLIB
+  return true;
+#else
+  return false;
+#endif
+}
+
+bool isGzipFile(std::string filename) {
+  const string suffix = ".gz";
+  return filename.size() > suffix.size() &&
+         filename.compare(filename.size() - suffix.size(), suffix.size(),
+                          suffix) == 0;
+}
+
+#ifdef TACO_ZLIB
+static string getErrorMessage(gzFile file) {
+  int error;
+  const char* message = gzerror(file, &error);
+  return (error == Z_ERRNO) ? string(strerror(errno)) : string(message);
+}
+#endif
+
+GzipStreamBuffer::GzipStreamBuffer(std::string filename, bool write)
+    : filename(filename), file(nullptr), buffer(bufferSize), writing(write) {
+#ifdef TACO_ZLIB
+  gzFile gzfile = gzopen(filename.c_str(), write ? "wb" : "rb");
+  taco_uassert(gzfile != nullptr) << "Error opening file: " << filename;
+  gzbuffer(gzfile, bufferSize);
+  file = gzfile;
+  if (writing) {
+    setp(buffer.data(), buffer.data() + buffer.size());
+  }
+  else {
+    setg(buffer.data(), buffer.data(), buffer.data());
+  }
+#else
+  taco_uerror << "Cannot open " << filename << " since taco was built "
+              << "without zlib";
+#endif
+}
+
+GzipStreamBuffer::~GzipStreamBuffer() {
+  try {
+    close();
+  }
+  catch (...) {
+  }
+}
+
+void GzipStreamBuffer::close() {
+#ifdef TACO_ZLIB
+  if (file == nullptr) {
+    return;
+  }
+  gzFile gzfile = (gzFile)file;
+  file = nullptr;
+  if (writing && pptr() > pbase()) {
+    int size = (int)(pptr() - pbase());
+    setp(buffer.data(), buffer.data() + buffer.size());
+    if (gzwrite(gzfile, buffer.data(), size) != size) {
+      string message = getErrorMessage(gzfile);
+      gzclose(gzfile);
+      taco_uerror << "Error writing file: " << filename << " (" << message
+                  << ")";
+    }
+  }
+  taco_uassert(gzclose(gzfile) == Z_OK) << "Error closing file: " << filename;
+#endif
+}
+
+GzipStreamBuffer::int_type GzipStreamBuffer::underflow() {
+#ifdef TACO_ZLIB
+  if (gptr() < egptr()) {
+    return traits_type::to_int_type(*gptr());
+  }
+  if (file == nullptr || writing) {
+    return traits_type::eof();
+  }
+  int size = gzread((gzFile)file, buffer.data(), (unsigned)buffer.size());
+  taco_uassert(size >= 0) << "Error reading file: " << filename << " ("
+                          << getErrorMessage((gzFile)file) << ")";
+  setg(buffer.data(), buffer.data(), buffer.data() + size);
+  return (size > 0) ? traits_type::to_int_type(*gptr()) : traits_type::eof();
+#else
+  return traits_type::eof();
+#endif
+}
+
+GzipStreamBuffer::int_type GzipStreamBuffer::overflow(int_type c) {
+  if (file == nullptr || !writing) {
+    return traits_type::eof();
+  }
+  writeBuffer();
+  if (!traits_type::eq_int_type(c, traits_type::eof())) {
+    *pptr() = traits_type::to_char_type(c);
+    pbump(1);
+  }
+  return traits_type::not_eof(c);
+}
+
+int GzipStreamBuffer::sync() {
+  if (file != nullptr && writing) {
+    writeBuffer();
+  }
+  return 0;
+}
+
+void GzipStreamBuffer::writeBuffer() {
+#ifdef TACO_ZLIB
+  int size = (int)(pptr() - pbase());
+  if (size > 0) {
+    taco_uassert(gzwrite((gzFile)file, pbase(), size) == size) <<
+        "Error writing file: " << filename << " ("
+        << getErrorMessage((gzFile)file) << ")";
+  }
+  setp(buffer.data(), buffer.data() + buffer.size());
+#endif
+}
+
+GzipInputStream::GzipInputStream(std::string filename)
+    : std::istream(nullptr), buffer(filename, false) {
+  rdbuf(&buffer);
+  // Report errors from the stream buffer instead of ending the input early
+  exceptions(std::ios::badbit);
+}
+
+GzipOutputStream::GzipOutputStream(std::string filename)
+    : std::ostream(nullptr), buffer(filename, true) {
+  rdbuf(&buffer);
+  exceptions(std::ios::badbit);
+}
+
+void GzipOutputStream::close() {
+  buffer.close();
+}
+
+}}
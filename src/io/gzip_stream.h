@@ -0,0 +1,71 @@
+#ifndef TACO_IO_GZIP_STREAM_H
+#define TACO_IO_GZIP_STREAM_H
+
+#include <istream>
+#include <ostream>
+#include <streambuf>
+#include <string>
+#include <vector>
+
+namespace taco {
+namespace io {
+
+/// Returns true if taco was built with zlib (TACO_ZLIB), so that it can read
+/// and write gzip-compressed files.
+bool hasGzip();
+
+/// Returns true if the file name ends with `.gz`.
+bool isGzipFile(std::string filename);
+
+/// A stream buffer that decompresses a gzip file as it is read, or compresses
+/// data into a gzip file as it is written.  Files that are not compressed are
+/// read as they are.
+class GzipStreamBuffer : public std::streambuf {
+public:
+  GzipStreamBuffer(std::string filename, bool write);
+  ~GzipStreamBuffer();
+
+  GzipStreamBuffer(const GzipStreamBuffer&) = delete;
+  GzipStreamBuffer& operator=(const GzipStreamBuffer&) = delete;
+
+  /// Write the buffered data and close the file.
+  void close();
+
+protected:
+  int_type underflow();
+  int_type overflow(int_type c);
+  int sync();
+
+private:
+  std::string       filename;
+  void*             file;  // The gzFile
+  std::vector<char> buffer;
+  bool              writing;
+
+  void writeBuffer();
+};
+
+/// An input stream that decompresses a gzip file as it is read.
+class GzipInputStream : public std::istream {
+public:
+  GzipInputStream(std::string filename);
+
+private:
+  GzipStreamBuffer buffer;
+};
+
+/// An output stream that compresses what is written to it into a gzip file.
+class GzipOutputStream : public std::ostream {
+public:
+  GzipOutputStream(std::string filename);
+
+  /// Write the buffered data and close the file.  Errors are reported here,
+  /// whereas a stream that is destroyed without being closed ignores them.
+  void close();
+
+private:
+  GzipStreamBuffer buffer;
+};
+
+}}
+#endif
@@ -0,0 +1,51 @@
+#include "io/mapped_file.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "taco/error.h"
+
+namespace taco {
+namespace io {
+
+MappedFile::MappedFile(std::string filename, bool copyOnWrite)
+    : contents(nullptr), numBytes(0) {
+  int fd = open(filename.c_str(), O_RDONLY);
+  taco_uassert(fd != -1) << "Error opening file: " << filename;
+  struct stat fileStat;
+  if (fstat(fd, &fileStat) != 0) {
+    close(fd);
+    taco_uerror << "Error reading file: " << filename;
+  }
+  numBytes = fileStat.st_size;
+
+  // Empty files cannot be mapped
+  if (numBytes > 0) {
+    int protection = copyOnWrite ? (PROT_READ | PROT_WRITE) : PROT_READ;
+    void* mapping = mmap(nullptr, numBytes, protection, MAP_PRIVATE, fd, 0);
+    close(fd);
+    taco_uassert(mapping != MAP_FAILED) << "Error mapping file: " << filename;
+    contents = (char*)mapping;
+  }
+  else {
+    close(fd);
+  }
+}
+
+MappedFile::~MappedFile() {
+  if (contents != nullptr) {
+    munmap(contents, numBytes);
+  }
+}
+
+char* MappedFile::data() const {
+  return contents;
+}
+
+size_t MappedFile::size() const {
+  return numBytes;
+}
+
+}}
@@ -0,0 +1,33 @@
+#ifndef TACO_IO_MAPPED_FILE_H
+#define TACO_IO_MAPPED_FILE_H
+
+#include <cstddef>
+#include <string>
+
+namespace taco {
+namespace io {
+
+/// A file that is mapped into memory for as long as the object lives.
+class MappedFile {
+public:
+  /// Map the file.  A `copyOnWrite` mapping can also be written to, which
+  /// changes the mapped memory but not the file.
+  MappedFile(std::string filename, bool copyOnWrite=false);
+  ~MappedFile();
+
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  /// Returns the mapped file contents.
+  char* data() const;
+
+  /// Returns the size of the file in bytes.
+  size_t size() const;
+
+private:
+  char*  contents;
+  size_t numBytes;
+};
+
+}}
+#endif
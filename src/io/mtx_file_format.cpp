@@ -11,6 +11,9 @@
 #include "taco/error.h"
 #include "taco/util/strings.h"
 #include "taco/util/timers.h"
+#include "io/coordinate_parser.h"
+#include "io/coordinate_writer.h"
+#include "io/mapped_file.h"
 
 using namespace std;
 
@@ -18,22 +21,9 @@ namespace taco {
 namespace io {
 namespace mtx {
 
-TensorBase read(std::string filename, const Format& format, bool pack) {
-  std::ifstream file;
-  file.open(filename);
-  taco_uassert(file.is_open()) << "Error opening file: " << filename;
-  TensorBase tensor = read(file, format, pack);
-  file.close();
-  return tensor;
-}
-
-TensorBase read(std::istream& stream, const Format& format, bool pack) {
-  string line;
-  if (!std::getline(stream, line)) {
-    return TensorBase();
-  }
-
-  // Read Header
+/// Check the header line of a MatrixMarket file and return its format
+/// (coordinate or array).
+static string readHeader(const string& line) {
   std::stringstream lineStream(line);
   string head, type, formats, field, symmetry;
   lineStream >> head >> type >> formats >> field >> symmetry;
@@ -46,6 +36,75 @@ TensorBase read(std::istream& stream, const Format& format, bool pack) {
   taco_uassert(field=="real")          << "MatrixMarket field not available";
   // symmetry = [general symmetric skew-symmetric Hermitian]
   taco_uassert(symmetry=="general")    << "MatrixMarket symmetry not available";
+  return formats;
+}
+
+/// Parse the line with the dimension sizes (followed by the number of nonzeros
+/// in sparse files).
+static vector<int> readSizes(const string& line) {
+  vector<int> sizes;
+  char* linePtr = (char*)line.data();
+  while (int size = strtoul(linePtr, &linePtr, 10)) {
+    taco_uassert(size <= INT_MAX) << "Dimension size exceeds INT_MAX";
+    sizes.push_back(size);
+  }
+  return sizes;
+}
+
+/// Read a sparse file with readCoordinates.
+static TensorBase readSparse(const MappedFile& file, const Format& format,
+                             bool pack) {
+  const char* begin = file.data();
+  const char* end = begin + file.size();
+  getLine(&begin, end);
+
+  // Skip comments at the top of the file
+  string line;
+  size_t firstChar;
+  do {
+    line = getLine(&begin, end);
+    firstChar = line.find_first_not_of(" \t");
+  } while (begin < end && (firstChar == string::npos || line[firstChar]=='%'));
+
+  // The first non-comment line is the header with dimension sizes
+  vector<int> dimSizes = readSizes(line);
+  size_t nnz = dimSizes[dimSizes.size()-1];
+  dimSizes.pop_back();
+
+  // Only read the number of nonzeros given in the header
+  return readCoordinates(begin, end, dimSizes.size(), 1, '%', nnz, format,
+                         dimSizes, pack);
+}
+
+TensorBase read(std::string filename, const Format& format, bool pack) {
+  MappedFile file(filename);
+  const char* begin = file.data();
+  const char* end = begin + file.size();
+  if (begin == end) {
+    return TensorBase();
+  }
+
+  // Sparse files are parsed in parallel, dense files as a stream
+  TensorBase tensor;
+  if (readHeader(getLine(&begin, end)) == "coordinate") {
+    tensor = readSparse(file, format, pack);
+  }
+  else {
+    std::ifstream stream;
+    stream.open(filename);
+    taco_uassert(stream.is_open()) << "Error opening file: " << filename;
+    tensor = read(stream, format, pack);
+    stream.close();
+  }
+  return tensor;
+}
+
+TensorBase read(std::istream& stream, const Format& format, bool pack) {
+  string line;
+  if (!std::getline(stream, line)) {
+    return TensorBase();
+  }
+  string formats = readHeader(line);
 
   TensorBase tensor;
   if (formats=="coordinate")
@@ -77,25 +136,22 @@ TensorBase readSparse(std::istream& stream, const Format& format) {
   } while (std::getline(stream, line));
 
   // The first non-comment line is the header with dimension sizes
-  vector<int> dimSizes;
-  char* linePtr = (char*)line.data();
-  while (int dimSize = strtoul(linePtr, &linePtr, 10)) {
-    taco_uassert(dimSize <= INT_MAX) << "Dimension size exceeds INT_MAX";
-    dimSizes.push_back(dimSize);
-  }
+  vector<int> dimSizes = readSizes(line);
   size_t nnz = dimSizes[dimSizes.size()-1];
   dimSizes.pop_back();
 
-  vector<int> coordinates;
+  vector<vector<int>> coordinates(dimSizes.size());
   vector<double> values;
-  coordinates.reserve(nnz*dimSizes.size());
+  for (auto& dimCoordinates : coordinates) {
+    dimCoordinates.reserve(nnz);
+  }
   values.reserve(nnz);
 
-  while (std::getline(stream, line)) {
-    linePtr = (char*)line.data();
+  while (values.size() < nnz && std::getline(stream, line)) {
+    char* linePtr = (char*)line.data();
     for (size_t i=0; i < dimSizes.size(); i++) {
       long dimIdx = strtol(linePtr, &linePtr, 10);
-      coordinates.push_back(dimIdx);
+      coordinates[i].push_back(dimIdx - 1);
     }
     double val = strtod(linePtr, &linePtr);
     values.push_back(val);
@@ -103,17 +159,7 @@ TensorBase readSparse(std::istream& stream, const Format& format) {
 
   // Create matrix
   TensorBase tensor(ComponentType::Double, dimSizes, format);
-  tensor.reserve(nnz);
-
-  // Insert coordinates
-  std::vector<int> coord;
-  for (size_t i = 0; i < nnz; i++) {
-    coord.clear();
-    for (size_t dim = 0; dim < dimSizes.size(); dim++) {
-      coord.push_back(coordinates[i*dimSizes.size() + dim] -1);
-    }
-    tensor.insert(coord, values[i]);
-  }
+  tensor.insertBulk(coordinates, values);
 
   return tensor;
 }
@@ -133,12 +179,7 @@ TensorBase readDense(std::istream& stream, const Format& format) {
   } while (std::getline(stream, line));
 
   // The first non-comment line is the header with dimension sizes
-  vector<int> dimSizes;
-  char* linePtr = (char*)line.data();
-  while (int dimSize = strtoul(linePtr, &linePtr, 10)) {
-    taco_uassert(dimSize <= INT_MAX) << "Dimension size exceeds INT_MAX";
-    dimSizes.push_back(dimSize);
-  }
+  vector<int> dimSizes = readSizes(line);
 
   vector<double> values;
   auto size = std::accumulate(begin(dimSizes), end(dimSizes),
@@ -146,28 +187,29 @@ TensorBase readDense(std::istream& stream, const Format& format) {
   values.reserve(size);
 
   while (std::getline(stream, line)) {
-    linePtr = (char*)line.data();
+    char* linePtr = (char*)line.data();
     double val = strtod(linePtr, &linePtr);
     values.push_back(val);
   }
 
-  // Create matrix
-  TensorBase tensor(ComponentType::Double, dimSizes, format);
-  tensor.reserve(size);
-
-  // Insert coordinates
-  std::vector<int> coord;
-  for (auto n = 0; n<size; n++) {
-    coord.clear();
+  // Compute the column-major coordinates of the values
+  vector<vector<int>> coordinates(dimSizes.size());
+  for (auto& dimCoordinates : coordinates) {
+    dimCoordinates.resize(values.size());
+  }
+  for (size_t n = 0; n < values.size(); n++) {
     auto indice=n;
     for (size_t dim = 0; dim < dimSizes.size()-1; dim++) {
-      coord.push_back(indice%dimSizes[dim]);
+      coordinates[dim][n] = indice%dimSizes[dim];
       indice=indice/dimSizes[dim];
     }
-    coord.push_back(indice);
-    tensor.insert(coord, values[n]);
+    coordinates[dimSizes.size()-1][n] = indice;
   }
 
+  // Create matrix
+  TensorBase tensor(ComponentType::Double, dimSizes, format);
+  tensor.insertBulk(coordinates, values);
+
   return tensor;
 }
 
@@ -193,13 +235,8 @@ void writeSparse(std::ostream& stream, const TensorBase& tensor) {
     stream << "%%MatrixMarket tensor coordinate real general" << std::endl;
   stream << "%"                                             << std::endl;
   stream << util::join(tensor.getDimensions(), " ") << " ";
-  stream << tensor.getStorage().getSize().numValues() << endl;
-  for (auto& value : iterate<double>(tensor)) {
-    for (int coord : value.first) {
-      stream << coord+1 << " ";
-    }
-    stream << value.second << endl;
-  }
+  stream << tensor.getStorage().getSize().numValues() << "\n";
+  writeCoordinates(stream, tensor, 1);
 }
 
 void writeDense(std::ostream& stream, const TensorBase& tensor) {
@@ -208,9 +245,7 @@ void writeDense(std::ostream& stream, const TensorBase& tensor) {
   else
     stream << "%%MatrixMarket tensor array real general" << std::endl;
   stream << "%"                                        << std::endl;
-  stream << util::join(tensor.getDimensions(), " ") << " " << endl;
-  for (auto& value : iterate<double>(tensor)) {
-    stream << value.second << endl;
-  }
+  stream << util::join(tensor.getDimensions(), " ") << " " << "\n";
+  writeCoordinates(stream, tensor, 1, false);
 }
 }}}
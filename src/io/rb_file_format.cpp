@@ -316,6 +316,9 @@ void write(std::ostream& stream, const TensorBase& tensor) {
     taco_uassert(tensor.getFormat() == CSC) <<
         "writeRB: the tensor " << tensor.getName() <<
         " is not defined in the CSC format";
+    taco_uassert(tensor.getComponentType() == ComponentType::Double) <<
+        "writeRB: the tensor " << tensor.getName() <<
+        " does not have double components";
 
     auto S = tensor.getStorage();
     auto size = S.getSize();
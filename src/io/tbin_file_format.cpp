@@ -0,0 +1,371 @@
+#include "taco/io/tbin_file_format.h"
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "taco/tensor.h"
+#include "taco/format.h"
+#include "taco/error.h"
+#include "taco/storage/storage.h"
+#include "io/mapped_file.h"
+
+/*
+
+  A tbin file is a binary dump of packed tensor storage, laid out so that it
+  can be memory mapped:
+
+    header     magic "TACOTBIN", version, byte order mark, component type,
+               order and position type (uint32)
+    dims       the size of each tensor dimension (int32)
+    format     the type, dimension and index type of each format level
+               (int32)
+    arrays     the offset and number of elements of every index array of the
+               sparse and fixed levels, followed by the values (uint64)
+
+  followed by the arrays themselves, each starting at an offset that is a
+  multiple of 64 bytes.  Dense levels store no arrays.  The pos arrays of
+  sparse levels hold elements of the position type (int32 or int64), the idx
+  arrays hold elements of the index type of their level (int32, uint8 or
+  uint16), the size of a fixed level is an int32, and the values hold
+  elements of the component type.  All numbers are in the byte order of the
+  machine that wrote the file.
+
+ */
+
+using namespace std;
+using namespace taco::storage;
+
+namespace taco {
+namespace io {
+namespace tbin {
+
+static const char     magic[8]      = {'T','A','C','O','T','B','I','N'};
+static const uint32_t version       = 1;
+static const uint32_t byteOrderMark = 0x01020304;
+static const uint64_t alignment     = 64;
+
+namespace {
+/// The location of an index or value array in a tbin file.
+struct ArrayInfo {
+  uint64_t offset;
+  uint64_t size;    // number of elements
+};
+
+/// Everything in a tbin file except the arrays.
+struct Layout {
+  uint64_t          headerSize;
+  ComponentType     ctype;
+  vector<int>       dimensions;
+  Format            format;
+  vector<ArrayInfo> arrays;
+};
+}
+
+template <typename T>
+static void writeValue(ostream& stream, T value) {
+  stream.write((const char*)&value, sizeof(T));
+}
+
+template <typename T>
+static T readValue(istream& stream) {
+  T value;
+  stream.read((char*)&value, sizeof(T));
+  taco_uassert(stream.good()) << "Unexpected end of tbin file";
+  return value;
+}
+
+static uint64_t align(uint64_t offset) {
+  return (offset + alignment - 1) / alignment * alignment;
+}
+
+static size_t getNumArrays(const Format& format) {
+  size_t numArrays = 1;  // values
+  for (auto& level : format.getLevels()) {
+    if (level.getType() != DimensionType::Dense) {
+      numArrays += 2;
+    }
+  }
+  return numArrays;
+}
+
+static uint64_t getHeaderSize(const Format& format) {
+  return sizeof(magic) + 5*sizeof(uint32_t) +
+         4*format.getOrder()*sizeof(int32_t) +
+         getNumArrays(format)*2*sizeof(uint64_t);
+}
+
+static Layout readLayout(istream& stream) {
+  char fileMagic[sizeof(magic)];
+  stream.read(fileMagic, sizeof(magic));
+  taco_uassert(stream.good() && memcmp(fileMagic, magic, sizeof(magic)) == 0)
+      << "Not a tbin file";
+  uint32_t fileVersion = readValue<uint32_t>(stream);
+  taco_uassert(fileVersion == version) <<
+      "Unsupported tbin version " << fileVersion << " (expected " << version <<
+      ")";
+  taco_uassert(readValue<uint32_t>(stream) == byteOrderMark) <<
+      "The tbin file was written on a machine with a different byte order";
+  uint32_t componentType = readValue<uint32_t>(stream);
+  taco_uassert(componentType <= ComponentType::Double) <<
+      "Unknown component type " << componentType << " in tbin file";
+  uint32_t order = readValue<uint32_t>(stream);
+  uint32_t positionType = readValue<uint32_t>(stream);
+  taco_uassert(positionType == (uint32_t)IndexArrayType::Int32 ||
+               positionType == (uint32_t)IndexArrayType::Int64) <<
+      "Unknown position type " << positionType << " in tbin file";
+
+  Layout layout;
+  layout.ctype = (ComponentType::Kind)componentType;
+  for (size_t i = 0; i < order; i++) {
+    layout.dimensions.push_back(readValue<int32_t>(stream));
+  }
+  vector<DimensionType> levelTypes;
+  vector<int> levelDimensions;
+  for (size_t i = 0; i < order; i++) {
+    int32_t levelType = readValue<int32_t>(stream);
+    taco_uassert(levelType >= Dense && levelType <= Fixed) <<
+        "Unknown level type " << levelType << " in tbin file";
+    levelTypes.push_back((DimensionType)levelType);
+  }
+  for (size_t i = 0; i < order; i++) {
+    int32_t levelDimension = readValue<int32_t>(stream);
+    taco_uassert(levelDimension >= 0 && levelDimension < (int)order) <<
+        "Level dimension " << levelDimension << " out of range in tbin file";
+    levelDimensions.push_back(levelDimension);
+  }
+  vector<IndexArrayType> indexTypes;
+  for (size_t i = 0; i < order; i++) {
+    int32_t indexType = readValue<int32_t>(stream);
+    taco_uassert(indexType == (int32_t)IndexArrayType::Int32 ||
+                 indexType == (int32_t)IndexArrayType::UInt8 ||
+                 indexType == (int32_t)IndexArrayType::UInt16) <<
+        "Unknown index type " << indexType << " in tbin file";
+    indexTypes.push_back((IndexArrayType)indexType);
+  }
+  if (order > 0) {
+    layout.format = Format(levelTypes, levelDimensions,
+                           (IndexArrayType)positionType, indexTypes);
+  }
+  for (size_t i = 0; i < getNumArrays(layout.format); i++) {
+    ArrayInfo array;
+    array.offset = readValue<uint64_t>(stream);
+    array.size   = readValue<uint64_t>(stream);
+    layout.arrays.push_back(array);
+  }
+  layout.headerSize = getHeaderSize(layout.format);
+  return layout;
+}
+
+/// Create a tensor with the layout's storage, getting the arrays from
+/// `getArray` and releasing them with `deleter`.
+static TensorBase
+createTensor(const Layout& layout, const function<void*(size_t)>& getArray,
+             Storage::Deleter deleter) {
+  TensorBase tensor(layout.ctype, layout.dimensions, layout.format);
+  vector<vector<int*>> indices;
+  size_t array = 0;
+  for (auto& level : layout.format.getLevels()) {
+    indices.push_back({});
+    if (level.getType() != DimensionType::Dense) {
+      indices.back().push_back((int*)getArray(array++));
+      indices.back().push_back((int*)getArray(array++));
+    }
+  }
+  tensor.adoptStorage(indices, (double*)getArray(array), deleter);
+  return tensor;
+}
+
+/// Append the components of `tensor`, whose components have type T, to the
+/// coordinates and values.
+template <typename T>
+static void getComponents(const TensorBase& tensor,
+                          vector<vector<int>>* coordinates,
+                          vector<double>* values) {
+  for (auto& value : iterate<T>(tensor)) {
+    for (size_t i = 0; i < coordinates->size(); i++) {
+      (*coordinates)[i].push_back(value.first[i]);
+    }
+    values->push_back(value.second);
+  }
+}
+
+/// Returns `tensor`, repacked if `format` differs from its format.
+static TensorBase convert(TensorBase tensor, const Format& format, bool pack) {
+  TensorBase result(tensor.getComponentType(), tensor.getDimensions(), format);
+  if (result.getFormat() == tensor.getFormat()) {
+    return tensor;
+  }
+  // Bool, int and float components convert to double and back exactly
+  vector<vector<int>> coordinates(tensor.getOrder());
+  vector<double> values;
+  switch (tensor.getComponentType().getKind()) {
+    case ComponentType::Bool:
+      getComponents<bool>(tensor, &coordinates, &values);
+      break;
+    case ComponentType::Int:
+      getComponents<int>(tensor, &coordinates, &values);
+      break;
+    case ComponentType::Float:
+      getComponents<float>(tensor, &coordinates, &values);
+      break;
+    case ComponentType::Double:
+    case ComponentType::Unknown:
+      getComponents<double>(tensor, &coordinates, &values);
+      break;
+  }
+  result.insertBulk(coordinates, values);
+  if (pack) {
+    result.pack();
+  }
+  return result;
+}
+
+/// Returns the size of the elements of each array in a tbin file of the format
+/// and component type: the pos and idx arrays of the sparse and fixed levels,
+/// and the values.
+static vector<size_t> getElementSizes(const Format& format,
+                                      ComponentType ctype) {
+  vector<size_t> elementSizes;
+  for (auto& level : format.getLevels()) {
+    if (level.getType() == DimensionType::Sparse) {
+      elementSizes.push_back(getIndexArrayTypeSize(format.getPositionType()));
+      elementSizes.push_back(getIndexArrayTypeSize(level.getIndexType()));
+    }
+    else if (level.getType() == DimensionType::Fixed) {
+      elementSizes.push_back(sizeof(int));
+      elementSizes.push_back(getIndexArrayTypeSize(level.getIndexType()));
+    }
+  }
+  elementSizes.push_back(ctype.bytes());
+  return elementSizes;
+}
+
+TensorBase read(std::string filename, const Format& format, bool pack) {
+  std::ifstream file;
+  file.open(filename, std::ios::binary);
+  taco_uassert(file.is_open()) << "Error opening file: " << filename;
+  Layout layout = readLayout(file);
+  file.close();
+
+  // Map the file copy-on-write, so that computing on the tensor (e.g. zeroing
+  // it) does not change the file.  The mapping is unmapped once the tensor has
+  // released every array in it.
+  shared_ptr<MappedFile> mapping = make_shared<MappedFile>(filename, true);
+  const vector<size_t> elementSizes = getElementSizes(layout.format,
+                                                      layout.ctype);
+  for (size_t i = 0; i < layout.arrays.size(); i++) {
+    auto& array = layout.arrays[i];
+    size_t size = array.size * elementSizes[i];
+    taco_uassert(array.offset + size <= mapping->size()) <<
+        "Truncated tbin file: " << filename;
+  }
+
+  TensorBase tensor = createTensor(layout, [&](size_t array) {
+    return (void*)(mapping->data() + layout.arrays[array].offset);
+  }, [mapping](void*) {});
+  return convert(tensor, format, pack);
+}
+
+TensorBase read(std::istream& stream, const Format& format, bool pack) {
+  Layout layout = readLayout(stream);
+  uint64_t position = layout.headerSize;
+  const vector<size_t> elementSizes = getElementSizes(layout.format,
+                                                      layout.ctype);
+
+  vector<void*> arrays;
+  for (size_t i = 0; i < layout.arrays.size(); i++) {
+    auto& array = layout.arrays[i];
+    taco_uassert(array.offset >= position) << "Corrupt tbin file";
+    stream.ignore(array.offset - position);
+    size_t size = array.size * elementSizes[i];
+    arrays.push_back(malloc(size));
+    stream.read((char*)arrays.back(), size);
+    taco_uassert(stream.good()) << "Unexpected end of tbin file";
+    position = array.offset + size;
+  }
+
+  TensorBase tensor = createTensor(layout, [&](size_t array) {
+    return arrays[array];
+  }, nullptr);
+  return convert(tensor, format, pack);
+}
+
+void write(std::string filename, const TensorBase& tensor) {
+  std::ofstream file;
+  file.open(filename, std::ios::binary);
+  taco_uassert(file.is_open()) << "Error opening file: " << filename;
+  write(file, tensor);
+  file.close();
+}
+
+void write(std::ostream& stream, const TensorBase& tensor) {
+  Storage storage = tensor.getStorage();
+  taco_uassert(storage.getValues() != nullptr) <<
+      "Only packed tensors can be written to tbin files";
+  Format format = storage.getFormat();
+  auto size = storage.getSize();
+
+  // Lay out the arrays after the header
+  vector<const void*> arrays;
+  vector<ArrayInfo> arrayInfos;
+  for (size_t i = 0; i < format.getOrder(); i++) {
+    if (format.getLevels()[i].getType() != DimensionType::Dense) {
+      auto& index = storage.getDimensionIndex(i);
+      arrays.push_back(index[0]);
+      arrayInfos.push_back({0, size.numIndexValues(i,0)});
+      arrays.push_back(index[1]);
+      arrayInfos.push_back({0, size.numIndexValues(i,1)});
+    }
+  }
+  arrays.push_back(storage.getValues());
+  arrayInfos.push_back({0, size.numValues()});
+  const ComponentType ctype = storage.getComponentType();
+  const vector<size_t> elementSizes = getElementSizes(format, ctype);
+  uint64_t offset = align(getHeaderSize(format));
+  for (size_t i = 0; i < arrayInfos.size(); i++) {
+    arrayInfos[i].offset = offset;
+    offset += arrayInfos[i].size * elementSizes[i];
+    offset = align(offset);
+  }
+
+  // Header
+  stream.write(magic, sizeof(magic));
+  writeValue<uint32_t>(stream, version);
+  writeValue<uint32_t>(stream, byteOrderMark);
+  writeValue<uint32_t>(stream, ctype.getKind());
+  writeValue<uint32_t>(stream, format.getOrder());
+  writeValue<uint32_t>(stream, (uint32_t)format.getPositionType());
+  for (int dimension : tensor.getDimensions()) {
+    writeValue<int32_t>(stream, dimension);
+  }
+  for (auto& level : format.getLevels()) {
+    writeValue<int32_t>(stream, level.getType());
+  }
+  for (auto& level : format.getLevels()) {
+    writeValue<int32_t>(stream, level.getDimension());
+  }
+  for (auto& level : format.getLevels()) {
+    writeValue<int32_t>(stream, (int32_t)level.getIndexType());
+  }
+  for (auto& arrayInfo : arrayInfos) {
+    writeValue<uint64_t>(stream, arrayInfo.offset);
+    writeValue<uint64_t>(stream, arrayInfo.size);
+  }
+
+  // Arrays
+  uint64_t position = getHeaderSize(format);
+  const vector<char> padding(alignment, 0);
+  for (size_t i = 0; i < arrays.size(); i++) {
+    stream.write(padding.data(), arrayInfos[i].offset - position);
+    size_t bytes = arrayInfos[i].size * elementSizes[i];
+    stream.write((const char*)arrays[i], bytes);
+    position = arrayInfos[i].offset + bytes;
+  }
+  taco_uassert(stream.good()) << "Error writing tbin file";
+}
+
+}}}
@@ -7,11 +7,15 @@
 #include <vector>
 #include <cmath>
 #include <limits.h>
+#include <stdint.h>
 
 #include "taco/tensor.h"
 #include "taco/format.h"
 #include "taco/error.h"
 #include "taco/util/strings.h"
+#include "io/coordinate_parser.h"
+#include "io/coordinate_writer.h"
+#include "io/mapped_file.h"
 
 using namespace std;
 
@@ -20,16 +24,23 @@ namespace io {
 namespace tns {
 
 TensorBase read(std::string filename, const Format& format, bool pack) {
-  std::ifstream file;
-  file.open(filename);
-  taco_uassert(file.is_open()) << "Error opening file: " << filename;
-  TensorBase tensor = read(file, format, pack);
-  file.close();
-  return tensor;
+  MappedFile file(filename);
+  const char* begin = file.data();
+  const char* end = begin + file.size();
+
+  // Infer tensor order from the first coordinate
+  size_t numTokens = countTokens(begin, end, '#');
+  if (numTokens == 0) {
+    return TensorBase();
+  }
+  size_t order = numTokens - 1;
+
+  // The dimensions are inferred from the largest coordinates
+  return readCoordinates(begin, end, order, 1, '#', SIZE_MAX, format, {},
+                         pack);
 }
 
 TensorBase read(std::istream& stream, const Format& format, bool pack) {
-  std::vector<int>    coordinates;
   std::vector<double> values;
 
   std::string line;
@@ -41,7 +52,7 @@ TensorBase read(std::istream& stream, const Format& format, bool pack) {
   vector<string> toks = util::split(line, " ");
   size_t order = toks.size()-1;
   std::vector<int> dimensions(order);
-  std::vector<int> coordinate(order);
+  std::vector<std::vector<int>> coordinates(order);
 
   // Load data
   do {
@@ -49,27 +60,17 @@ TensorBase read(std::istream& stream, const Format& format, bool pack) {
     for (size_t i = 0; i < order; i++) {
       long idx = strtol(linePtr, &linePtr, 10);
       taco_uassert(idx <= INT_MAX)<<"Coordinate in file is larger than INT_MAX";
-      coordinate[i] = (int)idx - 1;
+      coordinates[i].push_back((int)idx - 1);
       dimensions[i] = std::max(dimensions[i], (int)idx);
     }
-    coordinates.insert(coordinates.end(), coordinate.begin(), coordinate.end());
     double val = strtod(linePtr, &linePtr);
     values.push_back(val);
 
   } while (std::getline(stream, line));
 
   // Create tensor
-  const size_t nnz = values.size();
   TensorBase tensor(ComponentType::Double, dimensions, format);
-  tensor.reserve(nnz);
-
-  // Insert coordinates (TODO add and use bulk insertion)
-  for (size_t i = 0; i < nnz; i++) {
-    for (size_t j = 0; j < order; j++) {
-      coordinate[j] = coordinates[i*order + j];
-    }
-    tensor.insert(coordinate, values[i]);
-  }
+  tensor.insertBulk(coordinates, values);
 
   if (pack) {
     tensor.pack();
@@ -87,12 +88,7 @@ void write(std::string filename, const TensorBase& tensor) {
 }
 
 void write(std::ostream& stream, const TensorBase& tensor) {
-  for (auto& value : iterate<double>(tensor)) {
-    for (int coord : value.first) {
-      stream << coord+1 << " ";
-    }
-    stream << value.second << endl;
-  }
+  writeCoordinates(stream, tensor, 1);
 }
 
 }}}
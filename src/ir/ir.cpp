@@ -2,6 +2,8 @@
 #include "ir_visitor.h"
 #include "ir_printer.h"
 
+#include <algorithm>
+
 #include "taco/error.h"
 
 namespace taco {
@@ -23,7 +25,7 @@ std::ostream& operator<<(std::ostream& os, const Type& type) {
       }
       break;
     case Type::Int:
-      os << "int";
+      os << ((type.bits == 64) ? "int64_t" : "int");
       break;
     case Type::Float:
       if (type.bits == 32) {
@@ -50,7 +52,7 @@ Expr Literal::make(double val, Type type) {
 
 Expr Literal::make(int val) {
   Literal *lit = new Literal;
-  lit->type = Type(Type::Int, sizeof(int));
+  lit->type = Type(Type::Int);
   lit->value = (int64_t)val;
   return lit;
 }
@@ -99,6 +101,8 @@ Type max_type(Expr a, Expr b) {
 
   if (a.type() == b.type()) {
     return a.type();
+  } else if (a.type().isInt() && b.type().isInt()) {
+    return Type(Type::Int, std::max(a.type().bits, b.type().bits));
   } else {
     if ((a.type().kind == Type::Float && a.type().bits == 64) ||
         (b.type().kind == Type::Float && b.type().bits == 64)) {
@@ -219,7 +223,7 @@ Expr Max::make(Expr a, Expr b, Type type) {
 
 Expr BitAnd::make(Expr a, Expr b) {
   BitAnd *bitAnd = new BitAnd;
-  bitAnd->type = Type(Type::UInt);
+  bitAnd->type = Type(Type::UInt, std::max(a.type().bits, b.type().bits));
   bitAnd->a = a;
   bitAnd->b = b;
   return bitAnd;
@@ -298,7 +302,10 @@ Expr Load::make(Expr arr) {
 Expr Load::make(Expr arr, Expr loc) {
   taco_iassert(loc.type().isInt()) << "Can't load from a non-integer offset";
   Load *load = new Load;
-  load->type = arr.type();
+  // Narrow unsigned index values and bool components are loaded as int, like
+  // C promotes them
+  load->type = (arr.type().isUInt() && arr.type().bits < 32)
+               ? Type(Type::Int) : arr.type();
   load->arr = arr;
   load->loc = loc;
   return load;
@@ -368,7 +375,8 @@ Stmt Case::make(std::vector<std::pair<Expr,Stmt>> clauses, bool alwaysMatch) {
 
 // For loop
 Stmt For::make(Expr var, Expr start, Expr end, Expr increment, Stmt contents,
-  LoopKind kind, int vec_width) {
+  LoopKind kind, int vec_width,
+  std::vector<std::pair<Expr,Expr>> reductions) {
   For *loop = new For;
   loop->var = var;
   loop->start = start;
@@ -377,6 +385,7 @@ Stmt For::make(Expr var, Expr start, Expr end, Expr increment, Stmt contents,
   loop->contents = Scope::make(contents);
   loop->kind = kind;
   loop->vec_width = vec_width;
+  loop->reductions = reductions;
   return loop;
 }
 
@@ -427,6 +436,15 @@ Stmt Allocate::make(Expr var, Expr num_elements, bool is_realloc) {
   return alloc;
 }
 
+// Free
+Stmt Free::make(Expr var) {
+  taco_iassert(var.as<Var>() && var.as<Var>()->is_ptr) <<
+      "Can only free the memory of a pointer-typed Var";
+  Free* free = new Free;
+  free->var = var;
+  return free;
+}
+
 // Comment
 Stmt Comment::make(std::string text) {
   Comment* comment = new Comment;
@@ -455,14 +473,45 @@ Expr GetProperty::make(Expr tensor, TensorProperty property, size_t dim) {
   gp->dim = dim;
   
   //TODO: deal with the fact that these are pointers.
-  if (property == TensorProperty::Values)
+  if (property == TensorProperty::Values) {
     gp->type = tensor.type();
-  else
+  }
+  else if (property == TensorProperty::Pointer &&
+           tensor.as<Var>()->format.getLevels()[dim].getType() == Sparse) {
+    gp->type = getPositionType(tensor);
+  }
+  else if (property == TensorProperty::Index) {
+    gp->type = getIndexType(tensor, dim);
+  }
+  else {
     gp->type = Type::Int;
+  }
   
   return gp;
 }
 
+Type getPositionType(Expr tensor) {
+  const Var* var = tensor.as<Var>();
+  taco_iassert(var != nullptr && var->is_tensor) << "Not a tensor: " << tensor;
+  return (var->format.getPositionType() == IndexArrayType::Int64)
+         ? Type(Type::Int, 64) : Type(Type::Int);
+}
+
+Type getIndexType(Expr tensor, size_t level) {
+  const Var* var = tensor.as<Var>();
+  taco_iassert(var != nullptr && var->is_tensor) << "Not a tensor: " << tensor;
+  switch (var->format.getLevels()[level].getIndexType()) {
+    case IndexArrayType::UInt8:
+      return Type(Type::UInt, 8);
+    case IndexArrayType::UInt16:
+      return Type(Type::UInt, 16);
+    case IndexArrayType::Int32:
+    case IndexArrayType::Int64:
+      break;
+  }
+  return Type(Type::Int);
+}
+
 // visitor methods
 template<> void ExprNode<Literal>::accept(IRVisitorStrict *v)
     const { v->visit((const Literal*)this); }
@@ -526,6 +575,8 @@ template<> void StmtNode<VarAssign>::accept(IRVisitorStrict *v)
     const { v->visit((const VarAssign*)this); }
 template<> void StmtNode<Allocate>::accept(IRVisitorStrict *v)
     const { v->visit((const Allocate*)this); }
+template<> void StmtNode<Free>::accept(IRVisitorStrict *v)
+    const { v->visit((const Free*)this); }
 template<> void StmtNode<Comment>::accept(IRVisitorStrict *v)
     const { v->visit((const Comment*)this); }
 template<> void StmtNode<BlankLine>::accept(IRVisitorStrict *v)
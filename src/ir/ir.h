@@ -1,6 +1,7 @@
 #ifndef TACO_IR_H
 #define TACO_IR_H
 
+#include <atomic>
 #include <vector>
 #include "taco/format.h"
 
@@ -47,6 +48,7 @@ enum class IRNodeType {
   Function,
   VarAssign,
   Allocate,
+  Free,
   Comment,
   BlankLine,
   Print,
@@ -71,7 +73,7 @@ public:
   bool isInt() const {return kind == Int;}
   bool isFloat() const {return kind == Float;}
 
-  Type(Kind kind, int bits=sizeof(int)) : kind(kind), bits(bits) {}
+  Type(Kind kind, int bits=32) : kind(kind), bits(bits) {}
 };
 
 bool operator==(const Type&, const Type&);
@@ -88,7 +90,7 @@ struct IRNode : private util::Uncopyable {
    */
   virtual IRNodeType type_info() const = 0;
 
-  mutable long ref = 0;
+  mutable std::atomic<long> ref{0};
   friend void acquire(const IRNode* node) {
     ++(node->ref);
   }
@@ -494,6 +496,11 @@ enum class LoopKind {Serial, Parallel, Vectorized};
  * If the loop is vectorized, the width says which vector width
  * to use.  By default (0), it will not set a specific width and
  * let clang determine the width to use.
+ *
+ * The iterations of a parallel loop may add into the reductions, which
+ * are scalar variables (with an undefined size) or arrays with the given
+ * number of elements.  Each thread adds into a private copy, and the
+ * copies are added into the reductions after the loop.
  */
 struct For : public StmtNode<For> {
 public:
@@ -504,10 +511,12 @@ public:
   Stmt contents;
   LoopKind kind;
   int vec_width;  // vectorization width
+  std::vector<std::pair<Expr,Expr>> reductions;  // (variable or array, size)
   
   static Stmt make(Expr var, Expr start, Expr end, Expr increment,
                    Stmt contents, LoopKind kind=LoopKind::Serial,
-                   int vec_width=0);
+                   int vec_width=0,
+                   std::vector<std::pair<Expr,Expr>> reductions={});
   
   static const IRNodeType _type_info = IRNodeType::For;
 };
@@ -565,6 +574,16 @@ public:
   static const IRNodeType _type_info = IRNodeType::Allocate;
 };
 
+/** A Free node that frees the memory allocated for a Var */
+struct Free : public StmtNode<Free> {
+public:
+  Expr var;   // must be a Var
+  
+  static Stmt make(Expr var);
+  
+  static const IRNodeType _type_info = IRNodeType::Free;
+};
+
 /** A comment */
 struct Comment : public StmtNode<Comment> {
 public:
@@ -611,6 +630,16 @@ public:
   static const IRNodeType _type_info = IRNodeType::GetProperty;
 };
 
+/// Returns the type of the positions of a tensor variable: the elements of the
+/// pos arrays of its sparse levels, and the position variables that index its
+/// levels and values.
+Type getPositionType(Expr tensor);
+
+/// Returns the type of the elements of the idx array of a level of a tensor
+/// variable: 8- or 16-bit unsigned integers for levels with narrow index types
+/// and int otherwise.
+Type getIndexType(Expr tensor, size_t level);
+
 template <typename E>
 inline bool isa(Expr e) {
   return e.defined() && dynamic_cast<const E*>(e.ptr) != nullptr;
@@ -257,7 +257,8 @@ void IRPrinter::visit(const Store* op) {
 
 void IRPrinter::visit(const For* op) {
   doIndent();
-  stream << keywordString("for") << " (int ";
+  stream << keywordString("for") << " ("
+         << keywordString(util::toString(op->var.type())) << " ";
   op->var.accept(this);
   stream << " = ";
   op->start.accept(this);
@@ -364,6 +365,13 @@ void IRPrinter::visit(const Allocate* op) {
   stream << "]";
 }
 
+void IRPrinter::visit(const Free* op) {
+  doIndent();
+  stream << "free(";
+  op->var.accept(this);
+  stream << ");";
+}
+
 void IRPrinter::visit(const Comment* op) {
   doIndent();
   stream << commentString(op->text);
@@ -47,6 +47,7 @@ protected:
   virtual void visit(const Function*);
   virtual void visit(const VarAssign*);
   virtual void visit(const Allocate*);
+  virtual void visit(const Free*);
   virtual void visit(const Comment*);
   virtual void visit(const BlankLine*);
   virtual void visit(const Print*);
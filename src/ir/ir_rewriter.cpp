@@ -223,7 +223,7 @@ void IRRewriter::visit(const For* op) {
   }
   else {
     stmt = For::make(var, start, end, increment, contents, op->kind,
-                     op->vec_width);
+                     op->vec_width, op->reductions);
   }
 }
 
@@ -319,6 +319,16 @@ void IRRewriter::visit(const Allocate* op) {
   }
 }
 
+void IRRewriter::visit(const Free* op) {
+  Expr var = rewrite(op->var);
+  if (var == op->var) {
+    stmt = op;
+  }
+  else {
+    stmt = Free::make(var);
+  }
+}
+
 void IRRewriter::visit(const Comment* op) {
   stmt = op;
 }
@@ -172,6 +172,10 @@ void IRVisitor::visit(const Allocate* op) {
   op->num_elements.accept(this);
 }
 
+void IRVisitor::visit(const Free* op) {
+  op->var.accept(this);
+}
+
 void IRVisitor::visit(const GetProperty* op) {
   op->tensor.accept(this);
 }
@@ -34,6 +34,7 @@ struct Scope;
 struct Function;
 struct VarAssign;
 struct Allocate;
+struct Free;
 struct Comment;
 struct BlankLine;
 struct Print;
@@ -74,6 +75,7 @@ public:
   virtual void visit(const Function*) = 0;
   virtual void visit(const VarAssign*) = 0;
   virtual void visit(const Allocate*) = 0;
+  virtual void visit(const Free*) = 0;
   virtual void visit(const Comment*) = 0;
   virtual void visit(const BlankLine*) = 0;
   virtual void visit(const Print*) = 0;
@@ -117,6 +119,7 @@ public:
   virtual void visit(const Function* op);
   virtual void visit(const VarAssign* op);
   virtual void visit(const Allocate* op);
+  virtual void visit(const Free* op);
   virtual void visit(const Comment* op);
   virtual void visit(const BlankLine* op);
   virtual void visit(const Print* op);
@@ -37,6 +37,30 @@ using taco::ir::Var;
 using taco::ir::Add;
 using taco::storage::Iterator;
 
+/// The number of nonzeros in each partition of a kernel scheduled by nonzeros
+static const int NONZEROS_PER_PARTITION = 2048;
+
+/// A partition of the nonzeros of a CSR-like operand, which the root loop of a
+/// kernel scheduled by nonzeros is split into (see getNonzeroIterator).  The
+/// partition computes the rows it shares with its neighbours into carries,
+/// which are added into the result after the loop.
+struct NonzeroPartition {
+  /// The iterator over the sparse level whose positions are partitioned
+  Iterator iterator;
+
+  /// The index of the partition and the positions it begins and ends at
+  Expr     partition;
+  Expr     begin;
+  Expr     end;
+
+  /// The first and last rows of the partition
+  Expr     firstRow;
+  Expr     lastRow;
+
+  /// The sums of the first and last rows of every partition
+  Expr     carries;
+};
+
 struct Context {
   /// Determines what kind of code to emit (e.g. compute and/or assembly)
   set<Property>        properties;
@@ -50,6 +74,30 @@ struct Context {
   /// The size of initial memory allocations
   size_t               allocSize;
 
+  /// The type of the temporaries that reductions are accumulated in
+  Type                 accumulatorType = Type(Type::Float, 64);
+
+  /// The number of accumulator components in a vector of the target, or 0 if
+  /// the compiler chooses the width of vectorized loops
+  int                  vectorWidth = 0;
+
+  /// True if the segments of the sparse last level of the result are
+  /// assembled and computed in parallel (see isSegmentParallel)
+  bool                 segmentParallel = false;
+
+  /// True while emitting the assembly pass that only counts the size of each
+  /// segment of the sparse last level of the result
+  bool                 countSegments = false;
+
+  /// True if the root loop iterates over a reduction variable in parallel,
+  /// with each thread adding into a private copy of the result (see
+  /// isReductionParallel)
+  bool                 reductionParallel = false;
+
+  /// The partition of the nonzeros that the root loop iterates over, if the
+  /// kernel is scheduled by nonzeros
+  NonzeroPartition     nonzeros;
+
   /// Maps tensor (scalar) temporaries to IR variables.
   /// (Not clear if this approach to temporaries is too hacky.)
   map<TensorBase,Expr> temporaries;
@@ -110,6 +158,20 @@ static bool needsMerge(MergeLattice lattice) {
   return false;
 }
 
+/// Returns the number of positions of the first `numLevels` levels of the
+/// result, which must be dense.
+static Expr getNumPositions(const Context& ctx, size_t numLevels) {
+  TensorPath resultPath = ctx.schedule.getResultTensorPath();
+  Expr numPositions = 1;
+  for (size_t i = 0; i < numLevels; i++) {
+    Iterator iterator = ctx.iterators[resultPath.getStep(i)];
+    taco_iassert(iterator.isDense());
+    numPositions = (i == 0) ? iterator.end()
+                            : Mul::make(numPositions, iterator.end());
+  }
+  return numPositions;
+}
+
 static Iterator getIterator(std::vector<storage::Iterator>& iterators) {
   taco_iassert(!iterators.empty());
 
@@ -188,6 +250,14 @@ static taco::Expr getSubExpr(taco::Expr expr, const vector<taco::Var>& vars) {
   return SubExprVisitor(vars).getSubExpression(expr);
 }
 
+/// Returns the type that the components written to the target are computed in.
+/// Booleans are computed as ints and converted when they are stored, like C
+/// promotes them.
+static Type getComputeType(const Target& target) {
+  Type type = target.tensor.type();
+  return type.isBool() ? Type(Type::Int) : type;
+}
+
 static vector<Stmt> lower(const Target&     target,
                           const taco::Expr& indexExpr,
                           const taco::Var&  indexVar,
@@ -205,10 +275,19 @@ static vector<Stmt> lower(const Target&     target,
                                      ? ctx.iterators[resultStep]
                                      : Iterator();
 
-  bool emitCompute  = util::contains(ctx.properties, Compute);
+  bool emitCompute  = util::contains(ctx.properties, Compute) &&
+                      !ctx.countSegments;
   bool emitAssemble = util::contains(ctx.properties, Assemble);
   bool emitMerge    = needsMerge(lattice);
 
+  // The parallel segments of the sparse last level of the result start in
+  // the loops of the level above it
+  Iterator segmentIterator;
+  if (ctx.segmentParallel && resultStep.getPath().defined() &&
+      resultStep.getStep() == (int)resultPath.getSize() - 2) {
+    segmentIterator = ctx.iterators[resultPath.getLastStep()];
+  }
+
   // Emit code to initialize pos variables: B2_ptr = B.d2.ptr[B1_pos];
   if (emitMerge) {
     for (auto& iterator : latticeIterators) {
@@ -254,6 +333,15 @@ static vector<Stmt> lower(const Target&     target,
       loopBody.push_back(initPtr);
     }
 
+    // Emit code to start the result segment below this position, which is
+    // counted from zero or filled from its assembled start:
+    // int A22_pos = A2_L1_pos[A21_pos];
+    if (segmentIterator.defined()) {
+      Expr begin = ctx.countSegments ? Expr(0) : segmentIterator.begin();
+      loopBody.push_back(VarAssign::make(segmentIterator.getPtrVar(), begin,
+                                         true));
+    }
+
     // Emit one case per lattice point in the sub-lattice rooted at lp
     MergeLattice lpLattice = lattice.getSubLattice(lp);
     vector<pair<Expr,Stmt>> cases;
@@ -291,7 +379,7 @@ static vector<Stmt> lower(const Target&     target,
           TensorBase t(util::uniqueName("t"), ComponentType::Double);
           substitutions.insert({availExpr, taco::Access(t)});
 
-          Expr tensorVar = Var::make(t.getName(), Type(Type::Float,64));
+          Expr tensorVar = Var::make(t.getName(), getComputeType(target));
           ctx.temporaries.insert({t, tensorVar});
 
           Expr availIRExpr = lowerToScalarExpression(availExpr, ctx.iterators,
@@ -316,7 +404,7 @@ static vector<Stmt> lower(const Target&     target,
           case LAST_FREE:
           case BELOW_LAST_FREE: {
             TensorBase t( "t" + child.getName(), ComponentType::Double);
-            Expr tensorVar = Var::make(t.getName(), Type(Type::Float,64));
+            Expr tensorVar = Var::make(t.getName(), ctx.accumulatorType);
             ctx.temporaries.insert({t, tensorVar});
 
             // Extract the expression to compute at the next level
@@ -353,6 +441,19 @@ static vector<Stmt> lower(const Target&     target,
               Stmt store = ctx.schedule.hasReductionVariableAncestor(indexVar)
                   ? compoundStore(target.tensor, target.ptr, scalarExpr)
                   :   Store::make(target.tensor, target.ptr, scalarExpr);
+
+              // Rows that a partition of the nonzeros shares with its
+              // neighbours are stored into its carries
+              if (ctx.nonzeros.iterator.defined() &&
+                  ctx.schedule.getAncestors(indexVar).size() == 1) {
+                Expr carries = ctx.nonzeros.carries;
+                Expr carry = Mul::make(2, ctx.nonzeros.partition);
+                store = IfThenElse::make(Eq::make(idx, ctx.nonzeros.firstRow),
+                    Store::make(carries, carry, scalarExpr),
+                    IfThenElse::make(Eq::make(idx, ctx.nonzeros.lastRow),
+                        Store::make(carries, Add::make(carry, 1), scalarExpr),
+                        store));
+              }
               caseBody.push_back(store);
             }
             else {
@@ -368,7 +469,7 @@ static vector<Stmt> lower(const Target&     target,
 
       // Emit a store of the index variable value to the result idx index array
       // A.d2.idx[A2_ptr] = j;
-      if (emitAssemble && resultIterator.defined()){
+      if (emitAssemble && resultIterator.defined() && !ctx.countSegments){
         Stmt idxStore = resultIterator.storeIdx(idx);
         if (idxStore.defined()) {
           util::append(caseBody, {idxStore});
@@ -404,8 +505,9 @@ static vector<Stmt> lower(const Target&     target,
               Gt::make(Load::make(ptrArr, Add::make(resultPtr,1)),
                        Load::make(ptrArr, resultPtr));
           ptrInc = IfThenElse::make(producedVals, ptrInc);
-        } else if (emitAssemble) {
-          // Emit code to resize idx (at result store loop nest)
+        } else if (emitAssemble && !ctx.segmentParallel) {
+          // Emit code to resize idx (at result store loop nest).  Parallel
+          // segments are filled into an idx array of the counted size.
           resizeIndices = IfThenElse::make(doResize, resizeIndices);
           ptrInc = Block::make({ptrInc, resizeIndices});
         }
@@ -449,16 +551,60 @@ static vector<Stmt> lower(const Target&     target,
     }
     else {
       bool parallel = ctx.schedule.getAncestors(indexVar).size() == 1 &&
-                      indexVar.isFree();
+                      (indexVar.isFree() ||
+                       (ctx.reductionParallel && emitCompute));
       for (size_t i = 0; i < ctx.schedule.getResultTensorPath().getSize(); i++){
-        if (!ctx.iterators[resultPath.getStep(i)].isDense()) {
+        if (!ctx.iterators[resultPath.getStep(i)].isDense() &&
+            !ctx.segmentParallel) {
           parallel = false;
         }
       }
+
+      // The threads of a parallel reduction add into private copies of the
+      // scalar result temporary or of the dense result values
+      vector<pair<Expr,Expr>> reductions;
+      if (parallel && indexVar.isReduction()) {
+        Expr size = target.ptr.defined()
+                    ? getNumPositions(ctx, resultPath.getSize())
+                    : Expr();
+        reductions.push_back({target.tensor, size});
+      }
+
+      // Loops scheduled by nonzeros iterate over the rows and positions of
+      // one partition of the nonzeros
       Iterator iter = getIterator(lpIterators);
-      LoopKind loopKind = parallel ? LoopKind::Parallel : LoopKind::Serial;
-      loop = For::make(iter.getIteratorVar(), iter.begin(), iter.end(), 1,
-                       Block::make(loopBody), loopKind);
+      Expr begin = iter.begin();
+      Expr end = iter.end();
+      if (ctx.nonzeros.iterator.defined()) {
+        if (ctx.schedule.getAncestors(indexVar).size() == 1) {
+          begin = ctx.nonzeros.firstRow;
+          end = Add::make(ctx.nonzeros.lastRow, 1);
+          parallel = false;
+        }
+        else if (iter == ctx.nonzeros.iterator) {
+          begin = Max::make(begin, ctx.nonzeros.begin);
+          end = Min::make({end, ctx.nonzeros.end});
+        }
+      }
+
+      // Innermost loops that do not merge (e.g. dense loops and sparse loops
+      // that gather from dense operands) are vectorized, since their
+      // iterations store to distinct locations or reduce into a temporary.
+      // Loops that store to the result at a coordinate loaded from an idx
+      // array are not, since the coordinates may repeat (e.g. the padding of
+      // fixed levels), and neither are loops that append to a sparse result.
+      bool vectorize = !parallel && emitCompute &&
+                       ctx.schedule.getChildren(indexVar).empty() &&
+                       !(resultIterator.defined() &&
+                         (resultIterator.isSequentialAccess() ||
+                          !iter.isDense()));
+
+      LoopKind loopKind = parallel  ? LoopKind::Parallel
+                        : vectorize ? LoopKind::Vectorized
+                        :             LoopKind::Serial;
+      loop = For::make(iter.getIteratorVar(), begin, end, 1,
+                       Block::make(loopBody), loopKind,
+                       vectorize ? ctx.vectorWidth : 0, reductions);
     }
     loops.push_back(loop);
   }
@@ -466,7 +612,8 @@ static vector<Stmt> lower(const Target&     target,
 
   // Emit a store of the  segment size to the result ptr index
   // A.d2.ptr[A1_ptr + 1] = A2_ptr;
-  if (emitAssemble && resultIterator.defined()) {
+  if (emitAssemble && resultIterator.defined() &&
+      (!ctx.segmentParallel || ctx.countSegments)) {
     Stmt ptrStore = resultIterator.storePtr();
     if (ptrStore.defined()) {
       util::append(code, {ptrStore});
@@ -477,11 +624,260 @@ static vector<Stmt> lower(const Target&     target,
   return code;
 }
 
+/// Returns true if the segments of the last level of the result can be
+/// assembled and computed in parallel.  This is the case when the last level
+/// is the only sparse level of the result, like in CSR, when the outermost loop
+/// iterates over the first result level without merging, and when the kernels
+/// are compiled for OpenMP.
+static bool isSegmentParallel(const TensorBase& tensor, const Context& ctx) {
+  taco::Target target = tensor.getTarget();
+  if (target.arch != taco::Target::C99 ||
+      target.parallelism != taco::Target::OpenMP) {
+    return false;
+  }
+
+  const vector<Level>& levels = tensor.getFormat().getLevels();
+  if (levels.size() < 2 || levels.back().getType() != DimensionType::Sparse) {
+    return false;
+  }
+  for (size_t i = 0; i < levels.size() - 1; i++) {
+    if (levels[i].getType() != DimensionType::Dense) {
+      return false;
+    }
+  }
+
+  const vector<taco::Var>& roots = ctx.schedule.getRoots();
+  const vector<taco::Var>& resultVars =
+      ctx.schedule.getResultTensorPath().getVariables();
+  if (roots.size() != 1 || roots[0] != resultVars[0] ||
+      ctx.schedule.hasReductionVariableAncestor(resultVars.back())) {
+    return false;
+  }
+  return !needsMerge(MergeLattice::make(tensor.getExpr(), roots[0],
+                                        ctx.schedule, ctx.iterators));
+}
+
+/// Returns true if the root loop, which iterates over a reduction variable,
+/// can run in parallel.  This is the case when the result is a scalar or only
+/// has dense levels, so every thread can add into a private copy of it, when
+/// the root loop does not merge, and when the kernels are compiled for OpenMP.
+static bool isReductionParallel(const TensorBase& tensor, const Context& ctx) {
+  taco::Target target = tensor.getTarget();
+  if (target.arch != taco::Target::C99 ||
+      target.parallelism != taco::Target::OpenMP) {
+    return false;
+  }
+
+  for (auto& level : tensor.getFormat().getLevels()) {
+    if (level.getType() != DimensionType::Dense) {
+      return false;
+    }
+  }
+
+  const vector<taco::Var>& roots = ctx.schedule.getRoots();
+  if (roots.size() != 1 || !roots[0].isReduction()) {
+    return false;
+  }
+  return !needsMerge(MergeLattice::make(tensor.getExpr(), roots[0],
+                                        ctx.schedule, ctx.iterators));
+}
+
+/// Returns the iterator over the sparse level whose nonzeros the root loop is
+/// partitioned by, if the tensor is scheduled by nonzeros, and an undefined
+/// iterator otherwise.  The root loop must iterate over the rows of a dense
+/// vector result and of a CSR-like operand, and the result components must be
+/// reductions over the rows, like in SpMV, so partial rows can be summed.
+static Iterator getNonzeroIterator(const TensorBase& tensor,
+                                   const Context& ctx) {
+  taco::Target target = tensor.getTarget();
+  if (tensor.getParallelSchedule() != ParallelSchedule::Nonzeros ||
+      target.arch != taco::Target::C99 ||
+      target.parallelism != taco::Target::OpenMP) {
+    return Iterator();
+  }
+
+  const vector<Level>& levels = tensor.getFormat().getLevels();
+  const vector<taco::Var>& roots = ctx.schedule.getRoots();
+  if (levels.size() != 1 || levels[0].getType() != DimensionType::Dense ||
+      roots.size() != 1 || roots[0] != tensor.getIndexVars()[0] ||
+      ctx.schedule.getChildren(roots[0]).size() != 1) {
+    return Iterator();
+  }
+
+  taco::Expr expr = tensor.getExpr();
+  taco::Var row = roots[0];
+  taco::Var col = ctx.schedule.getChildren(row)[0];
+  if (!col.isReduction() ||
+      getSubExpr(expr, ctx.schedule.getDescendants(col)) != expr ||
+      needsMerge(MergeLattice::make(expr, row, ctx.schedule, ctx.iterators))) {
+    return Iterator();
+  }
+  MergeLattice lattice = MergeLattice::make(expr, col, ctx.schedule,
+                                            ctx.iterators);
+  if (needsMerge(lattice)) {
+    return Iterator();
+  }
+
+  vector<Iterator> latticeIterators = lattice.getIterators();
+  Iterator iterator = getIterator(latticeIterators);
+  for (auto& path : ctx.schedule.getTensorPaths()) {
+    const vector<Level>& pathLevels = path.getTensor().getFormat().getLevels();
+    if (path.getSize() >= 2 && path.getVariables()[0] == row &&
+        path.getVariables()[1] == col &&
+        ctx.iterators[path.getStep(1)] == iterator &&
+        pathLevels[0].getType() == DimensionType::Dense &&
+        pathLevels[1].getType() == DimensionType::Sparse) {
+      return iterator;
+    }
+  }
+  return Iterator();
+}
+
+/// Emit a binary search for the last row that begins before the position, or
+/// the first row if there is none.
+static Stmt searchRow(Expr pos, Expr numRows, Expr position, Expr row) {
+  Expr low  = Var::make("low", Type(Type::Int));
+  Expr high = Var::make("high", Type(Type::Int));
+  Expr mid  = Var::make("mid", Type(Type::Int));
+  return Block::make({
+    VarAssign::make(low, 0, true),
+    VarAssign::make(high, numRows, true),
+    While::make(Lt::make(Add::make(low, 1), high), Block::make({
+      VarAssign::make(mid, Div::make(Add::make(low, high), 2), true),
+      IfThenElse::make(Lt::make(Load::make(pos, mid), position),
+                       VarAssign::make(low, mid),
+                       VarAssign::make(high, mid))
+    })),
+    VarAssign::make(row, low)
+  });
+}
+
+/// Emit compute code that splits the nonzeros of the CSR-like operand into
+/// partitions of NONZEROS_PER_PARTITION nonzeros, which are computed in
+/// parallel.  Each partition binary searches for its first and last rows,
+/// which it may share with its neighbours, and stores their sums into carries.
+/// The carries are added into the result after the loop.  Matrices without
+/// rows have no first and last rows, so the code is skipped for them.
+static vector<Stmt> lowerNonzeroSchedule(const Target& target,
+                                         const taco::Expr& indexExpr,
+                                         const taco::Var& root,
+                                         Context& ctx) {
+  NonzeroPartition& nonzeros = ctx.nonzeros;
+  Expr numRows = nonzeros.iterator.getParent().end();
+  Expr pos = GetProperty::make(nonzeros.iterator.getTensor(),
+                               TensorProperty::Pointer, 1);
+  Type posType = pos.type();
+  Type intType = Type(Type::Int);
+
+  vector<Stmt> code;
+  Expr numNonzeros = Var::make("num_nonzeros", posType);
+  Expr numPartitions = Var::make("num_partitions", intType);
+  Expr numCarries = Mul::make(2, numPartitions);
+  Expr carryRows = Var::make("carry_rows", intType, true);
+  nonzeros.carries = Var::make("carries", ctx.accumulatorType, true);
+  code.push_back(VarAssign::make(numNonzeros, Load::make(pos, numRows), true));
+  code.push_back(VarAssign::make(numPartitions,
+      Add::make(Div::make(numNonzeros, NONZEROS_PER_PARTITION), 1), true));
+  code.push_back(Allocate::make(nonzeros.carries, numCarries));
+  code.push_back(Allocate::make(carryRows, numCarries));
+
+  // The first partition begins at the first row and the last partition ends
+  // at the last row, so empty rows at either end are computed too
+  nonzeros.partition = Var::make("partition", intType);
+  nonzeros.begin     = Var::make("nonzeros_begin", posType);
+  nonzeros.end       = Var::make("nonzeros_end", posType);
+  nonzeros.firstRow  = Var::make("first_row", intType);
+  nonzeros.lastRow   = Var::make("last_row", intType);
+  Expr partition = nonzeros.partition;
+  Expr firstCarry = Mul::make(2, partition);
+  Expr lastCarry = Add::make(firstCarry, 1);
+  vector<Stmt> body = {
+    VarAssign::make(nonzeros.begin,
+                    Mul::make(partition, NONZEROS_PER_PARTITION), true),
+    VarAssign::make(nonzeros.end,
+                    Min::make({Add::make(nonzeros.begin,
+                                         NONZEROS_PER_PARTITION),
+                               numNonzeros}), true),
+    VarAssign::make(nonzeros.firstRow, 0, true),
+    IfThenElse::make(Gt::make(partition, 0),
+                     searchRow(pos, numRows, nonzeros.begin,
+                               nonzeros.firstRow)),
+    VarAssign::make(nonzeros.lastRow, Sub::make(numRows, 1), true),
+    IfThenElse::make(Lt::make(partition, Sub::make(numPartitions, 1)),
+                     searchRow(pos, numRows, nonzeros.end, nonzeros.lastRow)),
+    Store::make(nonzeros.carries, firstCarry, 0),
+    Store::make(nonzeros.carries, lastCarry, 0),
+    Store::make(carryRows, firstCarry, nonzeros.firstRow),
+    Store::make(carryRows, lastCarry, nonzeros.lastRow)
+  };
+  util::append(body, lower(target, indexExpr, root, ctx));
+  code.push_back(For::make(partition, 0, numPartitions, 1, Block::make(body),
+                           LoopKind::Parallel));
+
+  // Rows may be shared by several partitions, so they are cleared before the
+  // carries are added into them
+  Expr carry = Var::make("carry", intType);
+  Expr row = Load::make(carryRows, carry);
+  code.push_back(For::make(carry, 0, numCarries, 1,
+                           Store::make(target.tensor, row, 0)));
+  code.push_back(For::make(carry, 0, numCarries, 1,
+      compoundStore(target.tensor, row, Load::make(nonzeros.carries, carry))));
+  code.push_back(Free::make(nonzeros.carries));
+  code.push_back(Free::make(carryRows));
+  return {IfThenElse::make(Gt::make(numRows, 0), Block::make(code))};
+}
+
+/// Emit assembly code that counts the size of every segment of the sparse
+/// last level of the result in parallel, prefix sums the sizes into the pos
+/// array, and then fills the idx array in parallel.
+static vector<Stmt> lowerSegmentAssembly(const Target& target,
+                                         const taco::Expr& indexExpr,
+                                         const taco::Var& root,
+                                         Context& ctx) {
+  TensorPath resultPath = ctx.schedule.getResultTensorPath();
+  Iterator segmentIterator = ctx.iterators[resultPath.getLastStep()];
+  Expr numSegments = getNumPositions(ctx, resultPath.getSize() - 1);
+
+  // The index arrays hold allocSize elements until they need more
+  vector<Stmt> code;
+  Expr allocSize = (int)ctx.allocSize;
+  Expr numPositions = Add::make(numSegments, 1);
+  code.push_back(IfThenElse::make(Lt::make(allocSize, numPositions),
+      segmentIterator.resizePtrStorage(numPositions)));
+
+  ctx.countSegments = true;
+  util::append(code, lower(target, indexExpr, root, ctx));
+  ctx.countSegments = false;
+
+  Expr pos = GetProperty::make(segmentIterator.getTensor(),
+                               TensorProperty::Pointer,
+                               resultPath.getSize() - 1);
+  Expr segment = Var::make("segment", Type(Type::Int));
+  Expr next = Add::make(segment, 1);
+  code.push_back(For::make(segment, 0, numSegments, 1,
+      Store::make(pos, next, Add::make(Load::make(pos, next),
+                                       Load::make(pos, segment)))));
+  Expr numIndices = Load::make(pos, numSegments);
+  code.push_back(IfThenElse::make(Lt::make(allocSize, numIndices),
+      segmentIterator.resizeIdxStorage(numIndices)));
+
+  util::append(code, lower(target, indexExpr, root, ctx));
+  return code;
+}
+
 Stmt lower(TensorBase tensor, string funcName, set<Property> properties) {
   Context ctx;
   ctx.allocSize  = tensor.getAllocSize();
   ctx.properties = properties;
 
+  // Booleans are accumulated as ints and converted when they are stored, like
+  // C promotes them
+  Type accumulatorType = getIRType(tensor.getAccumulatorType());
+  ctx.accumulatorType = accumulatorType.isBool() ? Type(Type::Int)
+                                                 : accumulatorType;
+  ctx.vectorWidth = tensor.getTarget().getVectorBytes() * 8 /
+                    ctx.accumulatorType.bits;
+
   auto name = tensor.getName();
   auto vars = tensor.getIndexVars();
   auto indexExpr = tensor.getExpr();
@@ -496,12 +892,37 @@ Stmt lower(TensorBase tensor, string funcName, set<Property> properties) {
   ctx.schedule = IterationSchedule::make(tensor);
   ctx.iterators = Iterators(ctx.schedule, tensorVars);
 
-  // Initialize the result ptr variables
+  // Fixed segments are padded with zeros at the last coordinate of the
+  // segment, so they can only be read where the padding adds zero
+  for (auto& level : tensor.getFormat().getLevels()) {
+    taco_uassert(level.getType() != DimensionType::Fixed) <<
+        "Fixed (ELL) levels are not supported in results: " << name;
+  }
+  for (auto& path : ctx.schedule.getTensorPaths()) {
+    const vector<Level>& levels = path.getTensor().getFormat().getLevels();
+    for (size_t i = 0; i < path.getSize(); i++) {
+      const taco::Var& var = path.getVariables()[i];
+      taco_uassert(levels[i].getType() != DimensionType::Fixed ||
+                   var.isReduction() ||
+                   ctx.schedule.hasReductionVariableAncestor(var)) <<
+          "The fixed (ELL) level of " << path.getTensor().getName() <<
+          " must be indexed by a reduction variable, or by a free variable "
+          "below one, but is indexed by " << var;
+    }
+  }
+
+  // Initialize the result ptr variables.  Parallel segments are initialized
+  // where they start.
   TensorPath resultPath = ctx.schedule.getResultTensorPath();
+  ctx.segmentParallel = isSegmentParallel(tensor, ctx);
+  ctx.reductionParallel = isReductionParallel(tensor, ctx);
+  if (util::contains(properties, Compute)) {
+    ctx.nonzeros.iterator = getNonzeroIterator(tensor, ctx);
+  }
   vector<Stmt> resultPtrInit;
   for (auto& indexVar : tensor.getIndexVars()) {
     Iterator iter = ctx.iterators[resultPath.getStep(indexVar)];
-    if (iter.isSequentialAccess()) {
+    if (iter.isSequentialAccess() && !ctx.segmentParallel) {
       Expr ptr = iter.getPtrVar();
       Expr ptrPrev = iter.getParent().getPtrVar();
 
@@ -526,9 +947,29 @@ Stmt lower(TensorBase tensor, string funcName, set<Property> properties) {
                                       TensorProperty::Values);
     target.ptr = resultIterator.getPtrVar();
 
-    for (auto& root : roots) {
-      auto loopNest = lower::lower(target, indexExpr, root, ctx);
-      util::append(code, loopNest);
+    if (ctx.segmentParallel && util::contains(properties, Assemble)) {
+      code = lowerSegmentAssembly(target, indexExpr, roots[0], ctx);
+    }
+    else if (ctx.nonzeros.iterator.defined()) {
+      code = lowerNonzeroSchedule(target, indexExpr, roots[0], ctx);
+    }
+    else if (ctx.reductionParallel && resultPath.getSize() == 0) {
+      // The threads reduce a scalar result into private temporaries, which
+      // are added into the result after the loop
+      Expr result = Var::make("t" + name, ctx.accumulatorType);
+      Target resultTarget;
+      resultTarget.tensor = result;
+      code.push_back(VarAssign::make(result, 0.0, true));
+      util::append(code, lower::lower(resultTarget, indexExpr, roots[0], ctx));
+      if (util::contains(properties, Compute)) {
+        code.push_back(compoundStore(target.tensor, target.ptr, result));
+      }
+    }
+    else {
+      for (auto& root : roots) {
+        auto loopNest = lower::lower(target, indexExpr, root, ctx);
+        util::append(code, loopNest);
+      }
     }
   }
   // Lower scalar expressions
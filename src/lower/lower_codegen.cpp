@@ -18,6 +18,23 @@ using namespace taco::expr_nodes;
 namespace taco {
 namespace lower {
 
+ir::Type getIRType(ComponentType ctype) {
+  switch (ctype.getKind()) {
+    case ComponentType::Bool:
+      return Type(Type::UInt, 1);
+    case ComponentType::Int:
+      return Type(Type::Int, 32);
+    case ComponentType::Float:
+      return Type(Type::Float, 32);
+    case ComponentType::Double:
+      return Type(Type::Float, 64);
+    case ComponentType::Unknown:
+      break;
+  }
+  taco_ierror << "Tensors must have a known component type";
+  return Type(Type::Float, 64);
+}
+
 std::tuple<std::vector<ir::Expr>,         // parameters
            std::vector<ir::Expr>,         // results
            std::map<TensorBase,ir::Expr>> // mapping
@@ -27,7 +44,8 @@ getTensorVars(const TensorBase& tensor) {
   map<TensorBase, ir::Expr> mapping;
 
   // Pack result tensor into output parameter list
-  ir::Expr tensorVar = ir::Var::make(tensor.getName(), Type(Type::Float,64),
+  ir::Expr tensorVar = ir::Var::make(tensor.getName(),
+                                     getIRType(tensor.getComponentType()),
                                      tensor.getFormat());
   mapping.insert({tensor, tensorVar});
   results.push_back(tensorVar);
@@ -36,7 +54,8 @@ getTensorVars(const TensorBase& tensor) {
   vector<TensorBase> operands = expr_nodes::getOperands(tensor.getExpr());
   for (TensorBase& operand : operands) {
     taco_iassert(!util::contains(mapping, operand));
-    ir::Expr operandVar = ir::Var::make(operand.getName(), Type(Type::Float,64),
+    ir::Expr operandVar = ir::Var::make(operand.getName(),
+                                        getIRType(operand.getComponentType()),
                                         operand.getFormat());
     mapping.insert({operand, operandVar});
     parameters.push_back(operandVar);
@@ -7,6 +7,7 @@
 
 namespace taco {
 class TensorBase;
+class ComponentType;
 class Expr;
 namespace storage {
 class Iterator;
@@ -14,12 +15,16 @@ class Iterator;
 namespace ir {
 class Stmt;
 class Expr;
+class Type;
 }
 
 namespace lower {
 class IterationSchedule;
 class Iterators;
 
+/// Returns the IR type of the components of tensors with the given type.
+ir::Type getIRType(ComponentType ctype);
+
 std::tuple<std::vector<ir::Expr>,         // parameters
            std::vector<ir::Expr>,         // results
            std::map<TensorBase,ir::Expr>> // mapping
@@ -15,7 +15,7 @@ DenseIterator::DenseIterator(std::string name, const Expr& tensor, int level,
 
   std::string indexVarName = name + util::toString(tensor);
   ptrVar = Var::make(util::toString(tensor) + std::to_string(level+1)+"_pos",
-                     Type(Type::Int));
+                     getPositionType(tensor));
   idxVar = Var::make(indexVarName, Type(Type::Int));
 
   this->dimSize = (int)dimSize;
@@ -15,7 +15,7 @@ FixedIterator::FixedIterator(std::string name, const Expr& tensor, int level,
 
   std::string idxVarName = name + util::toString(tensor);
   ptrVar = Var::make(util::toString(tensor) + std::to_string(level+1)+"_ptr",
-                     Type(Type::Int));
+                     getPositionType(tensor));
   idxVar = Var::make(idxVarName,Type(Type::Int));
 
   this->fixedSize = (int)fixedSize;
@@ -45,18 +45,18 @@ Expr FixedIterator::getIteratorVar() const {
   return ptrVar;
 }
 
+// Every segment holds fixedSize positions
 Expr FixedIterator::begin() const {
-  return 0;
+  return Mul::make(getParent().getPtrVar(), fixedSize);
 }
 
 Expr FixedIterator::end() const {
-  return fixedSize;
+  return Mul::make(Add::make(getParent().getPtrVar(), 1), fixedSize);
 }
 
 Stmt FixedIterator::initDerivedVars() const {
-  Expr ptrVal = Add::make(Mul::make(getParent().getPtrVar(), end()),
-                          getIdxVar());
-  return VarAssign::make(getIdxVar(), ptrVal);
+  return VarAssign::make(getIdxVar(), Load::make(getIdxArr(), getPtrVar()),
+                         true);
 }
 
 ir::Stmt FixedIterator::storePtr() const {
@@ -1,310 +1,1054 @@
 #include "taco/storage/pack.h"
 
+#include <algorithm>
+#include <atomic>
+#include <climits>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <numeric>
+#include <sstream>
+#include <string>
+
 #include "taco/format.h"
 #include "taco/error.h"
+#include "taco/target.h"
 #include "ir/ir.h"
+#include "backends/module.h"
+#include "backends/module_cache.h"
+#include "lower/lower_codegen.h"
 #include "taco/storage/storage.h"
 #include "taco/util/collections.h"
+#include "taco/util/env.h"
+#include "taco/util/parallel.h"
+#include "taco/util/strings.h"
+#include "taco_tensor_t.h"
 
 using namespace std;
 
 namespace taco {
 namespace storage {
 
-/// Count unique entries (assumes the values are sorted)
-static vector<size_t> getUniqueEntries(const vector<int>::const_iterator& begin,
-                                       const vector<int>::const_iterator& end) {
-  vector<size_t> uniqueEntries;
-  if (begin != end) {
-    size_t curr = *begin;
-    uniqueEntries.push_back(curr);
-    for (auto it = begin+1; it != end; ++it) {
-      size_t next = *it;
-      taco_iassert(next >= curr);
-      if (curr < next) {
-        curr = next;
-        uniqueEntries.push_back(curr);
+// Sorting and packing is split across threads if each thread gets at least
+// this many coordinates.
+static const size_t minCoordinatesPerThread = 1 << 14;
+
+static int getNumPackThreads(size_t numCoordinates) {
+  return util::getNumThreads(numCoordinates, minCoordinatesPerThread);
+}
+
+namespace {
+/// A coordinate, with the coordinates of its dimensions concatenated into one
+/// integer key, and its value.
+struct KeyValue {
+  uint64_t key;
+  double   value;
+};
+}
+
+/// Stable least-significant-digit radix sort on the low `numBits` key bits.
+/// Each thread counts and scatters the keys of a contiguous range, so the
+/// threads scatter into disjoint parts of every bucket.
+static void radixSort(vector<KeyValue>* keyValues, int numBits,
+                      int numThreads) {
+  const int digitBits = 8;
+  const size_t numBuckets = 1 << digitBits;
+  const size_t size = keyValues->size();
+
+  vector<KeyValue> buffer(size);
+  KeyValue* in  = keyValues->data();
+  KeyValue* out = buffer.data();
+  vector<vector<size_t>> offsets(numThreads, vector<size_t>(numBuckets));
+  for (int shift = 0; shift < numBits; shift += digitBits) {
+    util::parallelFor(numThreads, [&](int t) {
+      vector<size_t>& histogram = offsets[t];
+      std::fill(histogram.begin(), histogram.end(), 0);
+      size_t end = util::partition(size, t+1, numThreads);
+      for (size_t i = util::partition(size, t, numThreads); i < end; i++) {
+        histogram[(in[i].key >> shift) & (numBuckets-1)]++;
       }
+    });
+
+    // Skip digits that are the same in every key
+    bool skip = false;
+    size_t offset = 0;
+    for (size_t b = 0; b < numBuckets; b++) {
+      size_t bucketBegin = offset;
+      for (int t = 0; t < numThreads; t++) {
+        size_t count = offsets[t][b];
+        offsets[t][b] = offset;
+        offset += count;
+      }
+      skip |= (offset - bucketBegin == size);
+    }
+    if (skip) {
+      continue;
     }
+
+    util::parallelFor(numThreads, [&](int t) {
+      vector<size_t>& offset = offsets[t];
+      size_t end = util::partition(size, t+1, numThreads);
+      for (size_t i = util::partition(size, t, numThreads); i < end; i++) {
+        out[offset[(in[i].key >> shift) & (numBuckets-1)]++] = in[i];
+      }
+    });
+    std::swap(in, out);
   }
-  return uniqueEntries;
-}
 
-#define PACK_NEXT_LEVEL(cend) { \
-    if (i + 1 == dimTypes.size()) { \
-      values->push_back((cbegin < cend) ? vals[cbegin] : 0.0); \
-    } else { \
-      packTensor(dims, coords, vals, cbegin, (cend), dimTypes, i+1, \
-                 indices, values); \
-    } \
+  if (in != keyValues->data()) {
+    keyValues->swap(buffer);
+  }
 }
 
-/// Pack tensor coordinates into an index structure and value array.  The
-/// indices consist of one index per tensor dimension, and each index contains
-/// [0,2] index arrays.
-static void packTensor(const vector<int>& dims,
-                       const vector<vector<int>>& coords,
-                       const double* vals,
-                       size_t begin, size_t end,
-                       const vector<DimensionType>& dimTypes, size_t i,
-                       std::vector<std::vector<std::vector<int>>>* indices,
-                       vector<double>* values) {
-  auto& dimType     = dimTypes[i];
-  auto& levelCoords = coords[i];
-  auto& index       = (*indices)[i];
-
-  switch (dimType) {
-    case Dense: {
-      // Iterate over each index value and recursively pack it's segment
-      size_t cbegin = begin;
-      for (int j=0; j < (int)dims[i]; ++j) {
-        // Scan to find segment range of children
-        size_t cend = cbegin;
-        while (cend < end && levelCoords[cend] == j) {
-          cend++;
-        }
-        PACK_NEXT_LEVEL(cend);
-        cbegin = cend;
+void sortCoordinates(const char* buffer, size_t numCoordinates,
+                     const vector<int>& permutation,
+                     vector<vector<int>>* coordinates,
+                     vector<double>* values) {
+  const size_t order = permutation.size();
+  const size_t coordinateSize = order*sizeof(int) + sizeof(double);
+  const int numThreads = getNumPackThreads(numCoordinates);
+
+  auto getCoordinates = [&](size_t i) {
+    return (const int*)&buffer[i*coordinateSize];
+  };
+  auto getValue = [&](size_t i) {
+    double value;
+    memcpy(&value, &buffer[i*coordinateSize + order*sizeof(int)],
+           sizeof(double));
+    return value;
+  };
+
+  // The sorted coordinates and values are allocated once the sort has freed
+  // its scratch arrays, so that they never coexist with both
+  auto allocateSorted = [&]() {
+    coordinates->assign(order, vector<int>(numCoordinates));
+    values->resize(numCoordinates);
+  };
+
+  // Find the range of the coordinates of each dimension
+  vector<vector<int>> minCoords(numThreads, vector<int>(order, INT_MAX));
+  vector<vector<int>> maxCoords(numThreads, vector<int>(order, 0));
+  util::parallelFor(numThreads, [&](int t) {
+    size_t end = util::partition(numCoordinates, t+1, numThreads);
+    for (size_t i = util::partition(numCoordinates, t, numThreads); i < end;
+         i++) {
+      const int* coordinate = getCoordinates(i);
+      for (size_t l = 0; l < order; l++) {
+        int c = coordinate[permutation[l]];
+        minCoords[t][l] = min(minCoords[t][l], c);
+        maxCoords[t][l] = max(maxCoords[t][l], c);
       }
-      break;
-    }
-    case Sparse: {
-      auto indexValues = getUniqueEntries(levelCoords.begin()+begin,
-                                          levelCoords.begin()+end);
-
-      // Store segment end: the size of the stored segment is the number of
-      // unique values in the coordinate list
-      index[0].push_back((int)(index[1].size() + indexValues.size()));
-
-      // Store unique index values for this segment
-      index[1].insert(index[1].end(), indexValues.begin(), indexValues.end());
-
-      // Iterate over each index value and recursively pack it's segment
-      size_t cbegin = begin;
-      for (size_t j : indexValues) {
-        // Scan to find segment range of children
-        size_t cend = cbegin;
-        while (cend < end && levelCoords[cend] == (int)j) {
-          cend++;
+    }
+  });
+  bool negativeCoords = false;
+  vector<int> levelBits(order, 0);
+  int numBits = 0;
+  for (size_t l = 0; l < order; l++) {
+    int maxCoord = 0;
+    for (int t = 0; t < numThreads; t++) {
+      negativeCoords |= (minCoords[t][l] < 0);
+      maxCoord = max(maxCoord, maxCoords[t][l]);
+    }
+    while ((maxCoord >> levelBits[l]) != 0) {
+      levelBits[l]++;
+    }
+    numBits += levelBits[l];
+  }
+
+  if (!negativeCoords && numBits <= 64) {
+    // Radix sort the coordinates, with their dimensions concatenated into keys
+    vector<KeyValue> keyValues(numCoordinates);
+    util::parallelFor(numThreads, [&](int t) {
+      size_t end = util::partition(numCoordinates, t+1, numThreads);
+      for (size_t i = util::partition(numCoordinates, t, numThreads); i < end;
+           i++) {
+        const int* coordinate = getCoordinates(i);
+        uint64_t key = 0;
+        for (size_t l = 0; l < order; l++) {
+          key = (key << levelBits[l]) | (uint64_t)coordinate[permutation[l]];
         }
-        PACK_NEXT_LEVEL(cend);
-        cbegin = cend;
+        keyValues[i] = {key, getValue(i)};
       }
-      break;
-    }
-    case Fixed: {
-      int fixedValue = index[0][0];
-      auto indexValues = getUniqueEntries(levelCoords.begin()+begin,
-                                          levelCoords.begin()+end);
-
-      // Store segment end: the size of the stored segment is the number of
-      // unique values in the coordinate list
-      int segmentSize = indexValues.size() ;
-      // Store unique index values for this segment
-      size_t cbegin = begin;
-      if (segmentSize > 0) {
-        index[1].insert(index[1].end(), indexValues.begin(), indexValues.end());
-        for (size_t j : indexValues) {
-          // Scan to find segment range of children
-          size_t cend = cbegin;
-          while (cend < end && levelCoords[cend] == (int)j) {
-            cend++;
-          }
-          PACK_NEXT_LEVEL(cend);
-          cbegin = cend;
+    });
+
+    radixSort(&keyValues, numBits, numThreads);
+    allocateSorted();
+
+    util::parallelFor(numThreads, [&](int t) {
+      size_t end = util::partition(numCoordinates, t+1, numThreads);
+      for (size_t i = util::partition(numCoordinates, t, numThreads); i < end;
+           i++) {
+        uint64_t key = keyValues[i].key;
+        for (size_t l = order; l-- > 0;) {
+          (*coordinates)[l][i] = (int)(key & ((uint64_t(1) << levelBits[l])-1));
+          key >>= levelBits[l];
         }
+        (*values)[i] = keyValues[i].value;
       }
-      // Complete index if necessary with the last index value
-      auto curSize=segmentSize;
-      while (curSize < fixedValue) {
-        index[1].insert(index[1].end(), 
-                        (segmentSize > 0) ? indexValues[segmentSize-1] : 0);
-        PACK_NEXT_LEVEL(cbegin);
-        curSize++;
+    });
+  }
+  else {
+    // The keys do not fit in 64 bits, so sort a permutation of the coordinates
+    // in parallel parts and merge the sorted parts pairwise
+    auto less = [&](size_t a, size_t b) {
+      const int* coordA = getCoordinates(a);
+      const int* coordB = getCoordinates(b);
+      for (size_t l = 0; l < order; l++) {
+        int dim = permutation[l];
+        if (coordA[dim] != coordB[dim]) {
+          return coordA[dim] < coordB[dim];
+        }
       }
-      break;
+      return false;
+    };
+
+    vector<size_t> sorted(numCoordinates);
+    std::iota(sorted.begin(), sorted.end(), 0);
+    util::parallelFor(numThreads, [&](int t) {
+      std::stable_sort(
+          sorted.begin() + util::partition(numCoordinates, t, numThreads),
+          sorted.begin() + util::partition(numCoordinates, t+1, numThreads),
+          less);
+    });
+    vector<size_t> merged(numCoordinates);
+    for (int width = 1; width < numThreads; width *= 2) {
+      int numMerges = (numThreads + 2*width - 1) / (2*width);
+      util::parallelFor(numMerges, [&](int m) {
+        auto boundary = [&](int part) {
+          return util::partition(numCoordinates, min(part, numThreads),
+                                 numThreads);
+        };
+        size_t begin  = boundary(2*m*width);
+        size_t middle = boundary(2*m*width + width);
+        size_t end    = boundary(2*m*width + 2*width);
+        std::merge(sorted.begin()+begin, sorted.begin()+middle,
+                   sorted.begin()+middle, sorted.begin()+end,
+                   merged.begin()+begin, less);
+      });
+      sorted.swap(merged);
     }
+    vector<size_t>().swap(merged);
+    allocateSorted();
+
+    util::parallelFor(numThreads, [&](int t) {
+      size_t end = util::partition(numCoordinates, t+1, numThreads);
+      for (size_t i = util::partition(numCoordinates, t, numThreads); i < end;
+           i++) {
+        const int* coordinate = getCoordinates(sorted[i]);
+        for (size_t l = 0; l < order; l++) {
+          (*coordinates)[l][i] = coordinate[permutation[l]];
+        }
+        (*values)[i] = getValue(sorted[i]);
+      }
+    });
   }
 }
 
-static int findMaxFixedValue(const vector<int>& dims,
-                             const vector<vector<int>>& coords,
-                             size_t order,
-                             const size_t fixedLevel,
-                             const size_t i, const size_t numCoords) {
-  if (i == order) {
-    return numCoords;
-  }
-  if (i == fixedLevel) {
-    auto indexValues = getUniqueEntries(coords[i].begin(), coords[i].end());
-    return indexValues.size();
-  }
-  else {
-    // Find max occurrences for level i
-    size_t maxSize=0;
-    vector<int> maxCoords;
-    int coordCur=coords[i][0];
-    size_t sizeCur=1;
-    for (size_t j=1; j<numCoords; j++) {
-      if (coords[i][j] == coordCur) {
-        sizeCur++;
+namespace {
+/// The sizes of the index arrays and values that a thread packs from a range of
+/// coordinates that starts at a level 0 segment, and the largest number of
+/// children of a segment in each level (the size of a fixed level).
+struct PackSizes {
+  PackSizes(size_t order) : numPositions(order, 0), numSegmentEnds(order, 0),
+                            maxChildren(order, 0) {}
+
+  /// The number of index values (positions) in each level.
+  vector<size_t> numPositions;
+
+  /// The number of sparse segment ends stored by each level.
+  vector<size_t> numSegmentEnds;
+
+  vector<size_t> maxChildren;
+};
+
+/// Writes sorted coordinates into preallocated index arrays and values.  The
+/// cursors are where the next segment end, index value, and value are written.
+/// Dense levels do not store indices; they pack every coordinate of the level.
+struct Packer {
+  const vector<int>&           dimensions;
+  const vector<DimensionType>& dimTypes;
+  const vector<int>&           fixedSizes;
+  const vector<vector<int>>&   coordinates;
+  const double*                vals;
+  ComponentType                ctype;
+  IndexArrayType               positionType;
+  vector<IndexArrayType>       indexTypes;
+
+  vector<int*> pos;
+  vector<int*> idx;
+  vector<int*> segmentSizes;  // of fixed levels below level 0
+  void*        values;      // of the component type
+
+  vector<size_t> posCursor;
+  vector<size_t> idxCursor;
+  size_t         valCursor;
+
+  /// Pack the coordinates [begin,end), which share their first i coordinates.
+  void pack(size_t begin, size_t end, size_t i) {
+    if (i == dimTypes.size()) {
+      storeValue(values, ctype, valCursor++,
+                 (begin < end) ? vals[begin] : 0.0);
+      return;
+    }
+
+    const vector<int>& levelCoords = coordinates[i];
+    switch (dimTypes[i]) {
+      case Dense: {
+        packDense(begin, end, i, 0, dimensions[i]);
+        break;
+      }
+      case Sparse: {
+        size_t cbegin = begin;
+        while (cbegin < end) {
+          size_t cend = segmentEnd(cbegin, end, i);
+          storeIndex(idx[i], indexTypes[i], idxCursor[i]++,
+                     levelCoords[cbegin]);
+          pack(cbegin, cend, i+1);
+          cbegin = cend;
+        }
+        // The segment end of level 0 is stored after all threads are done
+        if (i > 0) {
+          storeIndex(pos[i], positionType, posCursor[i]++, idxCursor[i]);
+        }
+        break;
       }
-      else {
-        if (sizeCur > maxSize) {
-          maxSize = sizeCur;
-          maxCoords.clear();
-          maxCoords.push_back(coordCur);
+      case Fixed: {
+        size_t cbegin = begin;
+        int segmentSize = 0;
+        while (cbegin < end) {
+          size_t cend = segmentEnd(cbegin, end, i);
+          storeIndex(idx[i], indexTypes[i], idxCursor[i]++,
+                     levelCoords[cbegin]);
+          pack(cbegin, cend, i+1);
+          segmentSize++;
+          cbegin = cend;
         }
-        else if (sizeCur == maxSize) {
-          maxCoords.push_back(coordCur);
+        // Complete the segment with the last index value.  Level 0 is a
+        // single segment that holds every level 0 coordinate.
+        if (i > 0) {
+          if (segmentSize > 0) {
+            segmentSizes[i][(idxCursor[i] - segmentSize) / fixedSizes[i]] =
+                segmentSize;
+          }
+          int last = (begin < end) ? levelCoords[end-1] : 0;
+          for (; segmentSize < fixedSizes[i]; segmentSize++) {
+            storeIndex(idx[i], indexTypes[i], idxCursor[i]++, last);
+            pack(end, end, i+1);
+          }
         }
-        sizeCur=1;
-        coordCur=coords[i][j];
+        break;
       }
     }
-    if (sizeCur > maxSize) {
-      maxSize = sizeCur;
-      maxCoords.clear();
-      maxCoords.push_back(coordCur);
+  }
+
+  /// Pack the segments [first,last) of the dense level i.
+  void packDense(size_t begin, size_t end, size_t i, int first, int last) {
+    const vector<int>& levelCoords = coordinates[i];
+    size_t cbegin = begin;
+    for (int j = first; j < last; ++j) {
+      size_t cend = cbegin;
+      while (cend < end && levelCoords[cend] == j) {
+        cend++;
+      }
+      pack(cbegin, cend, i+1);
+      cbegin = cend;
     }
-    else if (sizeCur == maxSize) {
-      maxCoords.push_back(coordCur);
+  }
+
+  /// Returns the end of the coordinates that start at `begin` and have the
+  /// same level i coordinate.
+  size_t segmentEnd(size_t begin, size_t end, size_t i) {
+    const vector<int>& levelCoords = coordinates[i];
+    size_t cend = begin + 1;
+    while (cend < end && levelCoords[cend] == levelCoords[begin]) {
+      cend++;
     }
+    return cend;
+  }
+};
+}
 
-    int maxFixedValue=0;
-    int maxSegment;
-    vector<vector<int>> newCoords(order);
-    for (size_t l=0; l<maxCoords.size(); l++) {
-      // clean coords for next level
-      for (size_t k=0; k<order;k++) {
-        newCoords[k].clear();
+/// Count the distinct coordinate prefixes of each length, and the largest
+/// number of distinct children of a prefix, in the sorted coordinates
+/// [begin,end).
+static PackSizes countPrefixes(const vector<vector<int>>& coordinates,
+                               size_t begin, size_t end) {
+  const size_t order = coordinates.size();
+  PackSizes sizes(order);
+  vector<size_t> numChildren(order, 0);
+  for (size_t k = begin; k < end; k++) {
+    // The first level where coordinate k differs from coordinate k-1
+    size_t firstDiff = 0;
+    if (k > begin) {
+      while (firstDiff < order &&
+             coordinates[firstDiff][k] == coordinates[firstDiff][k-1]) {
+        firstDiff++;
       }
-      for (size_t j=0; j<numCoords; j++) {
-        if (coords[i][j] == maxCoords[l]) {
-          for (size_t k=0; k<order;k++) {
-            newCoords[k].push_back(coords[k][j]);
-          }
-        }
+    }
+    for (size_t i = firstDiff; i < order; i++) {
+      sizes.numPositions[i]++;
+      numChildren[i] = (i > firstDiff) ? 1 : numChildren[i] + 1;
+      sizes.maxChildren[i] = max(sizes.maxChildren[i], numChildren[i]);
+    }
+  }
+  return sizes;
+}
+
+namespace {
+/// Thrown when the generated pack code does not compile.
+struct PackCodeCompileFailure {};
+}
+
+/// Returns a module with the generated pack code of the format and component
+/// type, or nullptr if the coordinates should be packed by the interpreter
+/// instead, which is also the case if the pack code does not compile (e.g.
+/// without a C compiler).
+static shared_ptr<ir::Module> getPackModule(const Format& format,
+                                            ComponentType ctype,
+                                            size_t numCoordinates) {
+  size_t threshold = util::getSizeFromEnv("TACO_PACK_CODE_THRESHOLD",
+                                          1 << 22);
+  const vector<DimensionType>& dimTypes = format.getDimensionTypes();
+  if (numCoordinates < threshold) {
+    return nullptr;
+  }
+
+  Target target = getTargetFromEnvironment();
+  stringstream key;
+  key << "pack:" << util::join(dimTypes) << ";indices:"
+      << util::join(format.getIndexTypes()) << ";type:" << ctype
+      << ";target:" << target.arch;
+  try {
+    return ir::getModuleCache().getOrCompile(key.str(),
+                                             [&format, ctype, target]() {
+      auto module = make_shared<ir::Module>(target);
+      module->addFunction(packCode(format, ctype));
+      if (!module->tryCompile()) {
+        throw PackCodeCompileFailure();
       }
-      maxSegment = findMaxFixedValue(dims, newCoords, order, fixedLevel,
-                                     i+1, maxSize);
-      maxFixedValue = std::max(maxFixedValue,maxSegment);
+      return module;
+    });
+  }
+  catch (const PackCodeCompileFailure&) {
+    static atomic<bool> warned(false);
+    if (!warned.exchange(true)) {
+      taco_uwarning << "Unable to compile pack code, so large tensors are "
+                       "packed by the interpreter";
     }
-    return maxFixedValue;
+    return nullptr;
   }
 }
 
 Storage pack(const std::vector<int>&              dimensions,
              const Format&                        format,
              const std::vector<std::vector<int>>& coordinates,
-             const std::vector<double>            values) {
+             const std::vector<double>&           values,
+             ComponentType ctype) {
   taco_iassert(dimensions.size() == format.getOrder());
 
-  Storage storage(format);
+  Storage storage(format, ctype);
 
-  size_t numDimensions = dimensions.size();
-  size_t numCoordinates = values.size();
+  const vector<DimensionType>& dimTypes = format.getDimensionTypes();
+  const size_t order = dimensions.size();
+  const size_t numCoordinates = values.size();
 
-  // Create vectors to store pointers to indices/index sizes
-  std::vector<std::vector<std::vector<int>>> indices;
-  indices.reserve(numDimensions);
+  // Split the coordinates between threads at level 0 coordinate boundaries,
+  // so that each thread packs whole level 0 segments
+  int numThreads = getNumPackThreads(numCoordinates);
+  const vector<int>& levelCoords = coordinates[0];
+  vector<size_t> bounds(numThreads+1, numCoordinates);
+  bounds[0] = 0;
+  for (int t = 1; t < numThreads; t++) {
+    size_t split = util::partition(numCoordinates, t, numThreads);
+    bounds[t] = lower_bound(levelCoords.begin() + bounds[t-1],
+                            levelCoords.begin() + split,
+                            levelCoords[split]) - levelCoords.begin();
+  }
 
-  for (size_t i=0; i < numDimensions; ++i) {
-    switch (format.getDimensionTypes()[i]) {
-      case Dense: {
-        indices.push_back({});
-        break;
+  // The level 0 segments of dense level 0 that each thread packs, which are
+  // the segments up to the next thread's first coordinate
+  vector<int> denseBounds(numThreads+1, dimensions[0]);
+  denseBounds[0] = 0;
+  for (int t = 1; t < numThreads; t++) {
+    denseBounds[t] = (bounds[t] < numCoordinates) ? levelCoords[bounds[t]]
+                                                  : dimensions[0];
+  }
+
+  // First pass: count the coordinate prefixes packed by each thread
+  vector<PackSizes> sizes(numThreads, PackSizes(order));
+  util::parallelFor(numThreads, [&](int t) {
+    sizes[t] = countPrefixes(coordinates, bounds[t], bounds[t+1]);
+  });
+
+  // Every segment of a fixed level stores as many index values as the segment
+  // with the most children.  The single segment of level 0 is split between
+  // the threads, so it holds all their children.
+  vector<int> fixedSizes(order, 0);
+  for (size_t i = 0; i < order; i++) {
+    for (int t = 0; t < numThreads; t++) {
+      const int maxChildren = (int)sizes[t].maxChildren[i];
+      fixedSizes[i] = (i == 0) ? fixedSizes[i] + maxChildren
+                               : max(fixedSizes[i], maxChildren);
+    }
+  }
+
+  // Dense and fixed levels store a segment for every position of the parent
+  // level, while sparse levels only store the distinct coordinate prefixes
+  for (int t = 0; t < numThreads; t++) {
+    PackSizes& threadSizes = sizes[t];
+    size_t numParentPositions = 1;
+    for (size_t i = 0; i < order; i++) {
+      size_t& numPositions = threadSizes.numPositions[i];
+      switch (dimTypes[i]) {
+        case Dense:
+          numPositions = (i == 0) ? denseBounds[t+1] - denseBounds[t]
+                                  : numParentPositions * dimensions[i];
+          break;
+        case Sparse:
+          threadSizes.numSegmentEnds[i] = (i == 0) ? 0 : numParentPositions;
+          break;
+        case Fixed:
+          if (i > 0) {
+            numPositions = numParentPositions * fixedSizes[i];
+          }
+          break;
       }
-      case Sparse: {
-        // Sparse indices have two arrays: a segment array and an index array
-        indices.push_back({{}, {}});
+      numParentPositions = numPositions;
+    }
+  }
 
-        // Add start of first segment
-        indices[i][0].push_back(0);
+  // Allocate exactly sized index arrays and values.  Each thread writes its
+  // part at the sizes packed by the threads before it.
+  const IndexArrayType positionType = format.getPositionType();
+  const size_t positionSize = getIndexArrayTypeSize(positionType);
+  Packer packer = {dimensions, dimTypes, fixedSizes, coordinates,
+                   values.data(), ctype, positionType, format.getIndexTypes(),
+                   vector<int*>(order, nullptr), vector<int*>(order, nullptr),
+                   vector<int*>(order, nullptr), nullptr, {}, {}, 0};
+  vector<Packer> packers(numThreads, packer);
+  size_t maxArraySize = numCoordinates;
+  size_t numParentPositions = 1;
+  for (size_t i = 0; i < order; i++) {
+    size_t posOffset = 1;
+    size_t idxOffset = 0;
+    for (int t = 0; t < numThreads; t++) {
+      packers[t].posCursor.push_back(posOffset);
+      packers[t].idxCursor.push_back(idxOffset);
+      posOffset += sizes[t].numSegmentEnds[i];
+      idxOffset += sizes[t].numPositions[i];
+    }
+    maxArraySize = max(maxArraySize, max(posOffset, idxOffset));
+
+    switch (dimTypes[i]) {
+      case Dense: {
+        storage.setDimensionIndex(i, {util::copyToArray({dimensions[i]})});
         break;
       }
+      case Sparse:
       case Fixed: {
-        // Fixed indices have two arrays: a segment array and an index array
-        indices.push_back({{}, {}});
-
-        // Add maximum size to segment array
-        size_t maxSize = findMaxFixedValue(dimensions, coordinates,
-                                           format.getOrder(), i, 0,
-                                           numCoordinates);
+        int* pos = nullptr;
+        if (dimTypes[i] == Fixed) {
+          pos = util::copyToArray({fixedSizes[i]});
+        }
+        else if (i == 0) {
+          pos = (int*)malloc(2 * positionSize);
+          storeIndex(pos, positionType, 0, 0);
+          storeIndex(pos, positionType, 1, idxOffset);
+        }
+        else {
+          pos = (int*)malloc(posOffset * positionSize);
+          storeIndex(pos, positionType, 0, 0);
+        }
+        int* idx = (int*)malloc(idxOffset * getIndexArrayTypeSize(
+            format.getLevels()[i].getIndexType()));
+        storage.setDimensionIndex(i, {pos, idx});
 
-        indices[i][0].push_back(maxSize);
+        // The packers only store the sizes of segments that are not empty
+        int* segmentSizes = nullptr;
+        if (dimTypes[i] == Fixed && i > 0) {
+          segmentSizes = (int*)calloc(max(numParentPositions, (size_t)1),
+                                      sizeof(int));
+          storage.setSegmentSizes(i, segmentSizes);
+        }
+        for (auto& threadPacker : packers) {
+          threadPacker.pos[i] = pos;
+          threadPacker.idx[i] = idx;
+          threadPacker.segmentSizes[i] = segmentSizes;
+        }
         break;
       }
     }
+    numParentPositions = idxOffset;
   }
+  vector<size_t> valOffsets(numThreads+1, 0);
+  for (int t = 0; t < numThreads; t++) {
+    packers[t].valCursor = valOffsets[t];
+    valOffsets[t+1] = valOffsets[t] + sizes[t].numPositions[order-1];
+  }
+  maxArraySize = max(maxArraySize, valOffsets[numThreads]);
+  const size_t numValues = valOffsets[numThreads];
+  void* vals = malloc(numValues * ctype.bytes());
+  storage.setValues((double*)vals);
 
-  std::vector<double> vals;
-  packTensor(dimensions, coordinates, (const double*)values.data(), 0,
-             numCoordinates, format.getDimensionTypes(), 0, &indices, &vals);
+  // Large tensors are packed by code generated for their format, if the
+  // cursors of the generated code can address them
+  shared_ptr<ir::Module> packModule;
+  if (maxArraySize <= INT_MAX && positionType == IndexArrayType::Int32) {
+    packModule = getPackModule(format, ctype, numCoordinates);
+  }
+  // The pack code only reads the index arrays and values
+  vector<vector<uint8_t*>> tensorIndex(order);
+  vector<uint8_t**> tensorIndices(order);
+  for (size_t i = 0; i < order; i++) {
+    for (int* array : storage.getDimensionIndex(i)) {
+      tensorIndex[i].push_back((uint8_t*)array);
+    }
+    tensorIndices[i] = tensorIndex[i].data();
+  }
+  taco_tensor_t tensorData = {(int32_t)order, nullptr, nullptr,
+                              (int32_t)ctype.bytes(), nullptr,
+                              tensorIndices.data(), (uint8_t*)vals};
 
-  // Copy packed data into tensor storage
-  for (size_t i=0; i < numDimensions; ++i) {
-    DimensionType dimensionType = format.getDimensionTypes()[i];
+  // Second pass: pack each thread's coordinates into the storage
+  util::parallelFor(numThreads, [&](int t) {
+    Packer& threadPacker = packers[t];
+    threadPacker.values = vals;
+    if (packModule != nullptr) {
+      vector<int> cursors = {(int)bounds[t], (int)bounds[t+1],
+                             denseBounds[t], denseBounds[t+1]};
+      for (size_t cursor : threadPacker.posCursor) {
+        cursors.push_back((int)cursor);
+      }
+      for (size_t cursor : threadPacker.idxCursor) {
+        cursors.push_back((int)cursor);
+      }
+      cursors.push_back((int)threadPacker.valCursor);
 
-    switch (dimensionType) {
-      case DimensionType::Dense: {
-        auto size = util::copyToArray({dimensions[i]});
-        storage.setDimensionIndex(i, {size});
-        break;
+      vector<void*> arguments = {&tensorData};
+      for (auto& levelCoords : coordinates) {
+        arguments.push_back((void*)levelCoords.data());
       }
-      case DimensionType::Sparse:
-      case DimensionType::Fixed: {
-        auto pos = util::copyToArray(indices[i][0]);
-        auto idx = util::copyToArray(indices[i][1]);
-        storage.setDimensionIndex(i, {pos,idx});
-        break;
+      arguments.push_back((void*)values.data());
+      arguments.push_back(cursors.data());
+      for (size_t i = 1; i < order; i++) {
+        if (dimTypes[i] == Fixed) {
+          arguments.push_back(threadPacker.segmentSizes[i]);
+        }
       }
+      packModule->callFuncPacked("pack", arguments);
+      return;
     }
-  }
-  storage.setValues(util::copyToArray(vals));
 
+    if (dimTypes[0] == Dense) {
+      threadPacker.packDense(bounds[t], bounds[t+1], 0, denseBounds[t],
+                             denseBounds[t+1]);
+    }
+    else {
+      threadPacker.pack(bounds[t], bounds[t+1], 0);
+    }
+    taco_iassert(threadPacker.valCursor == valOffsets[t+1]);
+  });
   return storage;
 }
 
-ir::Stmt packCode(const Format& format) {
-  using namespace taco::ir;
+namespace {
+/// Generates code that packs sorted coordinates, like Packer::pack.
+struct PackCodeGenerator {
+  // Not the index expressions that lower_codegen.h declares
+  typedef ir::Expr Expr;
 
-  vector<Stmt> packStmts;
+  PackCodeGenerator(const Format& format, ComponentType ctype)
+      : dimTypes(format.getDimensionTypes()) {
+    using namespace ir;
+    tensor = Var::make("A", lower::getIRType(ctype), format);
+    for (size_t i = 0; i < dimTypes.size(); i++) {
+      crds.push_back(Var::make("crd" + to_string(i), Type(Type::Int), true));
+    }
+    vals = Var::make("vals", Type(Type::Float,64), true);
+    cursors = Var::make("cursors", Type(Type::Int), true);
+    for (size_t i = 0; i < dimTypes.size(); i++) {
+      segmentSizes.push_back((i > 0 && dimTypes[i] == Fixed)
+                             ? Var::make("sizes" + to_string(i),
+                                         Type(Type::Int), true)
+                             : ir::Expr());
+    }
+  }
+
+  const vector<DimensionType>& dimTypes;
+
+  ir::Expr tensor;
+  vector<ir::Expr> crds;
+  ir::Expr vals;
+  ir::Expr cursors;
+  vector<ir::Expr> segmentSizes;
+
+  ir::Expr denseFirst;
+  ir::Expr denseLast;
+  vector<ir::Expr> posCursors;
+  vector<ir::Expr> idxCursors;
+  ir::Expr valCursor;
+
+  ir::Stmt increment(ir::Expr var) {
+    return ir::VarAssign::make(var, ir::Add::make(var, 1));
+  }
 
-  // Generate loops to count the size of each level.
-//  ir::Stmt countLoops;
-//  for (auto& level : util::reverse(format.getLevels())) {
-//    if (countLoops.defined()) {
-//
-//    }
-//  }
+  /// Scan `cend` past the coordinates that have the level i coordinate `j`.
+  ir::Stmt scanSegment(ir::Expr cend, ir::Expr end, ir::Expr j, size_t i) {
+    using namespace ir;
+    return While::make(And::make(Lt::make(cend, end),
+                                 Eq::make(Load::make(crds[i], cend), j)),
+                       increment(cend));
+  }
 
-  // Loops to insert index values
-  Stmt insertLoop;
-  for (DimensionType dimType : util::reverse(format.getDimensionTypes())) {
-    Stmt body = insertLoop.defined()
-        ? insertLoop
-        : VarAssign::make(Var::make("test", Type::Int), 1.0, true);
+  /// Pack the coordinates [begin,end), which share their first i coordinates.
+  ir::Stmt pack(ir::Expr begin, ir::Expr end, size_t i) {
+    using namespace ir;
+    if (i == dimTypes.size()) {
+      Expr outVals = GetProperty::make(tensor, TensorProperty::Values);
+      return Block::make({
+        IfThenElse::make(Lt::make(begin, end),
+                         Store::make(outVals, valCursor,
+                                     Load::make(vals, begin)),
+                         Store::make(outVals, valCursor, Literal::make(0.0))),
+        increment(valCursor)
+      });
+    }
 
-    switch (dimType) {
+    string level = to_string(i);
+    Expr j      = Var::make("j" + level, Type(Type::Int));
+    Expr cbegin = Var::make("begin" + to_string(i+1), Type(Type::Int));
+    Expr cend   = Var::make("end" + to_string(i+1), Type(Type::Int));
+    vector<Stmt> stmts;
+    stmts.push_back(VarAssign::make(cbegin, begin, true));
+    switch (dimTypes[i]) {
       case Dense: {
-        Expr dimSize = 10;
-        Expr loopVar = Var::make("i", Type::Int);
-        insertLoop = ir::For::make(loopVar, 0, dimSize, 1, body);
+        Expr first = (i == 0) ? denseFirst : 0;
+        Expr last  = (i == 0) ? denseLast
+                              : GetProperty::make(tensor,
+                                                  TensorProperty::Pointer, i);
+        stmts.push_back(For::make(j, first, last, 1, Block::make({
+          VarAssign::make(cend, cbegin, true),
+          scanSegment(cend, end, j, i),
+          pack(cbegin, cend, i+1),
+          VarAssign::make(cbegin, cend)
+        })));
         break;
       }
       case Sparse: {
+        Expr idx = GetProperty::make(tensor, TensorProperty::Index, i);
+        stmts.push_back(While::make(Lt::make(cbegin, end), Block::make({
+          VarAssign::make(j, Load::make(crds[i], cbegin), true),
+          VarAssign::make(cend, Add::make(cbegin, 1), true),
+          scanSegment(cend, end, j, i),
+          Store::make(idx, idxCursors[i], j),
+          increment(idxCursors[i]),
+          pack(cbegin, cend, i+1),
+          VarAssign::make(cbegin, cend)
+        })));
+        // The segment end of level 0 is stored after all threads are done
+        if (i > 0) {
+          Expr pos = GetProperty::make(tensor, TensorProperty::Pointer, i);
+          stmts.push_back(Store::make(pos, posCursors[i], idxCursors[i]));
+          stmts.push_back(increment(posCursors[i]));
+        }
         break;
       }
       case Fixed: {
-        taco_not_supported_yet;
+        Expr idx = GetProperty::make(tensor, TensorProperty::Index, i);
+        Expr segmentSize = Var::make("n" + level, Type(Type::Int));
+        stmts.push_back(VarAssign::make(segmentSize, 0, true));
+        stmts.push_back(While::make(Lt::make(cbegin, end), Block::make({
+          VarAssign::make(j, Load::make(crds[i], cbegin), true),
+          VarAssign::make(cend, Add::make(cbegin, 1), true),
+          scanSegment(cend, end, j, i),
+          Store::make(idx, idxCursors[i], j),
+          increment(idxCursors[i]),
+          pack(cbegin, cend, i+1),
+          VarAssign::make(cbegin, cend),
+          increment(segmentSize)
+        })));
+        // Complete the segment with the last index value.  Level 0 is a
+        // single segment that holds every level 0 coordinate.
+        if (i > 0) {
+          Expr size = GetProperty::make(tensor, TensorProperty::Pointer, i);
+          Expr last = Var::make("last" + level, Type(Type::Int));
+          Expr k    = Var::make("k" + level, Type(Type::Int));
+          Expr segment = Div::make(Sub::make(idxCursors[i], segmentSize),
+                                   size);
+          stmts.push_back(IfThenElse::make(Gt::make(segmentSize, 0),
+              Store::make(segmentSizes[i], segment, segmentSize)));
+          stmts.push_back(VarAssign::make(last, 0, true));
+          stmts.push_back(IfThenElse::make(Lt::make(begin, end),
+              VarAssign::make(last, Load::make(crds[i], Sub::make(end, 1)))));
+          stmts.push_back(For::make(k, segmentSize, size, 1, Block::make({
+            Store::make(idx, idxCursors[i], last),
+            increment(idxCursors[i]),
+            pack(end, end, i+1)
+          })));
+        }
         break;
       }
     }
+    return Block::make(stmts);
+  }
+
+  ir::Stmt generate() {
+    using namespace ir;
+    const size_t order = dimTypes.size();
+
+    // Unpack the thread's coordinate range, its dense level 0 segments, and
+    // where it starts writing each index array and the values
+    vector<Stmt> body;
+    auto unpack = [&](string name, int cursor) {
+      Expr var = Var::make(name, Type(Type::Int));
+      body.push_back(VarAssign::make(var, Load::make(cursors, cursor), true));
+      return var;
+    };
+    Expr begin = unpack("begin0", 0);
+    Expr end   = unpack("end0", 1);
+    denseFirst = unpack("denseFirst", 2);
+    denseLast  = unpack("denseLast", 3);
+    for (size_t i = 0; i < order; i++) {
+      posCursors.push_back(unpack("pA" + to_string(i), 4 + i));
+      idxCursors.push_back(unpack("iA" + to_string(i), 4 + order + i));
+    }
+    valCursor = unpack("vA", 4 + 2*order);
+
+    body.push_back(pack(begin, end, 0));
+
+    // The tensor is an input, since its arrays are written but not replaced
+    vector<Expr> inputs = {tensor};
+    inputs.insert(inputs.end(), crds.begin(), crds.end());
+    inputs.push_back(vals);
+    inputs.push_back(cursors);
+    for (auto& sizes : segmentSizes) {
+      if (sizes.defined()) {
+        inputs.push_back(sizes);
+      }
+    }
+    return Function::make("pack", inputs, {}, Scope::make(Block::make(body)));
+  }
+};
+}
+
+ir::Stmt packCode(const Format& format, ComponentType ctype) {
+  return PackCodeGenerator(format, ctype).generate();
+}
+
+
+// class SortedPacker
+namespace {
+/// A malloc'd array that grows by half its size as elements are appended, and
+/// that can be handed over without a copy.
+template <typename T>
+class GrowableArray {
+public:
+  GrowableArray() : data(nullptr), size(0), capacity(0) {}
+  ~GrowableArray() {
+    free(data);
+  }
+
+  void append(size_t count, T value) {
+    if (size + count > capacity) {
+      capacity = max(size + count, capacity + capacity/2 + 16);
+      data = (T*)realloc(data, capacity * sizeof(T));
+      taco_uassert(data != nullptr) << "Out of memory";
+    }
+    std::fill(data + size, data + size + count, value);
+    size += count;
+  }
+
+  void push_back(T value) {
+    if (size == capacity) {
+      append(1, value);
+    }
+    else {
+      data[size++] = value;
+    }
+  }
+
+  size_t getSize() const {
+    return size;
+  }
+
+  /// Returns the array, shrunk to its size, and leaves this array empty.
+  T* release() {
+    T* array = (T*)realloc(data, max(size, (size_t)1) * sizeof(T));
+    data = nullptr;
+    size = capacity = 0;
+    return array;
+  }
+
+private:
+  T*     data;
+  size_t size;
+  size_t capacity;
+};
+}
+
+struct SortedPacker::Content {
+  size_t                     order;
+  vector<DimensionType>      types;
+  vector<int>                levelDimensions;  // tensor dimension of each level
+  vector<int>                sizes;            // dimension size of each level
+
+  vector<GrowableArray<int>> pos;
+  vector<GrowableArray<int>> idx;
+  GrowableArray<double>      values;
+
+  bool                       empty;
+  vector<int>                previous;         // in level order
+  vector<int>                current;
+
+  /// Append `count` empty subtrees rooted at level i.
+  void appendEmpty(size_t i, size_t count) {
+    if (i == order) {
+      values.append(count, 0.0);
+    }
+    else if (types[i] == Dense) {
+      appendEmpty(i+1, count * sizes[i]);
+    }
+    else {
+      pos[i].append(count, (int)idx[i].getSize());
+    }
+  }
+
+  /// Close the segment of level i that holds the previous coordinate.
+  void close(size_t i) {
+    if (types[i] == Dense) {
+      appendEmpty(i+1, sizes[i] - previous[i] - 1);
+    }
+    else {
+      pos[i].push_back((int)idx[i].getSize());
+    }
+  }
+
+  /// Move level i from coordinate `from` to coordinate `to` of its segment.
+  void advance(size_t i, int from, int to) {
+    if (types[i] == Dense) {
+      appendEmpty(i+1, to - from - 1);
+    }
+    else {
+      idx[i].push_back(to);
+    }
+  }
+};
+
+bool SortedPacker::canPack(const Format& format,
+                           const vector<int>& dimensionSizes) {
+  if (format.getOrder() == 0 ||
+      format.getPositionType() != IndexArrayType::Int32) {
+    return false;
+  }
+  auto& levels = format.getLevels();
+  for (size_t i = 0; i < levels.size(); i++) {
+    if (levels[i].getType() == Fixed ||
+        levels[i].getIndexType() != IndexArrayType::Int32 ||
+        (levels[i].getType() == Dense && i > 0 &&
+         dimensionSizes[levels[i].getDimension()] <= 0)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+SortedPacker::SortedPacker(const Format& format,
+                           const vector<int>& dimensionSizes)
+    : content(new Content) {
+  taco_uassert(canPack(format, dimensionSizes)) <<
+      "Cannot pack sorted coordinates into " << format;
+  content->order = format.getOrder();
+  for (auto& level : format.getLevels()) {
+    content->types.push_back(level.getType());
+    content->levelDimensions.push_back(level.getDimension());
+    content->sizes.push_back(dimensionSizes[level.getDimension()]);
+  }
+  content->pos.resize(content->order);
+  content->idx.resize(content->order);
+  for (size_t i = 0; i < content->order; i++) {
+    if (content->types[i] == Sparse) {
+      content->pos[i].push_back(0);
+    }
+  }
+  content->empty = true;
+  content->previous.resize(content->order);
+  content->current.resize(content->order);
+}
+
+SortedPacker::~SortedPacker() {
+}
+
+bool SortedPacker::insert(const int* coordinate, double value) {
+  const size_t order = content->order;
+  auto& current = content->current;
+  auto& previous = content->previous;
+  for (size_t i = 0; i < order; i++) {
+    current[i] = coordinate[content->levelDimensions[i]];
+    if (current[i] < 0 ||
+        (content->sizes[i] > 0 && current[i] >= content->sizes[i])) {
+      return false;
+    }
   }
-  packStmts.push_back(insertLoop);
 
-  return ir::Block::make(packStmts);
+  // Find the first level where the coordinate differs from the previous one,
+  // and close the segments below it
+  size_t level = 0;
+  int from = -1;
+  if (!content->empty) {
+    while (level < order && current[level] == previous[level]) {
+      level++;
+    }
+    if (level == order || current[level] < previous[level]) {
+      return false;
+    }
+    for (size_t i = order-1; i > level; i--) {
+      content->close(i);
+    }
+    from = previous[level];
+  }
+
+  // Advance within the segment of the first differing level, and start new
+  // segments below it
+  content->advance(level, from, current[level]);
+  for (size_t i = level+1; i < order; i++) {
+    content->advance(i, -1, current[i]);
+  }
+  content->values.push_back(value);
+
+  std::swap(previous, current);
+  content->empty = false;
+  return true;
+}
+
+void SortedPacker::finish(const vector<int>& dimensionSizes,
+                          vector<vector<int*>>* indices, double** values) {
+  const size_t order = content->order;
+  for (size_t i = 0; i < order; i++) {
+    content->sizes[i] = dimensionSizes[content->levelDimensions[i]];
+  }
+  taco_uassert(content->empty || content->types[0] != Dense ||
+               content->previous[0] < content->sizes[0]) <<
+      "Coordinate " << content->previous[0] << " is out of bounds";
+
+  if (content->empty) {
+    content->previous[0] = -1;
+    content->close(0);
+  }
+  else {
+    for (size_t i = order; i > 0; i--) {
+      content->close(i-1);
+    }
+  }
+
+  indices->clear();
+  indices->resize(order);
+  for (size_t i = 0; i < order; i++) {
+    if (content->types[i] == Sparse) {
+      (*indices)[i].push_back(content->pos[i].release());
+      (*indices)[i].push_back(content->idx[i].release());
+    }
+  }
+  *values = content->values.release();
 }
 
 }}
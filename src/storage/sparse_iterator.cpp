@@ -15,7 +15,7 @@ SparseIterator::SparseIterator(std::string name, const Expr& tensor, int level,
 
   std::string idxVarName = name + util::toString(tensor);
   ptrVar = Var::make(util::toString(tensor) + std::to_string(level+1)+"_pos",
-                     Type(Type::Int));
+                     getPositionType(tensor));
   idxVar = Var::make(idxVarName, Type(Type::Int));
 }
 
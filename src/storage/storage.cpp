@@ -15,27 +15,47 @@ namespace storage {
 // class Storage
 struct Storage::Content {
   Format               format;
+  ComponentType        ctype;
 
-  vector<vector<int*>> indices;
-  double*              values;
+  vector<vector<int*>>    indices;
+  vector<int*>            segmentSizes;  // of fixed dimensions, or nullptr
+  double*                 values;
+
+  // Releases the arrays above; a null deleter means the array is freed
+  vector<vector<Deleter>> indexDeleters;
+  Deleter                 valuesDeleter;
 
   ~Content() {
-    for (auto& index : indices) {
-      for (auto& indexArray : index) {
-        free(indexArray);
+    for (size_t i = 0; i < indices.size(); i++) {
+      for (size_t j = 0; j < indices[i].size(); j++) {
+        release(indices[i][j], indexDeleters[i][j]);
       }
+      free(segmentSizes[i]);
+    }
+    release(values, valuesDeleter);
+  }
+
+  static void release(void* array, const Deleter& deleter) {
+    if (deleter) {
+      deleter(array);
+    }
+    else {
+      free(array);
     }
-    free(values);
   }
 };
 
 Storage::Storage() : content(nullptr) {
 }
 
-Storage::Storage(const Format& format) : content(new Content) {
+Storage::Storage(const Format& format, ComponentType ctype)
+    : content(new Content) {
   content->format = format;
+  content->ctype = ctype;
   auto dimTypes = format.getDimensionTypes();
   content->indices.resize(dimTypes.size());
+  content->indexDeleters.resize(dimTypes.size());
+  content->segmentSizes.resize(dimTypes.size(), nullptr);
   for (size_t i = 0; i < content->indices.size(); i++) {
     switch (dimTypes[i]) {
       case DimensionType::Dense:
@@ -49,12 +69,20 @@ Storage::Storage(const Format& format) : content(new Content) {
     for (size_t j = 0; j < content->indices[i].size(); j++) {
       content->indices[i][j] = nullptr;
     }
+    content->indexDeleters[i].resize(content->indices[i].size());
   }
 
   content->values = nullptr;
 }
 
 void Storage::setDimensionIndex(size_t dimension, std::vector<int*> index) {
+  setDimensionIndex(dimension, index, vector<Deleter>(index.size()));
+}
+
+void Storage::setDimensionIndex(size_t dimension, std::vector<int*> index,
+                                std::vector<Deleter> deleters) {
+  taco_iassert(deleters.size() == index.size()) <<
+      "Expected one deleter per index array";
   taco_iassert(index.size() == content->indices[dimension].size()) <<
       "Setting the wrong number of indices (" <<
       index.size() << " != " << content->indices[dimension].size() << "). " <<
@@ -63,17 +91,36 @@ void Storage::setDimensionIndex(size_t dimension, std::vector<int*> index) {
 
   for (size_t i = 0; i < content->indices[dimension].size(); i++) {
     content->indices[dimension][i] = index[i];
+    content->indexDeleters[dimension][i] = deleters[i];
   }
+  setSegmentSizes(dimension, nullptr);
+}
+
+void Storage::setSegmentSizes(size_t dimension, int* sizes) {
+  taco_iassert(sizes == nullptr ||
+               content->format.getDimensionTypes()[dimension] ==
+               DimensionType::Fixed) << "Only fixed dimensions are padded";
+  free(content->segmentSizes[dimension]);
+  content->segmentSizes[dimension] = sizes;
 }
 
 void Storage::setValues(double* values) {
+  setValues(values, Deleter());
+}
+
+void Storage::setValues(double* values, Deleter deleter) {
   content->values = values;
+  content->valuesDeleter = deleter;
 }
 
 const Format& Storage::getFormat() const {
   return content->format;
 }
 
+ComponentType Storage::getComponentType() const {
+  return content->ctype;
+}
+
 const vector<int*>& Storage::getDimensionIndex(size_t dimension) const {
   return content->indices[dimension];
 }
@@ -82,35 +129,52 @@ const double* Storage::getValues() const {
   return content->values;
 }
 
+const int* Storage::getSegmentSizes(size_t dimension) const {
+  return content->segmentSizes[dimension];
+}
+
 double* Storage::getValues() {
   return content->values;
 }
 
 Storage::Size Storage::getSize() const {
   vector<vector<size_t>> numIndexVals(content->indices.size());
+  vector<vector<size_t>> numBytesPerIndexVal(content->indices.size());
+  const IndexArrayType positionType = content->format.getPositionType();
+  const size_t positionSize = getIndexArrayTypeSize(positionType);
 
   size_t numVals = 1;
   for (size_t i=0; i < content->indices.size(); ++i) {
     auto& index = content->indices[i];
+    const size_t indexSize =
+        getIndexArrayTypeSize(content->format.getLevels()[i].getIndexType());
     switch (content->format.getDimensionTypes()[i]) {
       case DimensionType::Dense:
         numIndexVals[i].push_back(1);                  // size
+        numBytesPerIndexVal[i].push_back(sizeof(int));
         numVals *= index[0][0];
         break;
-      case DimensionType::Sparse:
+      case DimensionType::Sparse: {
+        size_t numPositions = loadIndex(index[0], positionType, numVals);
         numIndexVals[i].push_back(numVals + 1);        // pos
-        numIndexVals[i].push_back(index[0][numVals]);  // idx
-        numVals = index[0][numVals];
+        numIndexVals[i].push_back(numPositions);       // idx
+        numBytesPerIndexVal[i].push_back(positionSize);
+        numBytesPerIndexVal[i].push_back(indexSize);
+        numVals = numPositions;
         break;
+      }
       case DimensionType::Fixed:
         numVals *= index[0][0];
         numIndexVals[i].push_back(1);                  // pos
         numIndexVals[i].push_back(numVals);            // idx
+        numBytesPerIndexVal[i].push_back(sizeof(int));
+        numBytesPerIndexVal[i].push_back(indexSize);
         break;
     }
   }
 
-  return Storage::Size(numVals, numIndexVals);
+  return Storage::Size(numVals, numIndexVals, numBytesPerIndexVal,
+                       content->ctype.bytes());
 }
 
 std::ostream& operator<<(std::ostream& os, const Storage& storage) {
@@ -132,10 +196,17 @@ std::ostream& operator<<(std::ostream& os, const Storage& storage) {
       case DimensionType::Sparse: {
         auto pos = storage.getDimensionIndex(i)[0];
         auto idx = storage.getDimensionIndex(i)[1];
-        os << "  pos: "
-           << "[" + util::join(pos, pos+size.numIndexValues(i,0)) + "]" << endl;
-        os << "  idx: "
-           << "[" + util::join(idx, idx+size.numIndexValues(i,1)) + "]" << endl;
+        vector<size_t> positions;
+        for (size_t j = 0; j < size.numIndexValues(i,0); j++) {
+          positions.push_back(loadIndex(pos, format.getPositionType(), j));
+        }
+        auto indexType = format.getLevels()[i].getIndexType();
+        vector<size_t> coordinates;
+        for (size_t j = 0; j < size.numIndexValues(i,1); j++) {
+          coordinates.push_back(loadIndex(idx, indexType, j));
+        }
+        os << "  pos: " << "[" + util::join(positions) + "]" << endl;
+        os << "  idx: " << "[" + util::join(coordinates) + "]" << endl;
         break;
       }
       case DimensionType::Fixed:
@@ -144,11 +215,12 @@ std::ostream& operator<<(std::ostream& os, const Storage& storage) {
   }
 
   // Print values
-  auto values = storage.getValues();
-  os << "values: " << endl
-     << (values != nullptr
-         ? "  [" + util::join(values, values + size.numValues()) + "]"
-         : "none");
+  vector<double> values;
+  for (size_t i = 0; i < size.numValues(); i++) {
+    values.push_back(loadValue(storage.getValues(),
+                               storage.getComponentType(), i));
+  }
+  os << "values: " << endl << "  [" + util::join(values) + "]";
 
   return os;
 }
@@ -168,7 +240,7 @@ Storage::Size::numIndexValues(size_t dimension, size_t indexNumber) const {
 }
 
 size_t Storage::Size::numBytes() const {
-  int cost = numValues() * numBytesPerValue();
+  size_t cost = numValues() * numBytesPerValue();
   for (size_t i=0; i < numIndexVals.size(); ++i) {
     for (size_t j = 0; j < numIndexVals[i].size(); j++) {
       cost += numIndexValues(i,j) * numBytesPerIndexValue(i,j);
@@ -177,14 +249,19 @@ size_t Storage::Size::numBytes() const {
   return cost;
 }
 size_t Storage::Size::numBytesPerValue() const {
-  return sizeof(double);
+  return numBytesPerVal;
 }
 
 size_t Storage::Size::numBytesPerIndexValue(size_t dim, size_t n) const {
-  return sizeof(int);
+  taco_iassert(dim < numBytesPerIndexVal.size());
+  taco_iassert(n < numBytesPerIndexVal[dim].size());
+  return numBytesPerIndexVal[dim][n];
 }
 
-Storage::Size::Size(size_t numVals, vector<vector<size_t>> numIndexVals)
- : numVals(numVals), numIndexVals(numIndexVals) {}
+Storage::Size::Size(size_t numVals, vector<vector<size_t>> numIndexVals,
+                    vector<vector<size_t>> numBytesPerIndexVal,
+                    size_t numBytesPerVal)
+ : numVals(numVals), numIndexVals(numIndexVals),
+   numBytesPerIndexVal(numBytesPerIndexVal), numBytesPerVal(numBytesPerVal) {}
 
 }}
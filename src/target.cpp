@@ -3,6 +3,7 @@
 #include <vector>
 
 #include "taco/target.h"
+#include "taco/util/env.h"
 
 using namespace std;
 
@@ -16,6 +17,12 @@ map<string, Target::OS> osMap = {{"unknown", Target::OSUnknown},
                                   {"linux", Target::Linux},
                                   {"macos", Target::MacOS},
                                   {"windows", Target::Windows}};
+
+map<string, Target::Parallelism> parallelismMap = {{"serial", Target::Serial},
+                                                   {"openmp", Target::OpenMP}};
+
+map<string, Target::VectorISA> isaMap = {{"avx2",   Target::AVX2},
+                                         {"avx512", Target::AVX512}};
   
 bool parseTargetString(Target& target, string target_string) {
   string rest = target_string;
@@ -25,7 +32,9 @@ bool parseTargetString(Target& target, string target_string) {
   while (current_pos != string::npos) {
     tokens.push_back(rest.substr(0, current_pos));
     rest = rest.substr(current_pos+1);
+    current_pos = rest.find('-');
   }
+  tokens.push_back(rest);
   
   // now parse the tokens
   taco_uassert(tokens.size() >= 2) <<
@@ -42,6 +51,26 @@ bool parseTargetString(Target& target, string target_string) {
     return false;
   }
   target.os = osMap[tokens[1]];
+
+  // the optional features are the parallelism model and the vector
+  // instruction set, each of which may be given once
+  target.parallelism = Target::getDefaultParallelism();
+  target.isa = Target::Generic;
+  bool hasParallelism = false;
+  bool hasISA = false;
+  for (size_t i = 2; i < tokens.size(); i++) {
+    if (parallelismMap.count(tokens[i]) && !hasParallelism) {
+      target.parallelism = parallelismMap[tokens[i]];
+      hasParallelism = true;
+    }
+    else if (isaMap.count(tokens[i]) && !hasISA) {
+      target.isa = isaMap[tokens[i]];
+      hasISA = true;
+    }
+    else {
+      return false;
+    }
+  }
   
   return true;
 }
@@ -49,10 +78,29 @@ bool parseTargetString(Target& target, string target_string) {
 } // anonymous namespace
 
 Target::Target(const std::string &s) {
-  parseTargetString(*this, s);
+  taco_uassert(parseTargetString(*this, s)) << "Invalid target string: " << s;
+  taco_uassert(os != Windows && os != OSUnknown) << "Unsupported target: " << s;
 }
 
+Target::Target(Arch a, OS o)
+    : Target(a, o, getDefaultParallelism()) {
+}
 
+Target::Parallelism Target::getDefaultParallelism() {
+  if (util::getFromEnv("TACO_OPENMP_FLAGS", "") != "") {
+    return OpenMP;
+  }
+  return Serial;
+}
+
+int Target::getVectorBytes() const {
+  switch (isa) {
+    case Generic: return 0;
+    case AVX2:    return 32;
+    case AVX512:  return 64;
+  }
+  return 0;
+}
 
 bool Target::validateTargetString(const string &s) {
   string::size_type arch_end = string::npos;
@@ -76,6 +124,14 @@ bool Target::validateTargetString(const string &s) {
 }
 
 Target getTargetFromEnvironment() {
+  string target = util::getFromEnv("TACO_TARGET", "");
+  if (target != "") {
+    return Target(target);
+  }
+#ifdef __APPLE__
   return Target(Target::Arch::C99, Target::OS::MacOS);
+#else
+  return Target(Target::Arch::C99, Target::OS::Linux);
+#endif
 }
 } // namespace taco
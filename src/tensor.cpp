@@ -17,13 +17,18 @@
 #include "lower/lower.h"
 #include "lower/iteration_schedule.h"
 #include "backends/module.h"
+#include "backends/module_cache.h"
 #include "taco_tensor_t.h"
 #include "taco/io/tns_file_format.h"
 #include "taco/io/mtx_file_format.h"
 #include "taco/io/rb_file_format.h"
+#include "taco/io/tbin_file_format.h"
+#include "io/gzip_stream.h"
 #include "taco/util/strings.h"
 #include "taco/util/timers.h"
 #include "taco/util/name_generator.h"
+#include "taco/util/parallel.h"
+#include "taco/util/thread_pool.h"
 
 using namespace std;
 using namespace taco::ir;
@@ -32,56 +37,6 @@ using namespace taco::expr_nodes;
 
 namespace taco {
 
-// class ComponentType
-size_t ComponentType::bytes() const {
-  switch (this->kind) {
-    case Bool:
-      return sizeof(bool);
-    case Int:
-      return sizeof(int);
-    case Float:
-      return sizeof(float);
-    case Double:
-      return sizeof(double);
-    case Unknown:
-      break;
-  }
-  return UINT_MAX;
-}
-
-ComponentType::Kind ComponentType::getKind() const {
-  return kind;
-}
-
-bool operator==(const ComponentType& a, const ComponentType& b) {
-  return a.getKind() == b.getKind();
-}
-
-bool operator!=(const ComponentType& a, const ComponentType& b) {
-  return a.getKind() != b.getKind();
-}
-
-std::ostream& operator<<(std::ostream& os, const ComponentType& type) {
-  switch (type.getKind()) {
-    case ComponentType::Bool:
-      os << "bool";
-      break;
-    case ComponentType::Int:
-      os << "int";
-      break;
-    case ComponentType::Float:
-      os << "float";
-      break;
-    case ComponentType::Double:
-      os << "double";
-      break;
-    case ComponentType::Unknown:
-      break;
-  }
-  return os;
-}
-
-
 static const size_t DEFAULT_ALLOC_SIZE = (1 << 20);
 
 struct TensorBase::Content {
@@ -97,11 +52,16 @@ struct TensorBase::Content {
 
   size_t                   allocSize;
   size_t                   valuesSize;
+  ComponentType            accumulatorType;
+  Target                   target = getTargetFromEnvironment();
+  int                      numThreads = 0;
+  ParallelSchedule         parallelSchedule = ParallelSchedule::Rows;
 
   lower::IterationSchedule schedule;
   Stmt                     assembleFunc;
   Stmt                     computeFunc;
   shared_ptr<Module>       module;
+  shared_future<void>      pendingCompile;
 };
 
 TensorBase::TensorBase() : TensorBase(ComponentType::Double) {
@@ -132,24 +92,19 @@ TensorBase::TensorBase(string name, ComponentType ctype, vector<int> dimensions,
       "The number of format levels (" << format.getOrder() << ") " <<
       "must match the tensor order (" << dimensions.size() << "), " <<
       "or there must be a single level.";
-  taco_uassert(ctype == ComponentType::Double) <<
-      "Only double tensors currently supported";
+  taco_uassert(ctype != ComponentType::Unknown) <<
+      "Tensors must have a known component type";
 
   if (dimensions.size() == 0) {
     format = Format();
   }
   else if (dimensions.size() > 1 && format.getOrder() == 1) {
-    DimensionType levelType = format.getLevels()[0].getType();
-    vector<DimensionType> levelTypes;
-    for (size_t i = 0; i < dimensions.size(); i++) {
-      levelTypes.push_back(levelType);
-    }
-    format = Format(levelTypes);
+    format = getExpandedFormat(format, dimensions.size());
   }
 
   content->name = name;
   content->dimensions = dimensions;
-  content->storage = Storage(format);
+  content->storage = Storage(format, ctype);
   content->ctype = ctype;
   this->setAllocSize(DEFAULT_ALLOC_SIZE);
 
@@ -167,7 +122,8 @@ TensorBase::TensorBase(string name, ComponentType ctype, vector<int> dimensions,
 
   this->coordinateBuffer = shared_ptr<vector<char>>(new vector<char>);
   this->coordinateBufferUsed = 0;
-  this->coordinateSize = getOrder()*sizeof(int) + ctype.bytes();
+  // Inserted values are buffered as doubles, which hold every component type
+  this->coordinateSize = getOrder()*sizeof(int) + sizeof(double);
 }
 
 void TensorBase::setName(std::string name) const {
@@ -199,9 +155,6 @@ void TensorBase::reserve(size_t numCoordinates) {
 void TensorBase::insert(const initializer_list<int>& coordinate, double value) {
   taco_uassert(coordinate.size() == getOrder()) <<
       "Wrong number of indices";
-  taco_uassert(getComponentType() == ComponentType::Double) <<
-      "Cannot insert a value of type '" << ComponentType::Double << "' " <<
-      "into a tensor with component type " << getComponentType();
   if ((coordinateBuffer->size() - coordinateBufferUsed) < coordinateSize) {
     coordinateBuffer->resize(coordinateBuffer->size() + coordinateSize);
   }
@@ -217,9 +170,6 @@ void TensorBase::insert(const initializer_list<int>& coordinate, double value) {
 void TensorBase::insert(const std::vector<int>& coordinate, double value) {
   taco_uassert(coordinate.size() == getOrder()) <<
       "Wrong number of indices";
-  taco_uassert(getComponentType() == ComponentType::Double) <<
-      "Cannot insert a value of type '" << ComponentType::Double << "' " <<
-      "into a tensor with component type " << getComponentType();
   if ((coordinateBuffer->size() - coordinateBufferUsed) < coordinateSize) {
     coordinateBuffer->resize(coordinateBuffer->size() + coordinateSize);
   }
@@ -232,6 +182,51 @@ void TensorBase::insert(const std::vector<int>& coordinate, double value) {
   coordinateBufferUsed += coordinateSize;
 }
 
+void TensorBase::insertBulk(const vector<vector<int>>& coordinates,
+                            const vector<double>& values) {
+  vector<const int*> coordinateArrays;
+  for (auto& modeCoordinates : coordinates) {
+    taco_uassert(modeCoordinates.size() == values.size()) <<
+        "Expected " << values.size() << " coordinates per dimension, " <<
+        "but got " << modeCoordinates.size();
+    coordinateArrays.push_back(modeCoordinates.data());
+  }
+  insertBulk(coordinateArrays, values.data(), values.size());
+}
+
+void TensorBase::insertBulk(const vector<const int*>& coordinates,
+                            const double* values, size_t numCoordinates) {
+  taco_uassert(coordinates.size() == getOrder()) <<
+      "Wrong number of indices";
+  const size_t size = numCoordinates * coordinateSize;
+  if ((coordinateBuffer->size() - coordinateBufferUsed) < size) {
+    coordinateBuffer->resize(coordinateBufferUsed + size);
+  }
+
+  // Scatter one array at a time into the strided coordinate records, so that
+  // each copy loop reads a single contiguous array
+  char* buffer = &coordinateBuffer->data()[coordinateBufferUsed];
+  const size_t recordSize = coordinateSize;
+  const size_t order = coordinates.size();
+  const int numThreads = util::getNumThreads(numCoordinates, 1 << 16);
+  util::parallelFor(numThreads, [&](int thread) {
+    size_t begin = util::partition(numCoordinates, thread, numThreads);
+    size_t end   = util::partition(numCoordinates, thread+1, numThreads);
+    for (size_t i = 0; i < order; i++) {
+      const int* modeCoordinates = coordinates[i];
+      char* dst = buffer + i*sizeof(int);
+      for (size_t j = begin; j < end; j++) {
+        memcpy(dst + j*recordSize, &modeCoordinates[j], sizeof(int));
+      }
+    }
+    char* dst = buffer + order*sizeof(int);
+    for (size_t j = begin; j < end; j++) {
+      memcpy(dst + j*recordSize, &values[j], sizeof(double));
+    }
+  });
+  coordinateBufferUsed += size;
+}
+
 const ComponentType& TensorBase::getComponentType() const {
   return content->ctype;
 }
@@ -262,17 +257,94 @@ size_t TensorBase::getAllocSize() const {
   return content->allocSize;
 }
 
-void TensorBase::setCSR(double* vals, int* rowPtr, int* colIdx) {
+void TensorBase::setAccumulatorType(ComponentType ctype) const {
+  taco_uassert(ctype != ComponentType::Unknown) <<
+      "The accumulator type must be a known component type";
+  content->accumulatorType = ctype;
+}
+
+ComponentType TensorBase::getAccumulatorType() const {
+  return (content->accumulatorType != ComponentType::Unknown)
+         ? content->accumulatorType : getComponentType();
+}
+
+void TensorBase::setTarget(const Target& target) const {
+  content->target = target;
+}
+
+Target TensorBase::getTarget() const {
+  return content->target;
+}
+
+void TensorBase::setNumThreads(int numThreads) const {
+  taco_uassert(numThreads >= 0) << "The number of threads must not be negative";
+  content->numThreads = numThreads;
+}
+
+int TensorBase::getNumThreads() const {
+  return (content->numThreads > 0) ? content->numThreads
+                                   : util::getNumThreads();
+}
+
+void TensorBase::setParallelSchedule(ParallelSchedule schedule) const {
+  content->parallelSchedule = schedule;
+}
+
+ParallelSchedule TensorBase::getParallelSchedule() const {
+  return content->parallelSchedule;
+}
+
+void TensorBase::adoptStorage(const vector<vector<int*>>& indices,
+                              double* vals, Storage::Deleter deleter) {
+  // Assembly reallocates the index arrays of results, which it must not do to
+  // memory owned elsewhere
+  taco_uassert(!getExpr().defined()) <<
+      "Cannot adopt storage for " << getName() << ", which is the result " <<
+      "of an expression";
+  Format format = getFormat();
+  taco_uassert(indices.size() == format.getOrder()) <<
+      "Expected the index arrays of " << format.getOrder() << " levels, " <<
+      "but got " << indices.size();
+
+  Storage storage(format, getComponentType());
+  for (size_t i = 0; i < format.getOrder(); i++) {
+    Level level = format.getLevels()[i];
+    switch (level.getType()) {
+      case DimensionType::Dense: {
+        taco_uassert(indices[i].size() == 0) <<
+            "Dense level " << i << " has no index arrays";
+        int size = getDimensions()[level.getDimension()];
+        storage.setDimensionIndex(i, {util::copyToArray({size})});
+        break;
+      }
+      case DimensionType::Sparse:
+      case DimensionType::Fixed:
+        taco_uassert(indices[i].size() == 2) <<
+            level.getType() << " level " << i << " needs a pos and an " <<
+            "idx array";
+        storage.setDimensionIndex(i, indices[i], {deleter, deleter});
+        break;
+    }
+  }
+  storage.setValues(vals, deleter);
+  content->storage = storage;
+}
+
+void TensorBase::setCSR(double* vals, int* rowPtr, int* colIdx,
+                        Storage::Deleter deleter) {
+  taco_uassert(getComponentType() == ComponentType::Double) <<
+      "setCSR: the tensor " << getName() << " has " << getComponentType() <<
+      " components, not double";
   taco_uassert(getFormat() == CSR) <<
       "setCSR: the tensor " << getName() << " is not in the CSR format, " <<
       "but instead " << getFormat();
-  auto storage = getStorage();
-  storage.setDimensionIndex(0, {util::copyToArray({getDimensions()[0]})});
-  storage.setDimensionIndex(1, {rowPtr, colIdx});
-  storage.setValues(vals);
+  adoptStorage({{}, {rowPtr, colIdx}}, vals, deleter);
 }
 
 void TensorBase::getCSR(double** vals, int** rowPtr, int** colIdx) {
+  taco_uassert(getComponentType() == ComponentType::Double) <<
+      "getCSR: the tensor " << getName() << " has " << getComponentType() <<
+      " components, not double";
   taco_uassert(getFormat() == CSR) <<
       "getCSR: the tensor " << getName() << " is not defined in the CSR format";
   auto storage = getStorage();
@@ -281,17 +353,20 @@ void TensorBase::getCSR(double** vals, int** rowPtr, int** colIdx) {
   *colIdx = storage.getDimensionIndex(1)[1];
 }
 
-void TensorBase::setCSC(double* vals, int* colPtr, int* rowIdx) {
+void TensorBase::setCSC(double* vals, int* colPtr, int* rowIdx,
+                        Storage::Deleter deleter) {
+  taco_uassert(getComponentType() == ComponentType::Double) <<
+      "setCSC: the tensor " << getName() << " has " << getComponentType() <<
+      " components, not double";
   taco_uassert(getFormat() == CSC) <<
       "setCSC: the tensor " << getName() << " is not defined in the CSC format";
-  auto storage = getStorage();
-  std::vector<int> denseDim = {getDimensions()[1]};
-  storage.setDimensionIndex(0, {util::copyToArray(denseDim)});
-  storage.setDimensionIndex(1, {colPtr, rowIdx});
-  storage.setValues(vals);
+  adoptStorage({{}, {colPtr, rowIdx}}, vals, deleter);
 }
 
 void TensorBase::getCSC(double** vals, int** colPtr, int** rowIdx) {
+  taco_uassert(getComponentType() == ComponentType::Double) <<
+      "getCSC: the tensor " << getName() << " has " << getComponentType() <<
+      " components, not double";
   taco_uassert(getFormat() == CSC) <<
       "getCSC: the tensor " << getName() << " is not defined in the CSC format";
 
@@ -301,46 +376,46 @@ void TensorBase::getCSC(double** vals, int** colPtr, int** rowIdx) {
   *rowIdx = storage.getDimensionIndex(1)[1];
 }
 
-static int numIntegersToCompare = 0;
-static int lexicographicalCmp(const void* a, const void* b) {
-  for (int i = 0; i < numIntegersToCompare; i++) {
-    int diff = ((int*)a)[i] - ((int*)b)[i];
-    if (diff != 0) {
-      return diff;
+/// Pack coordinates into a data structure given by the tensor format.
+/// True iff the storage has values or the index arrays of a sparse or fixed
+/// level, which only packing sets.  Dense levels are set by the constructor.
+static bool isPacked(const Storage& storage) {
+  if (storage.getValues() != nullptr) {
+    return true;
+  }
+  const vector<DimensionType>& dimTypes = storage.getFormat().getDimensionTypes();
+  for (size_t i = 0; i < dimTypes.size(); i++) {
+    if (dimTypes[i] != DimensionType::Dense &&
+        storage.getDimensionIndex(i)[0] != nullptr) {
+      return true;
     }
   }
-  return 0;
+  return false;
 }
 
-/// Pack coordinates into a data structure given by the tensor format.
-void TensorBase::pack() {
-  taco_tassert(getComponentType() == ComponentType::Double)
-      << "make the packing machinery work with other primitive types later. "
-      << "Right now we're specializing to doubles so that we can use a "
-      << "resizable vector, but eventually we should use a two pass pack "
-      << "algorithm that figures out sizes first, and then packs the data";
-
-  // Nothing to pack
-  if (coordinateBufferUsed == 0) {
+void TensorBase::pack(bool narrowIndices) {
+  const size_t order = getOrder();
+
+  // Nothing to pack.  Tensors that have never been packed are packed without
+  // coordinates, so that kernels read the index arrays of an empty tensor.
+  if (coordinateBufferUsed == 0 && (order == 0 || isPacked(content->storage))) {
     return;
   }
-  const size_t order = getOrder();
 
 
   // Pack scalars
   if (order == 0) {
     content->storage.setValues((double*)malloc(getComponentType().bytes()));
     char* coordLoc = this->coordinateBuffer->data();
-    content->storage.getValues()[0] =
-        *(double*)&coordLoc[this->coordinateSize-getComponentType().bytes()];
+    storeValue(content->storage.getValues(), getComponentType(), 0,
+               *(double*)&coordLoc[this->coordinateSize-sizeof(double)]);
     this->coordinateBuffer->clear();
     return;
   }
 
 
-  /// Permute the coordinates according to the storage dimension ordering.
-  /// This is a workaround since the current pack code only packs tensors in the
-  /// order of the dimensions.
+  /// Sort the coordinates according to the storage dimension ordering, since
+  /// the pack code only packs tensors in the order of the dimensions.
   const std::vector<Level>& levels     = getFormat().getLevels();
   const std::vector<int>&   dimensions = getDimensions();
   taco_iassert(levels.size() == order);
@@ -356,51 +431,25 @@ void TensorBase::pack() {
 
   taco_iassert((this->coordinateBufferUsed % this->coordinateSize) == 0);
   size_t numCoordinates = this->coordinateBufferUsed / this->coordinateSize;
-  const size_t coordSize = this->coordinateSize;
-
-  char* coordinatesPtr = coordinateBuffer->data();
-  vector<int> permuteBuffer(order);
-  for (size_t i=0; i < numCoordinates; ++i) {
-    int* coordinate = (int*)coordinatesPtr;
-    for (size_t j = 0; j < order; j++) {
-      permuteBuffer[j] = coordinate[permutation[j]];
-    }
-    for (size_t j = 0; j < order; j++) {
-      coordinate[j] = permuteBuffer[j];
-    }
-    coordinatesPtr += this->coordinateSize;
-  }
-  coordinatesPtr = coordinateBuffer->data();
-
-
-  // The pack code expects the coordinates to be sorted
-  numIntegersToCompare = order;
-  qsort(coordinatesPtr, numCoordinates, coordSize, lexicographicalCmp);
-
-
-  // Move coords into separate arrays
-  std::vector<std::vector<int>> coordinates(order);
-  for (size_t i=0; i < order; ++i) {
-    coordinates[i] = std::vector<int>(numCoordinates);
-  }
 
-  std::vector<double> values(numCoordinates);
-  for (size_t i=0; i < numCoordinates; ++i) {
-    int* coordLoc = (int*)&coordinatesPtr[i*coordSize];
-    for (size_t d=0; d < order; ++d) {
-      coordinates[d][i] = *coordLoc;
-      coordLoc++;
-    }
-    values[i] = *((double*)coordLoc);
-  }
+  // Sort the coordinates and move them into separate arrays, as expected by
+  // the pack code
+  std::vector<std::vector<int>> coordinates;
+  std::vector<double> values;
+  storage::sortCoordinates(coordinateBuffer->data(), numCoordinates,
+                           permutation, &coordinates, &values);
   taco_iassert(coordinates.size() > 0);
   this->coordinateBuffer->clear();
+  this->coordinateBuffer->shrink_to_fit();
   this->coordinateBufferUsed = 0;
 
 
   // Pack indices and values
-  content->storage = storage::pack(permutedDimensions, getFormat(),
-                                   coordinates, values);
+  Format format = narrowIndices ? getNarrowestIndexFormat(getFormat(),
+                                                          dimensions)
+                                : getFormat();
+  content->storage = storage::pack(permutedDimensions, format, coordinates,
+                                   values, getComponentType());
 
 //  std::cout << storage::packCode(getFormat()) << std::endl;
 }
@@ -408,7 +457,8 @@ void TensorBase::pack() {
 void TensorBase::zero() {
   auto resultStorage = getStorage();
   // Set values to 0.0 in case we are doing a += operation
-  memset(resultStorage.getValues(), 0, content->valuesSize * sizeof(double));
+  memset(resultStorage.getValues(), 0,
+         content->valuesSize * getComponentType().bytes());
 }
 
 Access TensorBase::operator()(const std::vector<Var>& indices) {
@@ -419,13 +469,143 @@ Access TensorBase::operator()(const std::vector<Var>& indices) {
   return Access(*this, indices);
 }
 
+/// Returns a key that identifies the kernels compiled for the tensor's
+/// expression.  Tensors and index variables are numbered in the order they
+/// appear, so expressions that only differ in names share a key.  The key
+/// includes everything else the lowered kernels depend on: the formats, the
+/// dimensions (dense loop bounds are baked into the kernels), the fixed level
+/// sizes, the initial allocation size, the accumulator type, the parallel
+/// schedule and the target.
+static string getKernelKey(const TensorBase& tensor) {
+  struct KeyPrinter : public expr_nodes::ExprVisitorStrict {
+    using ExprVisitorStrict::visit;
+    stringstream key;
+    map<TensorBase,size_t> tensorIds;
+    map<taco::Var,size_t> varIds;
+
+    void print(const taco::Var& var) {
+      if (!util::contains(varIds, var)) {
+        varIds.insert({var, varIds.size()});
+      }
+      key << (var.isFree() ? "i" : "r") << varIds.at(var);
+    }
+
+    void print(const TensorBase& tensor, const vector<taco::Var>& vars) {
+      if (!util::contains(tensorIds, tensor)) {
+        tensorIds.insert({tensor, tensorIds.size()});
+      }
+      key << "T" << tensorIds.at(tensor) << "(";
+      for (auto& var : vars) {
+        print(var);
+        key << ",";
+      }
+      key << ")";
+    }
+
+    void print(const string& op, Expr a, Expr b) {
+      key << "(";
+      a.accept(this);
+      key << op;
+      b.accept(this);
+      key << ")";
+    }
+
+    void visit(const ReadNode* op) {print(op->tensor, op->indexVars);}
+    void visit(const NegNode* op) {key << "-("; op->a.accept(this); key<<")";}
+    void visit(const SqrtNode* op) {key<<"sqrt(";op->a.accept(this);key<<")";}
+    void visit(const AddNode* op) {print("+", op->a, op->b);}
+    void visit(const SubNode* op) {print("-", op->a, op->b);}
+    void visit(const MulNode* op) {print("*", op->a, op->b);}
+    void visit(const DivNode* op) {print("/", op->a, op->b);}
+    void visit(const IntImmNode* op) {key << "int:" << op->val;}
+    void visit(const FloatImmNode* op) {key << "float:" << op->val;}
+    void visit(const DoubleImmNode* op) {key << "double:" << op->val;}
+  };
+
+  KeyPrinter printer;
+  printer.print(tensor, tensor.getIndexVars());
+  printer.key << "=";
+  tensor.getExpr().accept(&printer);
+
+  vector<TensorBase> tensors = {tensor};
+  util::append(tensors, expr_nodes::getOperands(tensor.getExpr()));
+  for (auto& t : tensors) {
+    printer.key << ";" << t.getComponentType() << "["
+                << util::join(t.getDimensions(), "x") << "]" << t.getFormat();
+    auto& levels = t.getFormat().getLevels();
+    for (size_t i = 0; i < levels.size(); i++) {
+      if (levels[i].getType() == DimensionType::Fixed) {
+        // Lowering also reads the segment size from the packed storage
+        taco_uassert(t.getStorage().getDimensionIndex(i)[0] != nullptr) <<
+            t.getName() << " must be packed before the kernels are compiled, "
+            "since the size of its fixed (ELL) level is compiled into them";
+        printer.key << "fixed" << i << ":"
+                    << t.getStorage().getDimensionIndex(i)[0][0];
+      }
+    }
+  }
+  printer.key << ";alloc:" << tensor.getAllocSize();
+  printer.key << ";accumulator:" << tensor.getAccumulatorType();
+  printer.key << ";schedule:" << (int)tensor.getParallelSchedule();
+  printer.key << ";target:" << tensor.getTarget().arch << "-"
+              << tensor.getTarget().parallelism << "-"
+              << tensor.getTarget().isa;
+  return printer.key.str();
+}
+
 void TensorBase::compile() {
   taco_iassert(getExpr().defined()) << "No expression defined for tensor";
-  content->assembleFunc = lower::lower(*this, "assemble", {lower::Assemble});
-  content->computeFunc  = lower::lower(*this, "compute", {lower::Compute});
-  content->module->addFunction(content->assembleFunc);
-  content->module->addFunction(content->computeFunc);
-  content->module->compile();
+  waitForCompile();
+
+  // The lowered functions are only needed to compile the kernels.  If the
+  // kernels are reused from the module cache they are lowered on demand.
+  content->assembleFunc = Stmt();
+  content->computeFunc  = Stmt();
+  TensorBase tensor = *this;
+  content->module = getModuleCache().getOrCompile(getKernelKey(*this), [&]() {
+    auto module = make_shared<Module>(getTarget());
+    content->assembleFunc = lower::lower(tensor, "assemble", {lower::Assemble});
+    content->computeFunc  = lower::lower(tensor, "compute", {lower::Compute});
+    module->addFunction(content->assembleFunc);
+    module->addFunction(content->computeFunc);
+    module->compile();
+    return module;
+  });
+}
+
+shared_future<void> TensorBase::compileAsync() {
+  taco_iassert(getExpr().defined()) << "No expression defined for tensor";
+  waitForCompile();
+
+  // Lower and compute the key on the calling thread, since they read the
+  // operands, so that only the lowered functions are shared with the compile
+  // thread and the caller may keep packing operands.
+  string key = getKernelKey(*this);
+  Target target = getTarget();
+  Stmt assembleFunc = lower::lower(*this, "assemble", {lower::Assemble});
+  Stmt computeFunc  = lower::lower(*this, "compute", {lower::Compute});
+  content->assembleFunc = assembleFunc;
+  content->computeFunc  = computeFunc;
+
+  shared_ptr<Content> tensorContent = content;
+  content->pendingCompile = getCompileThreadPool().submit([=]() {
+    tensorContent->module = getModuleCache().getOrCompile(key, [&]() {
+      auto module = make_shared<Module>(target);
+      module->addFunction(assembleFunc);
+      module->addFunction(computeFunc);
+      module->compile();
+      return module;
+    });
+  }).share();
+  return content->pendingCompile;
+}
+
+void TensorBase::waitForCompile() const {
+  if (content->pendingCompile.valid()) {
+    shared_future<void> pendingCompile = content->pendingCompile;
+    content->pendingCompile = shared_future<void>();
+    pendingCompile.get();
+  }
 }
 
 static taco_tensor_t* getTensorData(const TensorBase& tensor) {
@@ -460,12 +640,15 @@ static taco_tensor_t* getTensorData(const TensorBase& tensor) {
         tensorData->indices[i][1] = (uint8_t*)dimIndex[1];  // idx array
         break;
       case DimensionType::Fixed:
-        taco_not_supported_yet;
+        tensorData->dim_types[i]  = taco_dim_fixed;
+        tensorData->indices[i]    = (uint8_t**)malloc(2 * sizeof(uint8_t**));
+        tensorData->indices[i][0] = (uint8_t*)dimIndex[0];  // segment size
+        tensorData->indices[i][1] = (uint8_t*)dimIndex[1];  // idx array
         break;
     }
   }
 
-  tensorData->csize = sizeof(double);
+  tensorData->csize = tensor.getComponentType().bytes();
   tensorData->vals  = (uint8_t*)storage.getValues();
 
   return tensorData;
@@ -574,15 +757,19 @@ void TensorBase::setExpr(const vector<taco::Var>& indexVars, taco::Expr expr) {
       case DimensionType::Dense:
         break;
       case DimensionType::Sparse: {
-        auto pos = (int*)malloc(getAllocSize() * sizeof(int));
-        auto idx = (int*)malloc(getAllocSize() * sizeof(int));
-        pos[0] = 0;
+        auto positionType = format.getPositionType();
+        auto pos = (int*)malloc(getAllocSize() *
+                                getIndexArrayTypeSize(positionType));
+        auto idx = (int*)malloc(getAllocSize() *
+                                getIndexArrayTypeSize(level.getIndexType()));
+        storage::storeIndex(pos, positionType, 0, 0);
         storage.setDimensionIndex(i, {pos,idx});
         break;
       }
       case DimensionType::Fixed: {
         auto pos = (int*)malloc(sizeof(int));
-        auto idx = (int*)malloc(getAllocSize() * sizeof(int));
+        auto idx = (int*)malloc(getAllocSize() *
+                                getIndexArrayTypeSize(level.getIndexType()));
         storage.setDimensionIndex(i, {pos,idx});
         break;
       }
@@ -591,25 +778,67 @@ void TensorBase::setExpr(const vector<taco::Var>& indexVars, taco::Expr expr) {
 }
 
 void TensorBase::printComputeIR(ostream& os, bool color, bool simplify) const {
+  if (!content->computeFunc.defined()) {
+    content->computeFunc = lower::lower(*this, "compute", {lower::Compute});
+  }
   IRPrinter printer(os, color, simplify);
   printer.print(content->computeFunc.as<Function>()->body);
 }
 
 void TensorBase::printAssembleIR(ostream& os, bool color, bool simplify) const {
+  if (!content->assembleFunc.defined()) {
+    content->assembleFunc = lower::lower(*this, "assemble", {lower::Assemble});
+  }
   IRPrinter printer(os, color, simplify);
   printer.print(content->assembleFunc.as<Function>()->body);
 }
 
 string TensorBase::getSource() const {
+  waitForCompile();
   return content->module->getSource();
 }
 
 void TensorBase::compileSource(std::string source) {
   taco_iassert(getExpr().defined()) << "No expression defined for tensor";
+  waitForCompile();
+
+  // The source replaces the generated kernels, but the shims that call them
+  // are still generated from the lowered functions
+  Target target = getTarget();
+  content->module = make_shared<Module>(Target(Target::C99, target.os,
+                                               target.parallelism, target.isa));
+  content->assembleFunc = lower::lower(*this, "assemble", {lower::Assemble});
+  content->computeFunc  = lower::lower(*this, "compute", {lower::Compute});
+  content->module->addFunction(content->assembleFunc);
+  content->module->addFunction(content->computeFunc);
   content->module->setSource(source);
   content->module->compile();
 }
 
+/// True iff the tensors, whose components are of type CType, have the same
+/// nonzero coordinates and values that differ by a relative error of at most
+/// 10e-6.
+template <typename CType>
+static bool equalValues(const TensorBase& a, const TensorBase& b) {
+  auto at = iterate<CType>(a);
+  auto bt = iterate<CType>(b);
+  auto ait = at.begin();
+  auto bit = bt.begin();
+
+  for (; ait != at.end() && bit != bt.end(); ++ait, ++bit) {
+    if (ait->first != bit->first) {
+      return false;
+    }
+    double aval = ait->second;
+    double bval = bit->second;
+    if (abs((aval - bval)/aval) > 10e-6) {
+      return false;
+    }
+  }
+
+  return (ait == at.end() && bit == bt.end());
+}
+
 bool equals(const TensorBase& a, const TensorBase& b) {
   // Component type must be the same
   if (a.getComponentType() != b.getComponentType()) {
@@ -627,21 +856,18 @@ bool equals(const TensorBase& a, const TensorBase& b) {
   }
 
   // Values must be the same
-  auto at = iterate<double>(a);
-  auto bt = iterate<double>(b);
-  auto ait = at.begin();
-  auto bit = bt.begin();
-
-  for (; ait != at.end() && bit != bt.end(); ++ait, ++bit) {
-    if (ait->first != bit->first) {
-      return false;
-    }
-    if (abs((ait->second - bit->second)/ait->second) > 10e-6) {
-      return false;
-    }
+  switch (a.getComponentType().getKind()) {
+    case ComponentType::Bool:
+      return equalValues<bool>(a, b);
+    case ComponentType::Int:
+      return equalValues<int>(a, b);
+    case ComponentType::Float:
+      return equalValues<float>(a, b);
+    case ComponentType::Double:
+    case ComponentType::Unknown:
+      break;
   }
-
-  return (ait == at.end() && bit == bt.end());
+  return equalValues<double>(a, b);
 }
 
 bool operator==(const TensorBase& a, const TensorBase& b) {
@@ -669,6 +895,8 @@ bool operator>=(const TensorBase& a, const TensorBase& b) {
 }
 
 void TensorBase::assembleInternal() {
+  waitForCompile();
+  content->module->setNumThreads(getNumThreads());
   content->module->callFuncPacked("assemble", content->arguments.data());
 
   auto storage = getStorage();
@@ -684,17 +912,20 @@ void TensorBase::assembleInternal() {
                                       (int*)tensorData->indices[i][1]});
         break;
       case DimensionType::Fixed:
-        taco_not_supported_yet;
+        taco_ierror << "Lowering rejects results with fixed levels";
         break;
     }
   }
 
   content->valuesSize = storage.getSize().numValues();
-  storage.setValues((double*)malloc(content->valuesSize*sizeof(double)));
+  storage.setValues((double*)malloc(content->valuesSize *
+                                    getComponentType().bytes()));
   tensorData->vals = (uint8_t*)storage.getValues();
 }
 
 void TensorBase::computeInternal() {
+  waitForCompile();
+  content->module->setNumThreads(getNumThreads());
   this->content->module->callFuncPacked("compute", content->arguments.data());
 }
 
@@ -721,9 +952,34 @@ ostream& operator<<(ostream& os, const TensorBase& tensor) {
 }
 
 static string getExtension(string filename) {
+  // The extension of a compressed file is the one before `.gz`
+  if (io::isGzipFile(filename)) {
+    filename = filename.substr(0, filename.size() - 3);
+  }
   return filename.substr(filename.find_last_of(".") + 1);
 }
 
+static FileType getFileType(string filename) {
+  string extension = getExtension(filename);
+  if (extension == "ttx") {
+    return FileType::ttx;
+  }
+  else if (extension == "tns") {
+    return FileType::tns;
+  }
+  else if (extension == "mtx") {
+    return FileType::mtx;
+  }
+  else if (extension == "rb") {
+    return FileType::rb;
+  }
+  else if (extension == "tbin") {
+    return FileType::tbin;
+  }
+  taco_uerror << "File extension not recognized: " << filename << std::endl;
+  return FileType::tns;
+}
+
 template <typename T>
 TensorBase dispatchRead(T& file, FileType filetype, Format format, bool pack) {
   TensorBase tensor;
@@ -738,29 +994,26 @@ TensorBase dispatchRead(T& file, FileType filetype, Format format, bool pack) {
     case FileType::rb:
       tensor = io::rb::read(file, format, pack);
       break;
+    case FileType::tbin:
+      tensor = io::tbin::read(file, format, pack);
+      break;
   }
   return tensor;
 }
 
-TensorBase read(std::string filename, Format format, bool pack) {
-  string extension = getExtension(filename);
-
-  TensorBase tensor;
-  if (extension == "ttx") {
-    tensor = dispatchRead(filename, FileType::ttx, format, pack);
-  }
-  else if (extension == "tns") {
-    tensor = dispatchRead(filename, FileType::tns, format, pack);
-  }
-  else if (extension == "mtx") {
-    tensor = dispatchRead(filename, FileType::mtx, format, pack);
-  }
-  else if (extension == "rb") {
-    tensor = dispatchRead(filename, FileType::rb, format, pack);
-  }
-  else {
-    taco_uerror << "File extension not recognized: " << filename << std::endl;
+/// Read a file, decompressing it as it is parsed if it is a `.gz` file.
+static TensorBase dispatchRead(string filename, FileType filetype,
+                               Format format, bool pack) {
+  if (io::isGzipFile(filename)) {
+    io::GzipInputStream stream(filename);
+    return dispatchRead<istream>(stream, filetype, format, pack);
   }
+  return dispatchRead<string>(filename, filetype, format, pack);
+}
+
+TensorBase read(std::string filename, Format format, bool pack) {
+  TensorBase tensor = dispatchRead(filename, getFileType(filename), format,
+                                   pack);
 
   string name = filename.substr(filename.find_last_of("/") + 1);
   name = name.substr(0, name.find_first_of("."));
@@ -790,29 +1043,32 @@ void dispatchWrite(T& file, const TensorBase& tensor, FileType filetype) {
     case FileType::rb:
       io::rb::write(file, tensor);
       break;
+    case FileType::tbin:
+      io::tbin::write(file, tensor);
+      break;
   }
 }
 
-void write(string filename, const TensorBase& tensor) {
-  string extension = getExtension(filename);
-  if (extension == "ttx") {
-    dispatchWrite(filename, tensor, FileType::ttx);
-  }
-  else if (extension == "tns") {
-    dispatchWrite(filename, tensor, FileType::tns);
+/// Write a file, compressing it as it is written if it is a `.gz` file.
+static void dispatchWrite(string filename, const TensorBase& tensor,
+                          FileType filetype) {
+  if (io::isGzipFile(filename)) {
+    io::GzipOutputStream stream(filename);
+    dispatchWrite<ostream>(stream, tensor, filetype);
+    stream.close();
+    return;
   }
-  else if (extension == "mtx") {
+  dispatchWrite<string>(filename, tensor, filetype);
+}
+
+void write(string filename, const TensorBase& tensor) {
+  FileType filetype = getFileType(filename);
+  if (filetype == FileType::mtx) {
     taco_iassert(tensor.getOrder() == 2) <<
        "The .mtx format only supports matrices. Consider using the .ttx format "
        "instead";
-    dispatchWrite(filename, tensor, FileType::mtx);
-  }
-  else if (extension == "rb") {
-    dispatchWrite(filename, tensor, FileType::rb);
-  }
-  else {
-    taco_uerror << "File extension not recognized: " << filename << std::endl;
   }
+  dispatchWrite(filename, tensor, filetype);
 }
 
 void write(string filename, FileType filetype, const TensorBase& tensor) {
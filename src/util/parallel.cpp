@@ -0,0 +1,53 @@
+#include "taco/util/parallel.h"
+
+#include <atomic>
+#include <climits>
+#include <thread>
+#include <string>
+#include <vector>
+
+#include "taco/error.h"
+#include "taco/util/env.h"
+
+using namespace std;
+
+namespace taco {
+namespace util {
+
+static int getDefaultNumThreads() {
+  size_t numThreads = getSizeFromEnv("TACO_NUM_THREADS",
+                                      thread::hardware_concurrency());
+  return (int)min(max(numThreads, (size_t)1), (size_t)INT_MAX);
+}
+
+static atomic<int>& numThreadsSetting() {
+  static atomic<int> numThreads(getDefaultNumThreads());
+  return numThreads;
+}
+
+int getNumThreads() {
+  return numThreadsSetting();
+}
+
+int getNumThreads(size_t size, size_t grainSize) {
+  size_t maxThreads = max(size / grainSize, (size_t)1);
+  return (int)min((size_t)getNumThreads(), maxThreads);
+}
+
+void setNumThreads(int numThreads) {
+  taco_uassert(numThreads > 0) << "The number of threads must be positive";
+  numThreadsSetting() = numThreads;
+}
+
+void parallelFor(int numThreads, const function<void(int)>& body) {
+  vector<thread> threads;
+  for (int i = 1; i < numThreads; i++) {
+    threads.emplace_back(body, i);
+  }
+  body(0);
+  for (auto& t : threads) {
+    t.join();
+  }
+}
+
+}}
@@ -0,0 +1,56 @@
+#include "taco/util/thread_pool.h"
+
+using namespace std;
+
+namespace taco {
+namespace util {
+
+ThreadPool::ThreadPool(size_t numThreads) {
+  for (size_t i = 0; i < max(numThreads, (size_t)1); i++) {
+    workers.emplace_back(&ThreadPool::work, this);
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    lock_guard<std::mutex> lock(mutex);
+    stopping = true;
+  }
+  available.notify_all();
+  for (auto& worker : workers) {
+    worker.join();
+  }
+}
+
+future<void> ThreadPool::submit(function<void()> task) {
+  packaged_task<void()> packagedTask(task);
+  future<void> result = packagedTask.get_future();
+  {
+    lock_guard<std::mutex> lock(mutex);
+    tasks.push(std::move(packagedTask));
+  }
+  available.notify_one();
+  return result;
+}
+
+size_t ThreadPool::getNumThreads() const {
+  return workers.size();
+}
+
+void ThreadPool::work() {
+  while (true) {
+    packaged_task<void()> task;
+    {
+      unique_lock<std::mutex> lock(mutex);
+      available.wait(lock, [this]() { return stopping || !tasks.empty(); });
+      if (tasks.empty()) {
+        return;
+      }
+      task = std::move(tasks.front());
+      tasks.pop();
+    }
+    task();
+  }
+}
+
+}}
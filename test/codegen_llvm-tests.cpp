@@ -0,0 +1,184 @@
+#include "test.h"
+#include "test_tensors.h"
+
+#include "taco/tensor.h"
+#include "taco/expr.h"
+#include "taco/target.h"
+#include "taco/util/env.h"
+
+using namespace taco;
+using namespace taco::test;
+
+TEST(target, parse) {
+  Target target("x86-linux");
+  ASSERT_EQ(Target::X86, target.arch);
+  ASSERT_EQ(Target::Linux, target.os);
+  ASSERT_EQ(Target::C99, Target("c99-macos").arch);
+  ASSERT_EQ(Target::MacOS, Target("c99-macos").os);
+  ASSERT_EQ(Target::getDefaultParallelism(), Target("c99-linux").parallelism);
+  ASSERT_EQ(Target::OpenMP, Target("c99-linux-openmp").parallelism);
+  ASSERT_EQ(Target::Serial, Target("c99-linux-serial").parallelism);
+  ASSERT_EQ(Target::OpenMP, Target("c99-macos-openmp").parallelism);
+  ASSERT_EQ(Target::getDefaultParallelism(), Target("c99-macos").parallelism);
+  ASSERT_EQ(Target::getDefaultParallelism(),
+            Target(Target::C99, Target::MacOS).parallelism);
+  if (util::getFromEnv("TACO_OPENMP_FLAGS", "") == "") {
+    ASSERT_EQ(Target::Serial, Target::getDefaultParallelism());
+  }
+  ASSERT_EQ(Target::Generic, Target("c99-linux").isa);
+  ASSERT_EQ(Target::AVX2, Target("c99-linux-avx2").isa);
+  ASSERT_EQ(Target::AVX512, Target("x86-linux-serial-avx512").isa);
+  ASSERT_EQ(Target::Serial, Target("c99-linux-avx512-serial").parallelism);
+  ASSERT_EQ(32, Target("c99-linux-avx2").getVectorBytes());
+}
+
+#ifdef TACO_LLVM
+static void evaluate(TensorBase c99, TensorBase x86) {
+  Target target = getTargetFromEnvironment();
+  c99.setTarget(Target(Target::C99, target.os));
+  x86.setTarget(Target(Target::X86, target.os));
+  c99.evaluate();
+  x86.evaluate();
+}
+
+TEST(codegen_llvm, spmv) {
+  Tensor<double> A = d33a("A", CSR);
+  Tensor<double> x = d3b("x", Dense);
+  A.pack();
+  x.pack();
+
+  Var i("i"), j("j", Var::Sum);
+  Tensor<double> expected("expected", {3}, Dense);
+  Tensor<double> actual("actual", {3}, Dense);
+  expected(i) = A(i,j) * x(j);
+  actual(i) = A(i,j) * x(j);
+  evaluate(expected, actual);
+  ASSERT_TENSOR_EQ(expected, actual);
+}
+
+TEST(codegen_llvm, sparse_add) {
+  Tensor<double> B = d33a("B", Format({Sparse, Sparse}));
+  Tensor<double> C = d33b("C", Format({Sparse, Sparse}));
+  B.pack();
+  C.pack();
+
+  // Assembles a sparse result, which reallocates the result index arrays
+  Var i("i"), j("j");
+  Tensor<double> expected("expected", {3,3}, Format({Sparse, Sparse}));
+  Tensor<double> actual("actual", {3,3}, Format({Sparse, Sparse}));
+  actual.setAllocSize(2);
+  expected(i,j) = B(i,j) + C(i,j);
+  actual(i,j) = B(i,j) + C(i,j);
+  evaluate(expected, actual);
+  ASSERT_TENSOR_EQ(expected, actual);
+}
+
+TEST(codegen_llvm, int64_positions) {
+  Format format({Sparse, Sparse}, {0,1}, IndexArrayType::Int64);
+  Tensor<double> B = d33a("B", format);
+  Tensor<double> C = d33b("C", format);
+  B.pack();
+  C.pack();
+
+  Var i("i"), j("j");
+  Tensor<double> expected("expected", {3,3}, format);
+  Tensor<double> actual("actual", {3,3}, format);
+  actual.setAllocSize(2);
+  expected(i,j) = B(i,j) + C(i,j);
+  actual(i,j) = B(i,j) + C(i,j);
+  evaluate(expected, actual);
+  ASSERT_TENSOR_EQ(expected, actual);
+}
+
+TEST(codegen_llvm, narrow_indices) {
+  // Coordinates of 128 and up check that uint8 indices are zero extended
+  Tensor<double> A("A", {200,200}, CSR);
+  Tensor<double> A8("A8", {200,200}, CSR);
+  Tensor<double> x("x", {200}, Dense);
+  for (int i = 0; i < 200; i++) {
+    A.insert({i, (i * 7) % 200}, i + 1.0);
+    A8.insert({i, (i * 7) % 200}, i + 1.0);
+    x.insert({i}, i + 0.5);
+  }
+  A.pack();
+  A8.pack(true);
+  x.pack();
+  ASSERT_EQ(IndexArrayType::UInt8,
+            A8.getFormat().getLevels()[1].getIndexType());
+
+  Var i("i"), j("j", Var::Sum);
+  Tensor<double> expected("expected", {200}, Dense);
+  Tensor<double> actual("actual", {200}, Dense);
+  expected(i) = A(i,j) * x(j);
+  actual(i) = A8(i,j) * x(j);
+  evaluate(expected, actual);
+  ASSERT_TENSOR_EQ(expected, actual);
+}
+
+TEST(codegen_llvm, ell_spmv) {
+  Tensor<double> A = d33a("A", Format({Dense, Fixed}));
+  Tensor<double> x = d3b("x", Dense);
+  A.pack();
+  x.pack();
+
+  Var i("i"), j("j", Var::Sum);
+  Tensor<double> expected("expected", {3}, Dense);
+  Tensor<double> actual("actual", {3}, Dense);
+  expected(i) = A(i,j) * x(j);
+  actual(i) = A(i,j) * x(j);
+  evaluate(expected, actual);
+  ASSERT_TENSOR_EQ(expected, actual);
+}
+
+TEST(codegen_llvm, composite) {
+  Tensor<double> b = d5a("b", Sparse);
+  Tensor<double> c = d5b("c", Sparse);
+  Tensor<double> d = d5c("d", Dense);
+  b.pack();
+  c.pack();
+  d.pack();
+
+  Var i("i");
+  Tensor<double> expected("expected", {5}, Sparse);
+  Tensor<double> actual("actual", {5}, Sparse);
+  expected(i) = (b(i) + c(i)) * d(i) - -b(i);
+  actual(i) = (b(i) + c(i)) * d(i) - -b(i);
+  evaluate(expected, actual);
+  ASSERT_TENSOR_EQ(expected, actual);
+}
+TEST(codegen_llvm, component_types) {
+  Tensor<float> A("A", {3,3}, CSR);
+  Tensor<float> x("x", {3}, Dense);
+  Tensor<bool> B("B", {3,3}, CSR);
+  Tensor<bool> C("C", {3,3}, CSR);
+  for (int i = 0; i < 3; i++) {
+    A.insert({i, (i + 1) % 3}, i + 0.5);
+    B.insert({i, (i + 1) % 3}, 1.0);
+    C.insert({i, i}, 1.0);
+    x.insert({i}, i + 2.0);
+  }
+  C.insert({0, 1}, 1.0);
+  for (TensorBase tensor : vector<TensorBase>({A, x, B, C})) {
+    tensor.pack();
+  }
+
+  Var i("i"), j("j"), k("k", Var::Sum);
+  Tensor<float> expected("expected", {3}, Dense);
+  Tensor<float> actual("actual", {3}, Dense);
+  expected(i) = A(i,k) * x(k);
+  actual(i) = A(i,k) * x(k);
+  evaluate(expected, actual);
+  ASSERT_TENSOR_EQ(expected, actual);
+
+  // Sums of bools are stored as true, not truncated to their lowest bit
+  Tensor<bool> expectedUnion("expectedUnion", {3,3}, CSR);
+  Tensor<bool> actualUnion("actualUnion", {3,3}, CSR);
+  expectedUnion(i,j) = B(i,j) + C(i,j);
+  actualUnion(i,j) = B(i,j) + C(i,j);
+  evaluate(expectedUnion, actualUnion);
+  ASSERT_TENSOR_EQ(expectedUnion, actualUnion);
+  for (auto& val : actualUnion) {
+    ASSERT_TRUE(val.second);
+  }
+}
+#endif
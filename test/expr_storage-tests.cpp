@@ -712,6 +712,14 @@ INSTANTIATE_TEST_CASE_P(vector_inner, expr,
                     {
                     },
                     {40.0}
+                    ),
+           TestData(Tensor<double>("a",{},Format()),
+                    {},
+                    d5a("b",Format({Fixed}))(k) *
+                    d5b("c",Format({Sparse}))(k),
+                    {
+                    },
+                    {40.0}
                     )
            )
 );
@@ -766,6 +774,42 @@ INSTANTIATE_TEST_CASE_P(spmv, expr,
                       },
                     },
                     {0,18}
+                    ),
+           TestData(Tensor<double>("a",{3},Format({Dense})),
+                    {i},
+                    d33a("B",Format({Dense, Fixed}))(i,k) *
+                    d3b("c",Format({Dense}))(k),
+                    {
+                      {
+                        // Dense index
+                        {3}
+                      },
+                    },
+                    {0,0,18}
+                    ),
+           TestData(Tensor<double>("a",{3},Format({Dense})),
+                    {i},
+                    d33a("B",Format({Dense, Fixed}))(i,k) *
+                    d3b("c",Format({Sparse}))(k),
+                    {
+                      {
+                        // Dense index
+                        {3}
+                      },
+                    },
+                    {0,0,18}
+                    ),
+           TestData(Tensor<double>("a",{3},Format({Dense})),
+                    {i},
+                    d33a("B",Format({Dense, Fixed}))(k,i) *
+                    d3b("c",Format({Dense}))(k),
+                    {
+                      {
+                        // Dense index
+                        {3}
+                      },
+                    },
+                    {9,4,12}
                     )
            )
 );
@@ -72,3 +72,122 @@ TEST(format, dense) {
   A.pack();
   ASSERT_STORAGE_EQUALS({{{3}}, {{3}}}, {0,2,0, 0,0,0, 3,0,4}, A);
 }
+
+TEST(format, int64_positions) {
+  Format format({Dense,Sparse}, {0,1}, IndexArrayType::Int64);
+  ASSERT_EQ(IndexArrayType::Int64, format.getPositionType());
+  ASSERT_NE(CSR, format);
+
+  Tensor<double> A = d33a("A", format);
+  A.pack();
+  auto size = A.getStorage().getSize();
+  ASSERT_EQ(8u, size.numBytesPerIndexValue(1,0));
+  ASSERT_EQ(4u, size.numBytesPerIndexValue(1,1));
+  const int64_t* pos = (const int64_t*)A.getStorage().getDimensionIndex(1)[0];
+  ASSERT_VECTOR_EQ(vector<int64_t>({0,1,1,3}), vector<int64_t>(pos, pos + 4));
+
+  Tensor<double> B = d33a("B", CSR);
+  B.pack();
+  ASSERT_TRUE(equals(B, A));
+}
+
+TEST(format, int64_positions_compute) {
+  Format sparse64({Sparse,Sparse}, {0,1}, IndexArrayType::Int64);
+  Tensor<double> A64 = d33a("A64", Format({Dense,Sparse}, {0,1},
+                                          IndexArrayType::Int64));
+  Tensor<double> B64 = d33a("B64", sparse64);
+  Tensor<double> C64 = d33b("C64", sparse64);
+  Tensor<double> A = d33a("A", CSR);
+  Tensor<double> B = d33a("B", Format({Sparse,Sparse}));
+  Tensor<double> C = d33b("C", Format({Sparse,Sparse}));
+  Tensor<double> x = d3b("x", Dense);
+  for (auto tensor : {A64, B64, C64, A, B, C, x}) {
+    tensor.pack();
+  }
+
+  Var i("i"), j("j"), k("k", Var::Sum);
+  Tensor<double> expected("expected", {3}, Dense);
+  Tensor<double> actual("actual", {3}, Dense);
+  expected(i) = A(i,k) * x(k);
+  actual(i) = A64(i,k) * x(k);
+  expected.evaluate();
+  actual.evaluate();
+  ASSERT_TENSOR_EQ(expected, actual);
+
+  // Assembles a sparse result with Int64 positions
+  Tensor<double> D("D", {3,3}, Format({Sparse,Sparse}));
+  Tensor<double> D64("D64", {3,3}, sparse64);
+  D64.setAllocSize(2);
+  D(i,j) = B(i,j) + C(i,j);
+  D64(i,j) = B64(i,j) + C64(i,j);
+  D.evaluate();
+  D64.evaluate();
+  ASSERT_TENSOR_EQ(D, D64);
+  ASSERT_EQ(sparse64, D64.getStorage().getFormat());
+}
+
+TEST(format, expanded_single_level) {
+  // A format with one level applies to every dimension, with its position
+  // and idx array types
+  Tensor<double> A({3,3}, Format({Sparse}, {0}, IndexArrayType::Int64));
+  ASSERT_EQ(Format({Sparse,Sparse}, {0,1}, IndexArrayType::Int64),
+            A.getFormat());
+  Tensor<double> B({3,3,3}, Format({Sparse}, {0}, IndexArrayType::Int32,
+                                   {IndexArrayType::UInt16}));
+  ASSERT_EQ(vector<IndexArrayType>(3, IndexArrayType::UInt16),
+            B.getFormat().getIndexTypes());
+}
+
+TEST(format, narrow_indices) {
+  Tensor<double> A = d33a("A", CSR);
+  A.pack(true);
+  Format format({Dense,Sparse}, {0,1}, IndexArrayType::Int32,
+                {IndexArrayType::Int32, IndexArrayType::UInt8});
+  ASSERT_EQ(format, A.getFormat());
+  ASSERT_EQ(1u, A.getStorage().getSize().numBytesPerIndexValue(1,1));
+  const uint8_t* idx = (const uint8_t*)A.getStorage().getDimensionIndex(1)[1];
+  ASSERT_VECTOR_EQ(vector<uint8_t>({1,0,2}), vector<uint8_t>(idx, idx + 3));
+
+  Tensor<double> B = d33a("B", CSR);
+  B.pack();
+  ASSERT_TRUE(equals(B, A));
+  ASSERT_EQ(Format({Dense,Sparse}, {0,1}, IndexArrayType::Int32,
+                   {IndexArrayType::Int32, IndexArrayType::UInt16}),
+            getNarrowestIndexFormat(CSR, {3,300}));
+  ASSERT_EQ(CSR, getNarrowestIndexFormat(CSR, {3,100000}));
+}
+
+TEST(format, narrow_indices_compute) {
+  Format sparse8({Sparse,Sparse}, {0,1}, IndexArrayType::Int32,
+                 {IndexArrayType::UInt8, IndexArrayType::UInt8});
+  Tensor<double> A8 = d33a("A8", CSR);
+  Tensor<double> B8 = d33a("B8", sparse8);
+  Tensor<double> C8 = d33b("C8", sparse8);
+  Tensor<double> A = d33a("A", CSR);
+  Tensor<double> B = d33a("B", Format({Sparse,Sparse}));
+  Tensor<double> C = d33b("C", Format({Sparse,Sparse}));
+  Tensor<double> x = d3b("x", Dense);
+  A8.pack(true);
+  for (auto tensor : {B8, C8, A, B, C, x}) {
+    tensor.pack();
+  }
+
+  Var i("i"), j("j"), k("k", Var::Sum);
+  Tensor<double> expected("expected", {3}, Dense);
+  Tensor<double> actual("actual", {3}, Dense);
+  expected(i) = A(i,k) * x(k);
+  actual(i) = A8(i,k) * x(k);
+  expected.evaluate();
+  actual.evaluate();
+  ASSERT_TENSOR_EQ(expected, actual);
+
+  // Assembles a sparse result with narrow indices
+  Tensor<double> D("D", {3,3}, Format({Sparse,Sparse}));
+  Tensor<double> D8("D8", {3,3}, sparse8);
+  D8.setAllocSize(2);
+  D(i,j) = B(i,j) + C(i,j);
+  D8(i,j) = B8(i,j) + C8(i,j);
+  D.evaluate();
+  D8.evaluate();
+  ASSERT_TENSOR_EQ(D, D8);
+}
@@ -1,6 +1,18 @@
 #include "test.h"
 
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+
 #include "taco/tensor.h"
+#include "taco/io/tns_file_format.h"
+#include "taco/io/mtx_file_format.h"
+#include "taco/util/env.h"
+#include "taco/util/parallel.h"
+#include "io/coordinate_parser.h"
+#include "io/gzip_stream.h"
+#include "io/mapped_file.h"
 
 using namespace taco;
 
@@ -108,3 +120,446 @@ TEST(io, ttxsparse) {
 
   ASSERT_TRUE(equals(expected, tensor));
 }
+
+TEST(io, tbin) {
+  TensorBase tensor = read(testDataDirectory()+"3tensor.tns",
+                           Format({Sparse,Dense,Sparse}, {2,1,0}));
+  string filename = util::getTmpdir() + "3tensor.tbin";
+  write(filename, tensor);
+
+  TensorBase mapped = read(filename, Format({Sparse,Dense,Sparse}, {2,1,0}));
+  ASSERT_EQ(tensor.getFormat(), mapped.getFormat());
+  ASSERT_EQ(tensor.getDimensions(), mapped.getDimensions());
+  ASSERT_TRUE(equals(tensor, mapped));
+  ASSERT_EQ(0u, (size_t)mapped.getStorage().getValues() % 64);
+
+  // The stream reader allocates its own arrays
+  std::ifstream file(filename, std::ios::binary);
+  TensorBase streamed = read(file, FileType::tbin,
+                             Format({Sparse,Dense,Sparse}, {2,1,0}));
+  ASSERT_TRUE(equals(tensor, streamed));
+
+  // Reading into another format repacks the tensor
+  TensorBase repacked = read(filename, Sparse);
+  ASSERT_EQ(Format({Sparse,Sparse,Sparse}), repacked.getFormat());
+  ASSERT_TRUE(equals(read(testDataDirectory()+"3tensor.tns", Sparse),
+                     repacked));
+
+  // Int64 pos arrays are written and mapped as they are
+  Format format64({Sparse,Dense,Sparse}, {2,1,0}, IndexArrayType::Int64);
+  TensorBase tensor64 = read(testDataDirectory()+"3tensor.tns", format64);
+  write(filename, tensor64);
+  TensorBase mapped64 = read(filename, format64);
+  ASSERT_EQ(format64, mapped64.getFormat());
+  ASSERT_TRUE(equals(tensor, mapped64));
+  std::ostringstream text;
+  io::tns::write(text, mapped64);
+  std::ostringstream expectedText;
+  io::tns::write(expectedText, tensor);
+  ASSERT_EQ(expectedText.str(), text.str());
+
+  // So are narrow idx arrays
+  Format narrowFormat = getNarrowestIndexFormat(format64,
+                                                tensor.getDimensions());
+  TensorBase narrow = read(testDataDirectory()+"3tensor.tns", narrowFormat);
+  write(filename, narrow);
+  TensorBase mappedNarrow = read(filename, narrowFormat);
+  ASSERT_EQ(narrowFormat, mappedNarrow.getFormat());
+  ASSERT_TRUE(equals(tensor, mappedNarrow));
+  remove(filename.c_str());
+}
+
+TEST(io, tbin_component_types) {
+  // Tensors keep their component type, mapped, streamed and repacked
+  for (ComponentType ctype : {ComponentType::Bool, ComponentType::Int,
+                              ComponentType::Float}) {
+    TensorBase tensor(ctype, {3,4}, CSR);
+    tensor.insert({0, 1}, 1.0);
+    tensor.insert({2, 0}, (ctype == ComponentType::Bool) ? 1.0 : 1234567.0);
+    tensor.insert({2, 3}, (ctype == ComponentType::Float) ? 0.1 : 1.0);
+    tensor.pack();
+    string filename = util::getTmpdir() + "components.tbin";
+    write(filename, tensor);
+
+    TensorBase mapped = read(filename, CSR);
+    ASSERT_EQ(ctype, mapped.getComponentType());
+    ASSERT_TRUE(equals(tensor, mapped));
+
+    std::ifstream file(filename, std::ios::binary);
+    TensorBase streamed = read(file, FileType::tbin, CSR);
+    ASSERT_EQ(ctype, streamed.getComponentType());
+    ASSERT_TRUE(equals(tensor, streamed));
+
+    TensorBase expected(ctype, {3,4}, CSC);
+    expected.insert({0, 1}, 1.0);
+    expected.insert({2, 0}, (ctype == ComponentType::Bool) ? 1.0 : 1234567.0);
+    expected.insert({2, 3}, (ctype == ComponentType::Float) ? 0.1 : 1.0);
+    expected.pack();
+    TensorBase repacked = read(filename, CSC);
+    ASSERT_EQ(ctype, repacked.getComponentType());
+    ASSERT_TRUE(equals(expected, repacked));
+    remove(filename.c_str());
+  }
+}
+
+TEST(io, tns_parse) {
+  vector<string> values = {"1", "-2.5", "0.1", "1e-3", "-7.25E+2", "0.000123",
+                           "123456789012345678901", "3.14159265358979323846",
+                           "1e300", "4.9e-324", "+.5", "10."};
+  string filename = util::getTmpdir() + "parse.tns";
+  {
+    std::ofstream file(filename);
+    file << "# A comment" << endl << endl;
+    for (size_t i = 0; i < values.size(); i++) {
+      file << i+1 << "\t" << (i%3)+1 << "  " << values[i] << "\r\n";
+    }
+    file << "  # Another comment" << endl;
+  }
+
+  TensorBase tensor = read(filename, Format({Sparse,Sparse}));
+  ASSERT_EQ(vector<int>({(int)values.size(), 3}), tensor.getDimensions());
+  size_t i = 0;
+  for (auto& value : iterate<double>(tensor)) {
+    ASSERT_EQ(vector<int>({(int)i, (int)(i%3)}), value.first);
+    ASSERT_EQ(strtod(values[i].c_str(), nullptr), value.second);
+    i++;
+  }
+  ASSERT_EQ(values.size(), i);
+}
+
+TEST(io, tns_parallel) {
+  // Large enough to be parsed in several chunks
+  string filename = util::getTmpdir() + "parallel.tns";
+  {
+    std::ofstream file(filename);
+    for (int i = 0; i < 200000; i++) {
+      file << (i*7919)%1000+1 << " " << i/1000+1 << " " << i*0.25 << endl;
+    }
+  }
+
+  int numThreads = util::getNumThreads();
+  util::setNumThreads(4);
+  TensorBase tensor = read(filename, Format({Sparse,Sparse}));
+  util::setNumThreads(numThreads);
+
+  std::ifstream file(filename);
+  TensorBase expected = read(file, FileType::tns, Format({Sparse,Sparse}));
+  ASSERT_EQ(expected.getDimensions(), tensor.getDimensions());
+  ASSERT_TRUE(equals(expected, tensor));
+}
+
+TEST(io, tns_parallel_sorted) {
+  // Chunks parsed in parallel check that they are sorted in level order, and
+  // sorted chunks are packed without sorting them
+  string filename = util::getTmpdir() + "parallel_sorted.tns";
+  {
+    std::ofstream file(filename);
+    for (int i = 0; i < 200000; i++) {
+      file << i/200+1 << " " << (i%200)*5+1 << " " << i*0.25 << endl;
+    }
+  }
+
+  int numThreads = util::getNumThreads();
+  util::setNumThreads(4);
+  {
+    io::MappedFile file(filename);
+    const char* end = file.data() + file.size();
+    auto rowChunks = io::parseCoordinates(file.data(), end, 2, 1, '#', {0,1});
+    auto colChunks = io::parseCoordinates(file.data(), end, 2, 1, '#', {1,0});
+    ASSERT_LT(1u, rowChunks.size());
+    for (size_t t = 0; t < rowChunks.size(); t++) {
+      ASSERT_TRUE(rowChunks[t].sorted);
+      ASSERT_FALSE(colChunks[t].sorted);
+    }
+  }
+  for (auto& format : {CSR, CSC, Format({Sparse,Sparse})}) {
+    std::ifstream file(filename);
+    TensorBase expected = read(file, FileType::tns, format);
+    TensorBase tensor = read(filename, format);
+    ASSERT_EQ(expected.getDimensions(), tensor.getDimensions());
+    ASSERT_TRUE(equals(expected, tensor));
+  }
+  util::setNumThreads(numThreads);
+  remove(filename.c_str());
+}
+
+TEST(io, mtx_parallel) {
+  string filename = util::getTmpdir() + "parallel.mtx";
+  {
+    std::ofstream file(filename);
+    file << "%%MatrixMarket matrix coordinate real general" << endl;
+    file << "% A comment" << endl;
+    file << "1000 200 200000" << endl;
+    for (int i = 0; i < 200000; i++) {
+      file << (i*7919)%1000+1 << " " << i/1000+1 << " " << i*0.25 << endl;
+    }
+  }
+
+  int numThreads = util::getNumThreads();
+  util::setNumThreads(4);
+  TensorBase tensor = read(filename, CSR);
+  util::setNumThreads(numThreads);
+
+  std::ifstream file(filename);
+  TensorBase expected = read(file, FileType::mtx, CSR);
+  ASSERT_EQ(vector<int>({1000, 200}), tensor.getDimensions());
+  ASSERT_TRUE(equals(expected, tensor));
+}
+
+TEST(io, tns_sorted) {
+  // A sorted file is packed as it is parsed, an unsorted one is packed after
+  string sortedFilename = util::getTmpdir() + "sorted.tns";
+  string unsortedFilename = util::getTmpdir() + "unsorted.tns";
+  {
+    std::ofstream sorted(sortedFilename);
+    std::ofstream unsorted(unsortedFilename);
+    for (int i = 0; i < 3000; i++) {
+      sorted << i/50+1 << " " << (i%50)*2+1 << " " << i << endl;
+    }
+    for (int i = 3000; i > 0; i--) {
+      unsorted << (i-1)/50+1 << " " << ((i-1)%50)*2+1 << " " << i-1 << endl;
+    }
+  }
+
+  for (auto& format : {Format({Dense,Sparse}), Format({Sparse,Sparse}),
+                       Format({Sparse,Dense}), Format({Dense,Sparse}, {1,0})}) {
+    io::MappedFile sortedFile(sortedFilename);
+    TensorBase streamed;
+    io::CoordinateChunk prefix;
+    // Dense inner levels need dimension sizes before they are inferred, and
+    // the coordinates are not sorted by column
+    bool streamable = format.getDimensionOrder()[0] == 0 &&
+                      format.getDimensionTypes()[1] != Dense;
+    const char* rest = io::readSorted(sortedFile.data(),
+                                      sortedFile.data() + sortedFile.size(),
+                                      2, 1, '#', SIZE_MAX, format, {},
+                                      &streamed, &prefix);
+    ASSERT_EQ(streamable, rest == nullptr);
+
+    TensorBase sorted = read(sortedFilename, format);
+    TensorBase unsorted = read(unsortedFilename, format);
+    std::ifstream file(sortedFilename);
+    TensorBase expected = read(file, FileType::tns, format);
+    ASSERT_EQ(expected.getDimensions(), sorted.getDimensions());
+    ASSERT_TRUE(equals(expected, sorted));
+    ASSERT_TRUE(equals(expected, unsorted));
+    if (streamable) {
+      ASSERT_TRUE(equals(expected, streamed));
+    }
+  }
+
+  // A single level with Int64 positions applies to both dimensions, which
+  // the sorted packer cannot pack
+  Format sparse64({Sparse}, {0}, IndexArrayType::Int64);
+  io::MappedFile sortedFile(sortedFilename);
+  TensorBase streamed;
+  io::CoordinateChunk prefix;
+  ASSERT_EQ(sortedFile.data(),
+            io::readSorted(sortedFile.data(),
+                           sortedFile.data() + sortedFile.size(), 2, 1, '#',
+                           SIZE_MAX, sparse64, {}, &streamed, &prefix));
+  TensorBase sorted = read(sortedFilename, sparse64);
+  ASSERT_EQ(IndexArrayType::Int64, sorted.getFormat().getPositionType());
+  ASSERT_TRUE(equals(read(sortedFilename, Sparse), sorted));
+}
+
+TEST(io, tns_sorted_prefix) {
+  // A file that turns out to be unsorted is only parsed again from the first
+  // unsorted line, and the lines before it are handed over as coordinates
+  string filename = util::getTmpdir() + "sorted_prefix.tns";
+  std::ostringstream text;
+  for (int i = 0; i < 2000; i++) {
+    text << i/50+1 << " " << (i%50)*2+1 << " " << i << "\n";
+  }
+  size_t unsortedOffset = text.str().size();
+  for (int i = 0; i < 1000; i++) {
+    text << (i*37)%40+1 << " " << (i*13)%100+1 << " " << -i << "\n";
+  }
+  {
+    std::ofstream file(filename);
+    file << text.str();
+  }
+
+  for (auto& format : {Format({Dense,Sparse}), Format({Sparse,Sparse}),
+                       Format({Sparse,Dense})}) {
+    io::MappedFile file(filename);
+    TensorBase streamed;
+    io::CoordinateChunk prefix;
+    vector<int> dimensions = {40, 100};
+    ASSERT_EQ(file.data() + unsortedOffset,
+              io::readSorted(file.data(), file.data() + file.size(), 2, 1,
+                             '#', SIZE_MAX, format, dimensions, &streamed,
+                             &prefix));
+    ASSERT_EQ(vector<int>({40, 99}), prefix.dimensions);
+
+    // Dense levels hand over their zeros too
+    ASSERT_EQ(format.getDimensionTypes()[1] == Dense ? 4000u : 2000u,
+              prefix.values.size());
+    size_t numValues = 0;
+    for (size_t k = 0; k < prefix.values.size(); k++) {
+      int i = (int)prefix.values[k];
+      if (i == 0 && (prefix.coordinates[0][k] | prefix.coordinates[1][k])) {
+        continue;
+      }
+      ASSERT_EQ(i/50, prefix.coordinates[0][k]);
+      ASSERT_EQ((i%50)*2, prefix.coordinates[1][k]);
+      numValues++;
+    }
+    ASSERT_EQ(2000u, numValues);
+
+    std::ifstream stream(filename);
+    TensorBase expected = read(stream, FileType::tns, format);
+    TensorBase tensor = read(filename, format);
+    ASSERT_EQ(expected.getDimensions(), tensor.getDimensions());
+    ASSERT_TRUE(equals(expected, tensor));
+  }
+  remove(filename.c_str());
+}
+
+static string writeIterated(const TensorBase& tensor) {
+  std::ostringstream text;
+  for (auto& value : iterate<double>(tensor)) {
+    for (int coord : value.first) {
+      text << coord+1 << " ";
+    }
+    text << value.second << endl;
+  }
+  return text.str();
+}
+
+TEST(io, write_tns) {
+  TensorBase tensor(ComponentType::Double, {5,4,3},
+                    Format({Sparse,Dense,Sparse}, {2,0,1}));
+  tensor.insert({0, 0, 0}, 1.5);
+  tensor.insert({4, 3, 2}, -2.0);
+  tensor.insert({2, 1, 2}, 1e-20);
+  tensor.insert({3, 3, 0}, 123456789.0);
+  tensor.pack();
+
+  std::ostringstream text;
+  io::tns::write(text, tensor);
+  ASSERT_EQ(writeIterated(tensor), text.str());
+}
+
+TEST(io, write_ell) {
+  // The padding of the fixed segments, including the empty second row, is
+  // not written
+  TensorBase tensor(ComponentType::Double, {3,3}, Format({Dense,Fixed}));
+  tensor.insert({0, 1}, 2.0);
+  tensor.insert({2, 0}, 3.0);
+  tensor.insert({2, 2}, 4.0);
+  tensor.pack();
+
+  std::ostringstream text;
+  io::tns::write(text, tensor);
+  ASSERT_EQ("1 2 2\n3 1 3\n3 3 4\n", text.str());
+
+  std::istringstream file(text.str());
+  TensorBase read = taco::read(file, FileType::tns, Format({Dense,Fixed}));
+  ASSERT_TRUE(equals(tensor, read));
+
+  // Explicit zeros at coordinate 0 look like the padding of an empty segment,
+  // but are written, whether the interpreter or generated code packs them
+  for (string threshold : {"", "0"}) {
+    setenv("TACO_PACK_CODE_THRESHOLD", threshold.c_str(), 1);
+    if (threshold.empty()) {
+      unsetenv("TACO_PACK_CODE_THRESHOLD");
+    }
+    TensorBase zeros(ComponentType::Double, {4,3}, Format({Dense,Fixed}));
+    zeros.insert({0, 0}, 0.0);
+    zeros.insert({1, 0}, 0.0);
+    zeros.insert({1, 2}, 5.0);
+    zeros.insert({3, 1}, 6.0);
+    zeros.insert({3, 2}, 7.0);
+    zeros.pack();
+    unsetenv("TACO_PACK_CODE_THRESHOLD");
+
+    std::ostringstream zerosText;
+    io::tns::write(zerosText, zeros);
+    ASSERT_EQ("1 1 0\n2 1 0\n2 3 5\n4 2 6\n4 3 7\n", zerosText.str());
+  }
+}
+
+TEST(io, write_int) {
+  // Integer components are written exactly, whatever the stream precision
+  TensorBase tensor(ComponentType::Int, {3}, Format({Sparse}));
+  tensor.insert({0}, 1234567);
+  tensor.insert({1}, -2147483647 - 1);
+  tensor.insert({2}, 2147483647);
+  tensor.pack();
+
+  std::ostringstream text;
+  io::tns::write(text, tensor);
+  ASSERT_EQ("1 1234567\n2 -2147483648\n3 2147483647\n", text.str());
+
+  TensorBase expected(ComponentType::Double, {3}, Format({Sparse}));
+  expected.insert({0}, 1234567.0);
+  expected.insert({1}, -2147483648.0);
+  expected.insert({2}, 2147483647.0);
+  expected.pack();
+  std::istringstream file(text.str());
+  ASSERT_TRUE(equals(expected, taco::read(file, FileType::tns, Sparse)));
+}
+
+TEST(io, write_parallel) {
+  // Large enough to be formatted in several ranges
+  const int rows = 800;
+  const int cols = 800;
+  double* values = (double*)malloc(rows * cols * sizeof(double));
+  for (int i = 0; i < rows * cols; i++) {
+    values[i] = (i % 7 == 0) ? 0.0 : i * 0.125;
+  }
+  TensorBase tensor(ComponentType::Double, {rows, cols}, Dense);
+  tensor.adoptStorage({{}, {}}, values);
+
+  std::ostringstream serial;
+  std::ostringstream parallel;
+  int numThreads = util::getNumThreads();
+  util::setNumThreads(1);
+  io::tns::write(serial, tensor);
+  util::setNumThreads(4);
+  io::tns::write(parallel, tensor);
+  util::setNumThreads(numThreads);
+  ASSERT_EQ(writeIterated(tensor), serial.str());
+  ASSERT_EQ(serial.str(), parallel.str());
+
+  std::ostringstream mtx;
+  std::ostringstream expected;
+  io::mtx::write(mtx, tensor);
+  expected << "%%MatrixMarket matrix array real general" << endl << "%" << endl
+           << rows << " " << cols << " " << endl;
+  for (auto& value : iterate<double>(tensor)) {
+    expected << value.second << endl;
+  }
+  ASSERT_EQ(expected.str(), mtx.str());
+}
+
+TEST(io, gzip) {
+  if (!io::hasGzip()) {
+    return;
+  }
+  TensorBase tensor = read(testDataDirectory()+"3tensor.tns", Sparse);
+  TensorBase matrix = read(testDataDirectory()+"2tensor.mtx", CSR);
+  string tnsFilename = util::getTmpdir() + "compressed.tns.gz";
+  string mtxFilename = util::getTmpdir() + "compressed.mtx.gz";
+  string tbinFilename = util::getTmpdir() + "compressed.tbin.gz";
+  write(tnsFilename, tensor);
+  write(mtxFilename, matrix);
+  write(tbinFilename, matrix);
+
+  // The files are compressed
+  std::ifstream file(tnsFilename, std::ios::binary);
+  ASSERT_EQ(0x1f, file.get());
+  ASSERT_EQ(0x8b, file.get());
+
+  TensorBase tns = read(tnsFilename, Sparse);
+  ASSERT_EQ("compressed", tns.getName());
+  ASSERT_EQ(tensor.getDimensions(), tns.getDimensions());
+  ASSERT_TRUE(equals(tensor, tns));
+  ASSERT_TRUE(equals(matrix, read(mtxFilename, CSR)));
+  ASSERT_TRUE(equals(matrix, read(tbinFilename, CSR)));
+  ASSERT_TRUE(equals(matrix, read(mtxFilename, FileType::mtx, CSR)));
+  for (auto& filename : {tnsFilename, mtxFilename, tbinFilename}) {
+    remove(filename.c_str());
+  }
+}
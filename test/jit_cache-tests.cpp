@@ -0,0 +1,176 @@
+#include "test.h"
+
+#include <cstdio>
+#include <fstream>
+#include <ftw.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+
+#include "taco/tensor.h"
+#include "taco/expr.h"
+#include "taco/util/env.h"
+#include "lower/lower.h"
+#include "backends/module.h"
+#include "backends/jit_cache.h"
+
+using namespace taco;
+
+/// Creates cache directories for the tests and removes them afterwards.
+class jit_cache : public ::testing::Test {
+protected:
+  string makeTestCacheDir() {
+    char dirTemplate[] = "taco-cache-test-XXXXXX";
+    string pattern = util::getTmpdir() + dirTemplate;
+    char* dir = mkdtemp(&pattern[0]);
+    taco_iassert(dir != nullptr);
+    dirs.push_back(dir);
+    return string(dir) + "/";
+  }
+
+  void TearDown() {
+    for (auto& dir : dirs) {
+      nftw(dir.c_str(), [](const char* path, const struct stat*, int,
+                           struct FTW*) { return remove(path); },
+           16, FTW_DEPTH | FTW_PHYS);
+    }
+  }
+
+private:
+  vector<string> dirs;
+};
+
+static void writeEntryFile(string path, size_t bytes, time_t lastAccess) {
+  ofstream file(path);
+  file << string(bytes, 'x');
+  file.close();
+  struct timeval times[2] = {{lastAccess, 0}, {lastAccess, 0}};
+  utimes(path.c_str(), times);
+}
+
+TEST_F(jit_cache, key) {
+  string key = ir::getJITCacheKey({"int f();", "cc -O3"});
+  ASSERT_EQ(key, ir::getJITCacheKey({"int f();", "cc -O3"}));
+  ASSERT_NE(key, ir::getJITCacheKey({"int f();", "cc -O2"}));
+  ASSERT_NE(ir::getJITCacheKey({"ab", "c"}), ir::getJITCacheKey({"a", "bc"}));
+}
+
+TEST_F(jit_cache, hit) {
+  ir::JITCache* cache = ir::getJITCache();
+  if (cache == nullptr) {
+    return;
+  }
+
+  Tensor<double> a("a", {8}, Dense);
+  Tensor<double> b("b", {8}, Dense);
+  Var i("i");
+  a(i) = b(i) + b(i);
+
+  ir::Stmt compute = lower::lower(a, "compute", {lower::Compute});
+  Target c99(Target::C99, getTargetFromEnvironment().os);
+  ir::Module module1(c99);
+  module1.addFunction(compute);
+  string library1 = module1.compile();
+  ir::JITCacheStats stats = cache->getStats();
+
+  ir::Module module2(c99);
+  module2.addFunction(compute);
+  string library2 = module2.compile();
+  ASSERT_EQ(library1, library2);
+  ASSERT_EQ(stats.hits+1, cache->getStats().hits);
+  ASSERT_EQ(stats.misses, cache->getStats().misses);
+  ASSERT_NE(nullptr, module2.getFunc("compute"));
+}
+
+TEST_F(jit_cache, shims) {
+  ir::JITCache* cache = ir::getJITCache();
+  if (cache == nullptr) {
+    return;
+  }
+
+  Tensor<double> a("a", {8}, Dense);
+  Tensor<double> b("b", {8}, Dense);
+  Var i("i");
+  a(i) = b(i) * b(i);
+
+  // The cached shims include the cached header, not the one they were
+  // compiled with
+  ir::Module module(Target(Target::C99, getTargetFromEnvironment().os));
+  module.addFunction(lower::lower(a, "compute", {lower::Compute}));
+  string library = module.compile();
+  string prefix = library.substr(0, library.size() - 3);
+  ifstream shims(prefix + "_shims.c");
+  string include;
+  getline(shims, include);
+  ASSERT_EQ("#include \"" + prefix + ".h\"", include);
+  ASSERT_EQ(0, access((prefix + ".h").c_str(), F_OK));
+
+  // A set source replaces the one set before
+  ir::Module sourced(Target(Target::C99, getTargetFromEnvironment().os));
+  sourced.setSource("int f();");
+  sourced.setSource("int g();");
+  ASSERT_EQ("int g();", sourced.getSource());
+}
+
+TEST_F(jit_cache, size_from_env) {
+  // Sizes such as TACO_CACHE_SIZE fall back to their default unless they are
+  // non-negative integers
+  unsetenv("TACO_TEST_SIZE");
+  ASSERT_EQ(256u, util::getSizeFromEnv("TACO_TEST_SIZE", 256));
+  for (string value : {"", "abc", "12MB", "-1", "99999999999999999999999"}) {
+    setenv("TACO_TEST_SIZE", value.c_str(), 1);
+    ASSERT_EQ(256u, util::getSizeFromEnv("TACO_TEST_SIZE", 256)) << value;
+  }
+  setenv("TACO_TEST_SIZE", "0", 1);
+  ASSERT_EQ(0u, util::getSizeFromEnv("TACO_TEST_SIZE", 256));
+  setenv("TACO_TEST_SIZE", "1024", 1);
+  ASSERT_EQ(1024u, util::getSizeFromEnv("TACO_TEST_SIZE", 256));
+  unsetenv("TACO_TEST_SIZE");
+}
+
+TEST_F(jit_cache, lookup) {
+  string dir = makeTestCacheDir();
+  ir::JITCache cache(dir, 1 << 20);
+
+  ASSERT_FALSE(cache.lookup("k1", "source"));
+  writeEntryFile(dir + "k1.c", 0, time(nullptr));
+  ofstream(dir + "k1.c") << "source";
+  writeEntryFile(dir + "k1.so", 8, time(nullptr));
+  ASSERT_TRUE(cache.lookup("k1", "source"));
+  ASSERT_FALSE(cache.lookup("k1", "other source"));
+  ASSERT_EQ(1u, cache.getStats().hits);
+  ASSERT_EQ(2u, cache.getStats().misses);
+}
+
+TEST_F(jit_cache, evict) {
+  string dir = makeTestCacheDir();
+  ir::JITCache cache(dir, 250);
+
+  time_t now = time(nullptr);
+  writeEntryFile(dir + "old.c",        50, now - 300);
+  writeEntryFile(dir + "old_shims.c",  10, now - 300);
+  writeEntryFile(dir + "old.so",       40, now - 300);
+  writeEntryFile(dir + "used.c",       50, now - 200);
+  writeEntryFile(dir + "used.so",      50, now - 200);
+  writeEntryFile(dir + "new.c",        50, now - 100);
+  writeEntryFile(dir + "new.so",       50, now - 100);
+  ASSERT_EQ(300u, cache.getSize());
+
+  // Touch `used` so that it is more recently used than `new`
+  ofstream(dir + "used.c") << string(50, 'x');
+  ASSERT_TRUE(cache.lookup("used", string(50, 'x')));
+
+  // Inserting an entry never evicts it, so `old` and then `new` are evicted
+  writeEntryFile(dir + "newest.so", 100, now - 400);
+  cache.insert("newest");
+  ASSERT_EQ(2u, cache.getStats().evictions);
+  ASSERT_NE(0, access((dir + "old.so").c_str(), F_OK));
+  ASSERT_NE(0, access((dir + "old_shims.c").c_str(), F_OK));
+  ASSERT_NE(0, access((dir + "new.so").c_str(), F_OK));
+  ASSERT_EQ(0, access((dir + "used.so").c_str(), F_OK));
+  ASSERT_EQ(0, access((dir + "newest.so").c_str(), F_OK));
+  ASSERT_EQ(200u, cache.getSize());
+
+  cache.resetStats();
+  ASSERT_EQ(0u, cache.getStats().evictions);
+}
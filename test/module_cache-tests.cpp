@@ -0,0 +1,172 @@
+#include "test.h"
+
+#include "taco/tensor.h"
+#include "taco/expr.h"
+#include "taco/util/thread_pool.h"
+#include "backends/module.h"
+#include "backends/module_cache.h"
+
+using namespace taco;
+
+static Tensor<double> makeVector(string name, vector<double> vals,
+                                 Format format=Sparse) {
+  Tensor<double> tensor(name, {(int)vals.size()}, format);
+  for (size_t i = 0; i < vals.size(); i++) {
+    if (vals[i] != 0.0) {
+      tensor.insert({(int)i}, vals[i]);
+    }
+  }
+  tensor.pack();
+  return tensor;
+}
+
+TEST(module_cache, reuse) {
+  ir::ModuleCache& cache = ir::getModuleCache();
+  ir::ModuleCacheStats stats = cache.getStats();
+
+  Tensor<double> b = makeVector("b", {1.0, 0.0, 2.0, 0.0});
+  Tensor<double> c = makeVector("c", {3.0, 4.0, 0.0, 0.0});
+  Tensor<double> d = makeVector("d", {0.0, 5.0, 0.0, 6.0});
+
+  Var i("i"), j("j");
+  Tensor<double> a1("a1", {4}, Sparse);
+  a1(i) = b(i) + c(i);
+  a1.evaluate();
+  ASSERT_EQ(stats.misses+1, cache.getStats().misses);
+
+  // Only the names differ, so the kernels of a1 are reused
+  Tensor<double> a2("a2", {4}, Sparse);
+  a2(j) = c(j) + d(j);
+  a2.evaluate();
+  ASSERT_EQ(stats.misses+1, cache.getStats().misses);
+  ASSERT_EQ(stats.hits+1, cache.getStats().hits);
+  ASSERT_LE(stats.savedMilliseconds, cache.getStats().savedMilliseconds);
+  ASSERT_EQ(a1.getSource(), a2.getSource());
+
+  Tensor<double> expected1 = makeVector("e1", {4.0, 4.0, 2.0, 0.0});
+  Tensor<double> expected2 = makeVector("e2", {3.0, 9.0, 0.0, 6.0});
+  ASSERT_TENSOR_EQ(expected1, a1);
+  ASSERT_TENSOR_EQ(expected2, a2);
+}
+
+TEST(module_cache, distinct) {
+  ir::ModuleCache& cache = ir::getModuleCache();
+
+  Tensor<double> b = makeVector("b", {1.0, 0.0, 2.0});
+  Tensor<double> c = makeVector("c", {3.0, 4.0, 0.0});
+  Var i("i");
+
+  Tensor<double> a1("a1", {3}, Sparse);
+  a1(i) = b(i) * c(i);
+  a1.compile();
+  ir::ModuleCacheStats stats = cache.getStats();
+
+  // The same operand twice is a different kernel than two operands
+  Tensor<double> a2("a2", {3}, Sparse);
+  a2(i) = b(i) * b(i);
+  a2.compile();
+  ASSERT_EQ(stats.misses+1, cache.getStats().misses);
+
+  // Dense dimensions are baked into the kernels
+  Tensor<double> a3("a3", {3}, Dense);
+  a3(i) = b(i) * c(i);
+  a3.compile();
+  Tensor<double> e = makeVector("e", {1.0, 2.0, 3.0, 4.0});
+  Tensor<double> f = makeVector("f", {1.0, 2.0, 3.0, 4.0});
+  Tensor<double> a4("a4", {4}, Dense);
+  a4(i) = e(i) * f(i);
+  a4.compile();
+  ASSERT_EQ(stats.misses+3, cache.getStats().misses);
+  ASSERT_EQ(stats.hits, cache.getStats().hits);
+}
+
+TEST(module_cache, unload) {
+  ir::ModuleCache cache(1);
+  auto compile = []() { return make_shared<ir::Module>(); };
+
+  // The most recently used module stays loaded when no tensor uses it
+  weak_ptr<ir::Module> first = cache.getOrCompile("first", compile);
+  ASSERT_FALSE(first.expired());
+  ASSERT_EQ(1u, cache.getSize());
+
+  // Modules that are used stay cached beyond the capacity, and the others are
+  // unloaded
+  shared_ptr<ir::Module> second = cache.getOrCompile("second", compile);
+  ASSERT_TRUE(first.expired());
+  shared_ptr<ir::Module> third = cache.getOrCompile("third", compile);
+  ASSERT_EQ(2u, cache.getSize());
+  ASSERT_EQ(second, cache.getOrCompile("second", compile));
+  ASSERT_EQ(3u, cache.getStats().misses);
+  ASSERT_EQ(1u, cache.getStats().hits);
+
+  // Unloaded modules are compiled again
+  cache.getOrCompile("first", compile);
+  ASSERT_EQ(4u, cache.getStats().misses);
+
+  cache.setCapacity(0);
+  second = nullptr;
+  third = nullptr;
+  ASSERT_EQ(0u, cache.getSize());
+}
+
+TEST(module_cache, unload_kernels) {
+  ir::ModuleCache& cache = ir::getModuleCache();
+  size_t capacity = cache.getCapacity();
+  cache.setCapacity(0);
+  size_t size = cache.getSize();
+
+  Tensor<double> b = makeVector("b", {1.0, 0.0, 2.0, 0.0, 3.0});
+  Var i("i");
+  {
+    Tensor<double> a("a", {5}, Sparse);
+    a(i) = b(i) * b(i) * b(i);
+    a.evaluate();
+    ASSERT_EQ(size+1, cache.getSize());
+  }
+
+  // The kernels are unloaded with the last tensor that uses them
+  ASSERT_EQ(size, cache.getSize());
+  cache.setCapacity(capacity);
+}
+
+TEST(module_cache, compile_async) {
+  Tensor<double> b("b", {4}, Sparse);
+  Tensor<double> c("c", {4}, Sparse);
+  b.insert({0}, 1.0);
+  b.insert({2}, 2.0);
+  c.insert({0}, 3.0);
+  c.insert({1}, 4.0);
+
+  Var i("i");
+  Tensor<double> a1("a1", {4}, Sparse);
+  Tensor<double> a2("a2", {4}, Dense);
+  a1(i) = b(i) + c(i);
+  a2(i) = b(i) * c(i);
+  shared_future<void> compiled = a1.compileAsync();
+  a2.compileAsync();
+
+  // The operands are packed while the kernels compile
+  b.pack();
+  c.pack();
+  compiled.wait();
+
+  // assemble() and compute() wait for the compilation
+  a1.assemble();
+  a1.compute();
+  a2.assemble();
+  a2.compute();
+  ASSERT_TENSOR_EQ(makeVector("e1", {4.0, 4.0, 2.0, 0.0}), a1);
+  ASSERT_TENSOR_EQ(makeVector("e2", {3.0, 0.0, 0.0, 0.0}, Dense), a2);
+}
+
+TEST(module_cache, compile_pool) {
+  util::ThreadPool& pool = ir::getCompileThreadPool();
+  ASSERT_LE(1u, pool.getNumThreads());
+
+  int ran = 0;
+  pool.submit([&]() { ran++; }).get();
+  ASSERT_EQ(1, ran);
+
+  future<void> failed = pool.submit([]() { throw runtime_error("failed"); });
+  ASSERT_THROW(failed.get(), runtime_error);
+}
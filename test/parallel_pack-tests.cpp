@@ -0,0 +1,285 @@
+#include "test.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <map>
+#include <random>
+
+#include "taco/tensor.h"
+#include "taco/format.h"
+#include "taco/storage/storage.h"
+#include "taco/storage/pack.h"
+#include "taco/target.h"
+#include "taco/util/env.h"
+#include "taco/util/parallel.h"
+#include "backends/module_cache.h"
+
+using namespace taco;
+
+struct PackData {
+  PackData(vector<int> dimensions, Format format, size_t numCoordinates)
+      : dimensions(dimensions), format(format), numCoordinates(numCoordinates) {
+  }
+
+  vector<int> dimensions;
+  Format      format;
+  size_t      numCoordinates;
+};
+
+static ostream &operator<<(ostream& os, const PackData& data) {
+  return os << util::join(data.dimensions, "x") << " (" << data.format << ")";
+}
+
+/// Packs a tensor with random components on the given number of threads
+static Tensor<double> packRandom(const PackData& data,
+                                 const map<vector<int>,double>& components,
+                                 int numThreads) {
+  Tensor<double> tensor(data.dimensions, data.format);
+  for (auto& component : components) {
+    tensor.insert(component.first, component.second);
+  }
+
+  int defaultNumThreads = util::getNumThreads();
+  util::setNumThreads(numThreads);
+  tensor.pack();
+  util::setNumThreads(defaultNumThreads);
+  return tensor;
+}
+
+static map<vector<int>,double> getRandomComponents(const PackData& data) {
+  std::mt19937 random(0);
+  map<vector<int>,double> components;
+  while (components.size() < data.numCoordinates) {
+    vector<int> coordinate;
+    for (int dimension : data.dimensions) {
+      coordinate.push_back(random() % dimension);
+    }
+    components.insert({coordinate, (double)(components.size() + 1)});
+  }
+  return components;
+}
+
+static void ASSERT_SAME_STORAGE(const PackData& data,
+                                const Tensor<double>& expectedTensor,
+                                const Tensor<double>& actualTensor) {
+  storage::Storage expected = expectedTensor.getStorage();
+  storage::Storage actual   = actualTensor.getStorage();
+  storage::Storage::Size expectedSize = expected.getSize();
+  storage::Storage::Size actualSize   = actual.getSize();
+  for (size_t i = 0; i < data.dimensions.size(); i++) {
+    const vector<int*>& expectedIndex = expected.getDimensionIndex(i);
+    const vector<int*>& actualIndex   = actual.getDimensionIndex(i);
+    ASSERT_EQ(expectedIndex.size(), actualIndex.size());
+    for (size_t j = 0; j < expectedIndex.size(); j++) {
+      size_t size = expectedSize.numIndexValues(i, j);
+      ASSERT_EQ(size, actualSize.numIndexValues(i, j));
+      size_t bytes = size * expectedSize.numBytesPerIndexValue(i, j);
+      ASSERT_EQ(bytes, size * actualSize.numBytesPerIndexValue(i, j));
+      const char* expectedBytes = (const char*)expectedIndex[j];
+      ASSERT_TRUE(std::equal(expectedBytes, expectedBytes + bytes,
+                             (const char*)actualIndex[j]));
+    }
+
+    // Both record the sizes of the same fixed segments before padding
+    const int* expectedSizes = expected.getSegmentSizes(i);
+    const int* actualSizes   = actual.getSegmentSizes(i);
+    ASSERT_EQ(expectedSizes == nullptr, actualSizes == nullptr);
+    if (expectedSizes != nullptr && expectedIndex[0][0] > 0) {
+      size_t numSegments = expectedSize.numIndexValues(i, 1) /
+                           expectedIndex[0][0];
+      ASSERT_TRUE(std::equal(expectedSizes, expectedSizes + numSegments,
+                             actualSizes));
+    }
+  }
+  ASSERT_EQ(expectedSize.numValues(), actualSize.numValues());
+  ASSERT_TRUE(std::equal(expected.getValues(),
+                         expected.getValues() + expectedSize.numValues(),
+                         actual.getValues()));
+}
+
+struct parallel_pack : public TestWithParam<PackData> {};
+
+TEST_P(parallel_pack, pack) {
+  const PackData& data = GetParam();
+  map<vector<int>,double> components = getRandomComponents(data);
+
+  Tensor<double> serial   = packRandom(data, components, 1);
+  Tensor<double> parallel = packRandom(data, components, 4);
+
+  // The stored components are the inserted components
+  size_t numStored = 0;
+  for (auto& component : serial) {
+    if (component.second != 0.0) {
+      ASSERT_EQ(1u, components.count(component.first));
+      ASSERT_EQ(components.at(component.first), component.second);
+      numStored++;
+    }
+  }
+  ASSERT_EQ(components.size(), numStored);
+
+  // The parallel pack stores the same index arrays and values
+  ASSERT_SAME_STORAGE(data, serial, parallel);
+}
+
+TEST_P(parallel_pack, pack_code) {
+  const PackData& data = GetParam();
+  map<vector<int>,double> components = getRandomComponents(data);
+  Tensor<double> expected = packRandom(data, components, 4);
+
+  // Pack with code generated for each target
+  vector<string> archs = {"c99"};
+#ifdef TACO_LLVM
+  archs.push_back("x86");
+#endif
+  string os = (getTargetFromEnvironment().os == Target::MacOS) ? "macos"
+                                                               : "linux";
+  string defaultTarget = util::getFromEnv("TACO_TARGET", "");
+  setenv("TACO_PACK_CODE_THRESHOLD", "0", 1);
+  for (auto& arch : archs) {
+    setenv("TACO_TARGET", (arch + "-" + os).c_str(), 1);
+    ir::ModuleCacheStats stats = ir::getModuleCache().getStats();
+    Tensor<double> actual = packRandom(data, components, 4);
+    ir::ModuleCacheStats packStats = ir::getModuleCache().getStats();
+    ASSERT_EQ(stats.hits + stats.misses + 1, packStats.hits + packStats.misses);
+    ASSERT_SAME_STORAGE(data, expected, actual);
+  }
+  unsetenv("TACO_PACK_CODE_THRESHOLD");
+  if (defaultTarget.empty()) {
+    unsetenv("TACO_TARGET");
+  }
+  else {
+    setenv("TACO_TARGET", defaultTarget.c_str(), 1);
+  }
+}
+
+TEST_P(parallel_pack, pack_code_fallback) {
+  // Tensors are packed by the interpreter if the pack code does not compile
+  const PackData& data = GetParam();
+  map<vector<int>,double> components = getRandomComponents(data);
+  Tensor<double> expected = packRandom(data, components, 4);
+
+  string defaultCC = util::getFromEnv("TACO_CC", "");
+  string defaultTarget = util::getFromEnv("TACO_TARGET", "");
+  string os = (getTargetFromEnvironment().os == Target::MacOS) ? "macos"
+                                                               : "linux";
+  setenv("TACO_PACK_CODE_THRESHOLD", "0", 1);
+  setenv("TACO_CC", "false", 1);
+  setenv("TACO_TARGET", ("c99-" + os).c_str(), 1);
+  ir::getModuleCache().clear();
+  Tensor<double> actual = packRandom(data, components, 4);
+  unsetenv("TACO_PACK_CODE_THRESHOLD");
+  for (auto& variable : {make_pair("TACO_CC", defaultCC),
+                         make_pair("TACO_TARGET", defaultTarget)}) {
+    if (variable.second.empty()) {
+      unsetenv(variable.first);
+    }
+    else {
+      setenv(variable.first, variable.second.c_str(), 1);
+    }
+  }
+  ASSERT_SAME_STORAGE(data, expected, actual);
+}
+
+TEST_P(parallel_pack, sorted_packer) {
+  const PackData& data = GetParam();
+  if (!storage::SortedPacker::canPack(data.format, data.dimensions)) {
+    return;
+  }
+  map<vector<int>,double> components = getRandomComponents(data);
+  Tensor<double> expected = packRandom(data, components, 1);
+
+  // Sort the components in the level order of the format
+  const vector<int>& dimensionOrder = data.format.getDimensionOrder();
+  vector<pair<vector<int>,double>> sorted(components.begin(), components.end());
+  std::sort(sorted.begin(), sorted.end(),
+            [&](const pair<vector<int>,double>& a,
+                const pair<vector<int>,double>& b) {
+    for (int dimension : dimensionOrder) {
+      if (a.first[dimension] != b.first[dimension]) {
+        return a.first[dimension] < b.first[dimension];
+      }
+    }
+    return false;
+  });
+
+  storage::SortedPacker packer(data.format, data.dimensions);
+  for (auto& component : sorted) {
+    ASSERT_TRUE(packer.insert(component.first.data(), component.second));
+  }
+  ASSERT_FALSE(packer.insert(sorted[0].first.data(), sorted[0].second));
+
+  vector<vector<int*>> indices;
+  double* values;
+  packer.finish(data.dimensions, &indices, &values);
+  Tensor<double> actual(data.dimensions, data.format);
+  actual.adoptStorage(indices, values);
+  ASSERT_SAME_STORAGE(data, expected, actual);
+}
+
+TEST(parallel_pack, pack_code_component_types) {
+  // Generated pack code stores values of other types without a double copy
+  PackData data({1000,1000}, Format({Dense,Sparse}), 70000);
+  map<vector<int>,double> components = getRandomComponents(data);
+  for (ComponentType ctype : {ComponentType::Bool, ComponentType::Int,
+                              ComponentType::Float}) {
+    vector<TensorBase> tensors;
+    for (string threshold : {"", "0"}) {
+      if (!threshold.empty()) {
+        setenv("TACO_PACK_CODE_THRESHOLD", threshold.c_str(), 1);
+      }
+      TensorBase tensor(ctype, data.dimensions, data.format);
+      for (auto& component : components) {
+        tensor.insert(component.first, component.second + 0.5);
+      }
+      tensor.pack();
+      unsetenv("TACO_PACK_CODE_THRESHOLD");
+      tensors.push_back(tensor);
+    }
+    ASSERT_TRUE(equals(tensors[0], tensors[1]));
+  }
+}
+
+INSTANTIATE_TEST_CASE_P(vector, parallel_pack,
+  Values(PackData({200000}, Format({Dense}),  70000),
+         PackData({200000}, Format({Sparse}), 70000)
+         )
+);
+
+INSTANTIATE_TEST_CASE_P(matrix, parallel_pack,
+  Values(PackData({1000,1000}, Format({Dense,Sparse}),  70000),
+         PackData({1000,1000}, Format({Sparse,Sparse}), 70000),
+         PackData({1000,1000}, Format({Sparse,Dense}),  70000),
+         PackData({1000,1000}, Format({Dense,Fixed}),   70000),
+         PackData({1000,1000}, Format({Dense,Sparse}, {1,0}), 70000),
+         PackData({10,100000}, Format({Sparse,Sparse}), 70000)
+         )
+);
+
+INSTANTIATE_TEST_CASE_P(tensor3_fixed, parallel_pack,
+  Values(PackData({100,100,100}, Format({Dense,Fixed,Sparse}), 70000),
+         PackData({100,100,100}, Format({Fixed,Sparse,Fixed}), 70000),
+         PackData({100000,10,10}, Format({Fixed,Fixed,Dense}), 70000))
+);
+
+static const IndexArrayType UInt8  = IndexArrayType::UInt8;
+static const IndexArrayType UInt16 = IndexArrayType::UInt16;
+static const IndexArrayType Int32  = IndexArrayType::Int32;
+
+INSTANTIATE_TEST_CASE_P(narrow_indices, parallel_pack,
+  Values(PackData({1000,1000}, Format({Dense,Sparse}, {0,1}, Int32,
+                                      {Int32,UInt16}), 70000),
+         PackData({256,60000}, Format({Sparse,Sparse}, {0,1}, Int32,
+                                      {UInt8,UInt16}), 70000),
+         PackData({100,100,100}, Format({Dense,Fixed,Sparse}, {0,1,2}, Int32,
+                                        {Int32,UInt8,UInt8}), 70000)
+         )
+);
+
+// The coordinates of these tensors do not fit in a 64-bit sort key
+INSTANTIATE_TEST_CASE_P(tensor3, parallel_pack,
+  Values(PackData({1<<30,1<<30,1<<30}, Format({Sparse,Sparse,Sparse}),
+                  70000),
+         PackData({1<<30,100,1<<30}, Format({Dense,Sparse,Sparse}, {1,0,2}),
+                  70000)
+         )
+);
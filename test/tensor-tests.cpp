@@ -2,7 +2,9 @@
 #include "taco/tensor.h"
 
 #include <vector>
+#include "taco/target.h"
 #include "taco/util/collections.h"
+#include "taco/util/parallel.h"
 
 using namespace taco;
 
@@ -36,3 +38,490 @@ TEST(tensor, double_vector) {
     ASSERT_EQ(vals.at(val.first), val.second);
   }
 }
+
+TEST(tensor, insert_bulk) {
+  vector<vector<int>> coordinates = {{0, 3, 1, 3, 2},
+                                     {2, 0, 1, 4, 0}};
+  vector<double> values = {1.0, 2.0, 3.0, 4.0, 5.0};
+
+  Tensor<double> expected({4,5}, Format({Dense,Sparse}));
+  for (size_t i = 0; i < values.size(); i++) {
+    expected.insert({coordinates[0][i], coordinates[1][i]}, values[i]);
+  }
+  expected.pack();
+
+  Tensor<double> a({4,5}, Format({Dense,Sparse}));
+  a.insert({1,3}, 6.0);
+  a.insertBulk(coordinates, values);
+  a.insert({0,4}, 7.0);
+  a.pack();
+
+  Tensor<double> b({4,5}, Format({Dense,Sparse}));
+  b.insertBulk({coordinates[0].data(), coordinates[1].data()},
+               values.data(), values.size());
+  b.pack();
+  ASSERT_TRUE(equals(expected, b));
+
+  map<vector<int>, double> vals = {{{0,4}, 7.0}, {{1,3}, 6.0}};
+  for (size_t i = 0; i < values.size(); i++) {
+    vals.insert({{coordinates[0][i], coordinates[1][i]}, values[i]});
+  }
+  size_t numValues = 0;
+  for (auto& val : a) {
+    ASSERT_TRUE(util::contains(vals, val.first));
+    ASSERT_EQ(vals.at(val.first), val.second);
+    numValues++;
+  }
+  ASSERT_EQ(vals.size(), numValues);
+}
+
+TEST(tensor, adopt_storage) {
+  // A 2x3x4 CSF tensor in memory owned by the test
+  vector<int> pos0 = {0, 2};
+  vector<int> idx0 = {0, 1};
+  vector<int> pos1 = {0, 1, 3};
+  vector<int> idx1 = {2, 0, 2};
+  vector<int> pos2 = {0, 2, 3, 4};
+  vector<int> idx2 = {1, 3, 0, 2};
+  vector<double> vals = {1.0, 2.0, 3.0, 4.0};
+
+  map<vector<int>, double> expected = {{{0,2,1}, 1.0}, {{0,2,3}, 2.0},
+                                       {{1,0,0}, 3.0}, {{1,2,2}, 4.0}};
+  {
+    Tensor<double> B({2,3,4}, Format({Sparse,Sparse,Sparse}));
+    B.adoptStorage({{pos0.data(), idx0.data()},
+                    {pos1.data(), idx1.data()},
+                    {pos2.data(), idx2.data()}},
+                   vals.data(), storage::Storage::unowned);
+    ASSERT_EQ(vals.data(), B.getStorage().getValues());
+
+    size_t numValues = 0;
+    for (auto& val : B) {
+      ASSERT_TRUE(util::contains(expected, val.first));
+      ASSERT_EQ(expected.at(val.first), val.second);
+      numValues++;
+    }
+    ASSERT_EQ(expected.size(), numValues);
+
+    Tensor<double> c({4}, Dense);
+    for (int k = 0; k < 4; k++) {
+      c.insert({k}, 1.0);
+    }
+    c.pack();
+
+    Var i("i"), j("j", Var::Sum), k("k", Var::Sum);
+    Tensor<double> a({2}, Dense);
+    a(i) = B(i,j,k) * c(k);
+    a.evaluate();
+    ASSERT_EQ(3.0, a.getStorage().getValues()[0]);
+    ASSERT_EQ(7.0, a.getStorage().getValues()[1]);
+  }
+  ASSERT_EQ(4.0, vals[3]);
+}
+
+TEST(tensor, adopt_storage_deleter) {
+  vector<int> rowPtr = {0, 1, 1, 2};
+  vector<int> colIdx = {2, 0};
+  vector<double> vals = {1.0, 2.0};
+
+  vector<void*> released;
+  {
+    Tensor<double> A({3,3}, CSR);
+    A.setCSR(vals.data(), rowPtr.data(), colIdx.data(),
+             [&](void* array) { released.push_back(array); });
+    ASSERT_TRUE(released.empty());
+    ASSERT_EQ(2.0, A.getStorage().getValues()[1]);
+  }
+  ASSERT_EQ(3u, released.size());
+  ASSERT_TRUE(util::contains(released, (void*)rowPtr.data()));
+  ASSERT_TRUE(util::contains(released, (void*)colIdx.data()));
+  ASSERT_TRUE(util::contains(released, (void*)vals.data()));
+}
+
+TEST(tensor, component_types) {
+  Tensor<float> s(2.5f);
+  ASSERT_EQ(ComponentType::Float, s.getComponentType());
+  ASSERT_EQ(2.5f, s.begin()->second);
+
+  Tensor<float> a({5}, Sparse);
+  a.insert({0}, 1.5);
+  a.insert({3}, -2.25);
+  a.pack();
+  ASSERT_EQ(sizeof(float), a.getStorage().getSize().numBytesPerValue());
+  ASSERT_EQ(-2.25f, ((float*)a.getStorage().getValues())[1]);
+
+  Tensor<int> b({2,2}, CSR);
+  b.insertBulk({{0, 1}, {1, 0}}, {3.0, -4.0});
+  b.pack();
+  map<vector<int>, int> expected = {{{0,1}, 3}, {{1,0}, -4}};
+  for (auto& val : b) {
+    ASSERT_EQ(expected.at(val.first), val.second);
+  }
+
+  Tensor<bool> c({3}, Dense);
+  c.insert({1}, 1.0);
+  c.pack();
+  vector<bool> values;
+  for (auto& val : c) {
+    values.push_back(val.second);
+  }
+  ASSERT_EQ(vector<bool>({false, true, false}), values);
+}
+
+TEST(tensor, component_types_compute) {
+  Tensor<float> A({3,3}, CSR);
+  Tensor<float> x({3}, Dense);
+  Tensor<int> B({3,3}, CSR);
+  Tensor<bool> C({3,3}, CSR);
+  Tensor<bool> D({3,3}, CSR);
+  for (int i = 0; i < 3; i++) {
+    A.insert({i, (i + 1) % 3}, i + 0.5);
+    B.insert({i, (i + 1) % 3}, i + 1);
+    C.insert({i, (i + 1) % 3}, 1.0);
+    D.insert({i, i}, 1.0);
+    x.insert({i}, 2.0);
+  }
+  D.insert({0, 1}, 1.0);
+  for (TensorBase tensor : vector<TensorBase>({A, x, B, C, D})) {
+    tensor.pack();
+  }
+
+  Var i("i"), j("j"), k("k", Var::Sum);
+  Tensor<float> y({3}, Dense);
+  y(i) = A(i,k) * x(k);
+  y.evaluate();
+  ASSERT_EQ(vector<float>({1.0f, 3.0f, 5.0f}),
+            vector<float>((float*)y.getStorage().getValues(),
+                          (float*)y.getStorage().getValues() + 3));
+
+  // Bool operands are promoted to int
+  Tensor<int> z({3}, Dense);
+  z(i) = B(i,k) * C(i,k) + C(i,k);
+  z.evaluate();
+  ASSERT_EQ(vector<int>({2, 3, 4}),
+            vector<int>((int*)z.getStorage().getValues(),
+                        (int*)z.getStorage().getValues() + 3));
+
+  // The union of two adjacency matrices
+  Tensor<bool> E({3,3}, CSR);
+  E(i,j) = C(i,j) + D(i,j);
+  E.evaluate();
+  Tensor<bool> expected({3,3}, CSR);
+  for (int i = 0; i < 3; i++) {
+    expected.insert({i, i}, 1.0);
+    expected.insert({i, (i + 1) % 3}, 1.0);
+  }
+  expected.pack();
+  ASSERT_TENSOR_EQ(expected, E);
+  for (auto& val : E) {
+    ASSERT_TRUE(val.second);
+  }
+}
+
+TEST(tensor, accumulator_type) {
+  // Adding the small values to sums of at least 1 in float leaves the sums
+  // unchanged, even if the kernel splits the sum into vector lanes
+  const int n = 10000;
+  Tensor<float> A({1,n}, CSR);
+  Tensor<float> x({n}, Dense);
+  for (int j = 0; j < n; j++) {
+    A.insert({0, j}, (j < 64) ? 1.0 : 1e-8);
+    x.insert({j}, 1.0);
+  }
+  A.pack();
+  x.pack();
+
+  Var i("i"), j("j", Var::Sum);
+  Tensor<float> single({1}, Dense);
+  Tensor<float> mixed({1}, Dense);
+  mixed.setAccumulatorType(ComponentType::Double);
+  ASSERT_EQ(ComponentType::Float, single.getAccumulatorType());
+  ASSERT_EQ(ComponentType::Double, mixed.getAccumulatorType());
+  single(i) = A(i,j) * x(j);
+  mixed(i) = A(i,j) * x(j);
+  single.evaluate();
+  mixed.evaluate();
+  ASSERT_EQ(64.0f, ((float*)single.getStorage().getValues())[0]);
+  ASSERT_FLOAT_EQ(64.0000994f, ((float*)mixed.getStorage().getValues())[0]);
+}
+
+TEST(tensor, num_threads) {
+  const int n = 1000;
+  Tensor<double> A({n,n}, CSR);
+  Tensor<double> x({n}, Dense);
+  for (int i = 0; i < n; i++) {
+    A.insert({i, i}, i + 1.0);
+    A.insert({i, (i * 7) % n}, 2.0);
+    x.insert({i}, i + 0.5);
+  }
+  A.pack();
+  x.pack();
+
+  // The outer loop of the dense result is a parallel loop
+  Target target = getTargetFromEnvironment();
+  Var i("i"), j("j", Var::Sum);
+  Tensor<double> serial({n}, Dense);
+  Tensor<double> parallel({n}, Dense);
+  serial.setTarget(Target(Target::C99, target.os, Target::Serial));
+  parallel.setTarget(Target(Target::C99, target.os, Target::OpenMP));
+  parallel.setNumThreads(4);
+  ASSERT_EQ(util::getNumThreads(), serial.getNumThreads());
+  ASSERT_EQ(4, parallel.getNumThreads());
+  serial(i) = A(i,j) * x(j);
+  parallel(i) = A(i,j) * x(j);
+  serial.evaluate();
+  parallel.evaluate();
+  ASSERT_TENSOR_EQ(serial, parallel);
+
+  // The parallel regions of the kernel run on the tensor's number of threads
+  string source = parallel.getSource();
+  source = source.substr(0, source.find("int compute(")) +
+      "int omp_get_num_threads(void);\n"
+      "int compute(taco_tensor_t *y, taco_tensor_t *A, taco_tensor_t *x) {\n"
+      "  double* y_vals = (double*)(y->vals);\n"
+      "  #pragma omp parallel\n"
+      "  {\n"
+      "    #pragma omp single\n"
+      "    y_vals[0] = omp_get_num_threads();\n"
+      "  }\n"
+      "  return 0;\n"
+      "}\n";
+  parallel.compileSource(source);
+  for (int numThreads : {1, 3}) {
+    parallel.setNumThreads(numThreads);
+    parallel.assemble();
+    parallel.compute();
+    ASSERT_EQ(numThreads, ((double*)parallel.getStorage().getValues())[0]);
+  }
+}
+
+TEST(tensor, parallel_assembly) {
+  const int n = 1000;
+  Tensor<double> B({n,n}, CSR);
+  Tensor<double> C({n,n}, CSR);
+  for (int i = 0; i < n; i++) {
+    B.insert({i, i}, i + 1.0);
+    B.insert({i, (i * 7) % n}, 2.0);
+    if (i % 3 != 0) {
+      C.insert({i, (i * 7) % n}, 3.0);
+      C.insert({i, (i * 11) % n}, 0.5);
+    }
+  }
+  B.pack();
+  C.pack();
+
+  // Sparse rows below the dense rows of the result are counted, summed and
+  // filled in parallel, and the index arrays outgrow the allocation size
+  Target target = getTargetFromEnvironment();
+  Var i("i"), j("j");
+  for (bool add : {true, false}) {
+    Tensor<double> serial({n,n}, CSR);
+    Tensor<double> parallel({n,n}, CSR);
+    serial.setTarget(Target(Target::C99, target.os, Target::Serial));
+    parallel.setTarget(Target(Target::C99, target.os, Target::OpenMP));
+    parallel.setNumThreads(4);
+    parallel.setAllocSize(2);
+    if (add) {
+      serial(i,j) = B(i,j) + C(i,j);
+      parallel(i,j) = B(i,j) + C(i,j);
+    }
+    else {
+      serial(i,j) = B(i,j) * C(i,j);
+      parallel(i,j) = B(i,j) * C(i,j);
+    }
+    serial.evaluate();
+    parallel.evaluate();
+    ASSERT_TENSOR_EQ(serial, parallel);
+  }
+}
+
+TEST(tensor, parallel_reduction) {
+  const int n = 1000;
+  Tensor<double> A({n,n}, CSR);
+  Tensor<double> b({n}, Sparse);
+  Tensor<double> x({n}, Dense);
+  for (int i = 0; i < n; i++) {
+    A.insert({i, i}, i + 1.0);
+    A.insert({i, (i * 7) % n}, 2.0);
+    if (i % 3 == 0) {
+      b.insert({i}, i + 0.25);
+    }
+    x.insert({i}, i + 0.5);
+  }
+  A.pack();
+  b.pack();
+  x.pack();
+
+  // Dot products and norms reduce into a scalar, and transposed SpMV scatters
+  // into a dense vector, which the threads privatize
+  Target target = getTargetFromEnvironment();
+  Var i("i", Var::Sum), j("j");
+  Tensor<double> serialDot("serialDot", {}, Format());
+  Tensor<double> parallelDot("parallelDot", {}, Format());
+  Tensor<double> serialNorm("serialNorm", {}, Format());
+  Tensor<double> parallelNorm("parallelNorm", {}, Format());
+  Tensor<double> serialSpMVT({n}, Dense);
+  Tensor<double> parallelSpMVT({n}, Dense);
+  serialDot() = b(i) * x(i);
+  parallelDot() = b(i) * x(i);
+  serialNorm() = x(i) * x(i);
+  parallelNorm() = x(i) * x(i);
+  serialSpMVT(j) = A(i,j) * x(i);
+  parallelSpMVT(j) = A(i,j) * x(i);
+  for (TensorBase serial : {serialDot, serialNorm, serialSpMVT}) {
+    serial.setTarget(Target(Target::C99, target.os, Target::Serial));
+    serial.evaluate();
+  }
+  for (TensorBase parallel : {parallelDot, parallelNorm, parallelSpMVT}) {
+    parallel.setTarget(Target(Target::C99, target.os, Target::OpenMP));
+    parallel.setNumThreads(4);
+    parallel.evaluate();
+  }
+  ASSERT_TENSOR_EQ(serialDot, parallelDot);
+  ASSERT_TENSOR_EQ(serialNorm, parallelNorm);
+  ASSERT_TENSOR_EQ(serialSpMVT, parallelSpMVT);
+}
+
+TEST(tensor, nonzero_schedule) {
+  // A few long rows span several partitions of the nonzeros, and empty rows
+  // lie between them and at either end
+  const int n = 10000;
+  Tensor<double> A({n,n}, CSR);
+  Tensor<double> x({n}, Dense);
+  for (int i = 0; i < n; i++) {
+    int length = (i % 1000 == 500) ? n : ((i % 5 == 0 || i < 3) ? 0 : 1);
+    for (int k = 0; k < length; k++) {
+      A.insert({i, (i * 13 + k * 7) % n}, 1.0 + k % 3);
+    }
+    x.insert({i}, i + 0.5);
+  }
+  A.insert({n-2, 0}, 2.0);
+  A.pack();
+  x.pack();
+
+  Target target = getTargetFromEnvironment();
+  Var i("i"), j("j", Var::Sum);
+  Tensor<double> rows({n}, Dense);
+  Tensor<double> nonzeros({n}, Dense);
+  rows.setTarget(Target(Target::C99, target.os, Target::Serial));
+  nonzeros.setTarget(Target(Target::C99, target.os, Target::OpenMP));
+  nonzeros.setParallelSchedule(ParallelSchedule::Nonzeros);
+  nonzeros.setNumThreads(4);
+  ASSERT_EQ(ParallelSchedule::Rows, rows.getParallelSchedule());
+  rows(i) = A(i,j) * x(j);
+  nonzeros(i) = A(i,j) * x(j);
+  rows.evaluate();
+  nonzeros.evaluate();
+  ASSERT_TENSOR_EQ(rows, nonzeros);
+
+  // Matrices without rows or without nonzeros have no partitions to carry
+  for (int m : {0, 5}) {
+    Tensor<double> E({m,n}, CSR);
+    E.pack();
+    Tensor<double> expected({m}, Dense);
+    expected.pack();
+    Tensor<double> y({m}, Dense);
+    y.setTarget(Target(Target::C99, target.os, Target::OpenMP));
+    y.setParallelSchedule(ParallelSchedule::Nonzeros);
+    y(i) = E(i,j) * x(j);
+    y.evaluate();
+    ASSERT_TENSOR_EQ(expected, y);
+  }
+}
+
+TEST(tensor, vectorized) {
+  // Kernels are compiled for every vector instruction set, but only run on
+  // machines that support it, since they would crash on others
+  vector<pair<Target::VectorISA,bool>> isas;
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+  isas.push_back({Target::AVX2, __builtin_cpu_supports("avx2") &&
+                                __builtin_cpu_supports("fma")});
+  isas.push_back({Target::AVX512, __builtin_cpu_supports("avx512f") &&
+                                  __builtin_cpu_supports("avx512vl") &&
+                                  __builtin_cpu_supports("avx512dq") &&
+                                  __builtin_cpu_supports("avx512bw")});
+#endif
+
+  // The dense rank loop of MTTKRP and the gather loop of SpMV are vectorized,
+  // and their trip counts are not multiples of the vector widths.  The ELL
+  // loop of a(i) = E(k,i) * c(k) scatters into the result at coordinates that
+  // repeat in the padding, so it is not.
+  const int n = 37, r = 21;
+  Tensor<double> B({n,n,n}, Format({Sparse,Sparse,Sparse}));
+  Tensor<double> C({n,r}, Format({Dense,Dense}));
+  Tensor<double> D({n,r}, Format({Dense,Dense}));
+  Tensor<double> A({n,n}, CSR);
+  Tensor<double> E({n,n}, Format({Dense,Fixed}));
+  Tensor<double> x({n}, Dense);
+  for (int i = 0; i < n; i++) {
+    B.insert({i, (i * 5) % n, (i * 3) % n}, i + 1.0);
+    B.insert({i, (i * 7) % n, i}, 0.5);
+    for (int j = 0; j < r; j++) {
+      C.insert({i, j}, i + j + 0.25);
+      D.insert({i, j}, i - j + 0.5);
+    }
+    for (int j = 0; j < i; j += 3) {
+      A.insert({i, j}, i * 0.5 + j);
+    }
+    for (int j = 0; j < i % 11; j++) {
+      E.insert({i, (i + j * 3) % n}, j + 1.5);
+    }
+    x.insert({i}, i + 0.5);
+  }
+  B.pack();
+  C.pack();
+  D.pack();
+  A.pack();
+  E.pack();
+  x.pack();
+
+  Target target = getTargetFromEnvironment();
+  Var i("i"), j("j"), k("k", Var::Sum), l("l", Var::Sum), s("s", Var::Sum);
+  Tensor<double> expectedMTTKRP({n,r}, Format({Dense,Dense}));
+  Tensor<double> expectedSpMV({n}, Dense);
+  Tensor<double> expectedELL({n}, Dense);
+  expectedMTTKRP.setTarget(Target(Target::C99, target.os, Target::Serial));
+  expectedSpMV.setTarget(Target(Target::C99, target.os, Target::Serial));
+  expectedELL.setTarget(Target(Target::C99, target.os, Target::Serial));
+  expectedMTTKRP(i,j) = B(i,k,l) * C(k,j) * D(l,j);
+  expectedSpMV(i) = A(i,s) * x(s);
+  expectedELL(i) = E(k,i) * x(k);
+  expectedMTTKRP.evaluate();
+  expectedSpMV.evaluate();
+  expectedELL.evaluate();
+  for (auto& isa : isas) {
+    Target vectorTarget(Target::C99, target.os, Target::Serial, isa.first);
+    Tensor<double> mttkrp({n,r}, Format({Dense,Dense}));
+    Tensor<double> spmv({n}, Dense);
+    Tensor<double> ell({n}, Dense);
+    mttkrp.setTarget(vectorTarget);
+    spmv.setTarget(vectorTarget);
+    ell.setTarget(vectorTarget);
+    mttkrp(i,j) = B(i,k,l) * C(k,j) * D(l,j);
+    spmv(i) = A(i,s) * x(s);
+    ell(i) = E(k,i) * x(k);
+    mttkrp.compile();
+    spmv.compile();
+    ell.compile();
+
+    // The headers define the hint macros, so only their uses have a width
+    string hint = "TACO_VECTORIZE_WIDTH(" +
+                  util::toString(vectorTarget.getVectorBytes() / 8) + ")";
+    ASSERT_NE(string::npos, mttkrp.getSource().find(hint));
+    ASSERT_NE(string::npos, spmv.getSource().find(hint));
+    ASSERT_EQ(string::npos, ell.getSource().find(hint));
+    if (!isa.second) {
+      continue;
+    }
+
+    mttkrp.assemble();
+    spmv.assemble();
+    ell.assemble();
+    mttkrp.compute();
+    spmv.compute();
+    ell.compute();
+    ASSERT_TENSOR_EQ(expectedMTTKRP, mttkrp);
+    ASSERT_TENSOR_EQ(expectedSpMV, spmv);
+    ASSERT_TENSOR_EQ(expectedELL, ell);
+  }
+}
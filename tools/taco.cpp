@@ -22,6 +22,7 @@
 #include "taco/util/fill.h"
 #include "taco/util/env.h"
 #include "taco/util/collections.h"
+#include "taco/util/parallel.h"
 
 using namespace std;
 using namespace taco;
@@ -108,6 +109,11 @@ static void printUsageInfo() {
   printFlag("verify",
             "Verify results when comparing kernels.");
   cout << endl;
+  printFlag("nthreads=<n>",
+            "Run the parallel loops of OpenMP kernels (e.g. with "
+            "TACO_TARGET=c99-linux-openmp) on <n> threads. Defaults to "
+            "$TACO_NUM_THREADS or the number of hardware threads.");
+  cout << endl;
   printFlag("print-compute",
             "Print the compute kernel (default).");
   cout << endl;
@@ -336,6 +342,18 @@ int main(int argc, char* argv[]) {
     else if ("-verify" == argName) {
       verify = true;
     }
+    else if ("-nthreads" == argName) {
+      int numThreads = 0;
+      try {
+        numThreads = stoi(argValue);
+      }
+      catch (...) {
+      }
+      if (numThreads < 1) {
+        return reportError("Incorrect nthreads descriptor", 3);
+      }
+      util::setNumThreads(numThreads);
+    }
     else if ("-write-source" == argName) {
       writeKernelFilename = argValue;
       writeKernels = true;